@@ -0,0 +1,88 @@
+#include <limits.h>
+#include <time.h>
+
+#include "admission.h"
+
+static AdmissionConfig config;
+static AdmissionStats stats;
+static long window_end_us;
+static long window_min_us = LONG_MAX;
+
+void admission_init(const AdmissionConfig *admission_config) {
+    config = *admission_config;
+}
+
+long admission_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+int admission_connect(void) {
+    long connections = __atomic_add_fetch(&stats.connections, 1, __ATOMIC_RELAXED);
+    if (config.max_connections > 0 && connections > config.max_connections) {
+        __atomic_sub_fetch(&stats.connections, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&stats.rejected_connections, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    return 0;
+}
+
+void admission_disconnect(void) {
+    __atomic_sub_fetch(&stats.connections, 1, __ATOMIC_RELAXED);
+}
+
+static void codel_sample(long now, long sojourn) {
+    long current = __atomic_load_n(&window_min_us, __ATOMIC_RELAXED);
+    while (sojourn < current &&
+           !__atomic_compare_exchange_n(&window_min_us, &current, sojourn, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    long end = __atomic_load_n(&window_end_us, __ATOMIC_ACQUIRE);
+    if (now >= end &&
+        __atomic_compare_exchange_n(&window_end_us, &end, now + config.codel_interval_us, 0, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_RELAXED)) {
+        long window_min = __atomic_exchange_n(&window_min_us, LONG_MAX, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats.overloaded, end != 0 && window_min > config.codel_target_us, __ATOMIC_RELAXED);
+    }
+}
+
+int admission_enter(long arrival_us) {
+    if (config.codel_target_us > 0) {
+        long now = admission_now_us();
+        long sojourn = now > arrival_us ? now - arrival_us : 0;
+        codel_sample(now, sojourn);
+        long limit = __atomic_load_n(&stats.overloaded, __ATOMIC_RELAXED) ? config.codel_target_us
+                                                                          : config.codel_interval_us;
+        if (sojourn > limit) {
+            __atomic_add_fetch(&stats.shed_codel, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    }
+    long inflight = __atomic_add_fetch(&stats.inflight, 1, __ATOMIC_RELAXED);
+    if (config.max_inflight > 0 && inflight > config.max_inflight) {
+        __atomic_sub_fetch(&stats.inflight, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&stats.shed_inflight, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    __atomic_add_fetch(&stats.admitted, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void admission_exit(void) {
+    __atomic_sub_fetch(&stats.inflight, 1, __ATOMIC_RELAXED);
+}
+
+void admission_expired(void) {
+    __atomic_add_fetch(&stats.expired, 1, __ATOMIC_RELAXED);
+}
+
+void admission_stats(AdmissionStats *out) {
+    out->connections = __atomic_load_n(&stats.connections, __ATOMIC_RELAXED);
+    out->rejected_connections = __atomic_load_n(&stats.rejected_connections, __ATOMIC_RELAXED);
+    out->inflight = __atomic_load_n(&stats.inflight, __ATOMIC_RELAXED);
+    out->admitted = __atomic_load_n(&stats.admitted, __ATOMIC_RELAXED);
+    out->shed_inflight = __atomic_load_n(&stats.shed_inflight, __ATOMIC_RELAXED);
+    out->shed_codel = __atomic_load_n(&stats.shed_codel, __ATOMIC_RELAXED);
+    out->expired = __atomic_load_n(&stats.expired, __ATOMIC_RELAXED);
+    out->overloaded = __atomic_load_n(&stats.overloaded, __ATOMIC_RELAXED);
+}
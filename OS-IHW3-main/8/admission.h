@@ -0,0 +1,31 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+typedef struct {
+    int max_connections;
+    int max_inflight;
+    long codel_target_us;
+    long codel_interval_us;
+} AdmissionConfig;
+
+typedef struct {
+    long connections;
+    long rejected_connections;
+    long inflight;
+    long admitted;
+    long shed_inflight;
+    long shed_codel;
+    long expired;
+    int overloaded;
+} AdmissionStats;
+
+void admission_init(const AdmissionConfig *config);
+int admission_connect(void);
+void admission_disconnect(void);
+int admission_enter(long arrival_us);
+void admission_exit(void);
+void admission_expired(void);
+void admission_stats(AdmissionStats *stats);
+long admission_now_us(void);
+
+#endif
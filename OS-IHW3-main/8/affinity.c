@@ -0,0 +1,105 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "affinity.h"
+
+int cpuset_parse(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0) {
+            return -1;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) {
+                return -1;
+            }
+        }
+        if (last >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            CPU_SET(cpu, set);
+        }
+        if (*end == ',') {
+            ++end;
+        } else if (*end) {
+            return -1;
+        }
+        p = end;
+    }
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+int cpuset_node(const cpu_set_t *set) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, set)) {
+            continue;
+        }
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+        DIR *dir = opendir(path);
+        if (!dir) {
+            return -1;
+        }
+        int node = -1;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+                node = atoi(entry->d_name + 4);
+                break;
+            }
+        }
+        closedir(dir);
+        return node;
+    }
+    return -1;
+}
+
+int affinity_pin_self(const cpu_set_t *set) {
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(*set), set);
+    if (err != 0) {
+        fprintf(stderr, "pthread_setaffinity_np() failed: %s\n", strerror(err));
+        return -1;
+    }
+    return 0;
+}
+
+int affinity_pin_process(const cpu_set_t *set) {
+    if (sched_setaffinity(0, sizeof(*set), set) < 0) {
+        perror("sched_setaffinity() failed");
+        return -1;
+    }
+    return 0;
+}
+
+int affinity_attr(pthread_attr_t *attr, const cpu_set_t *set) {
+    int err = pthread_attr_setaffinity_np(attr, sizeof(*set), set);
+    if (err != 0) {
+        fprintf(stderr, "pthread_attr_setaffinity_np() failed: %s\n", strerror(err));
+        return -1;
+    }
+    return 0;
+}
+
+int affinity_prefer_node(int node) {
+    unsigned long mask[(node / (8 * sizeof(unsigned long))) + 1];
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8) < 0) {
+        perror("set_mempolicy() failed");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <sched.h>
+#include <pthread.h>
+
+int cpuset_parse(const char *list, cpu_set_t *set);
+int cpuset_node(const cpu_set_t *set);
+int affinity_pin_self(const cpu_set_t *set);
+int affinity_pin_process(const cpu_set_t *set);
+int affinity_attr(pthread_attr_t *attr, const cpu_set_t *set);
+int affinity_prefer_node(int node);
+
+#endif
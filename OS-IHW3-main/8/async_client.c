@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "conn.h"
+#include "log.h"
+
+#define ARRAY_SIZE 10
+#define THINK_MIN_MS 1000
+#define THINK_MAX_MS 5000
+#define BUSY_BACKOFF_MIN_US 1000
+#define BUSY_BACKOFF_MAX_US 1000000
+#define REQUEST_SIZE 64
+#define MAX_EVENTS 64
+
+typedef enum {
+    ROLE_READER,
+    ROLE_WRITER
+} Role;
+
+typedef enum {
+    STATE_READING,
+    STATE_WRITING
+} State;
+
+struct Socket;
+
+typedef struct {
+    int id;
+    Role role;
+    State state;
+    int index;
+    int new_value;
+    int attempt;
+    long wake_us;
+    struct Socket *sock;
+} VirtualClient;
+
+typedef struct Socket {
+    Conn conn;
+    VirtualClient **pending;
+    unsigned head;
+    unsigned tail;
+    unsigned cap;
+    int want_write;
+} Socket;
+
+typedef struct {
+    pthread_t tid;
+    int epoll_fd;
+    Socket *sockets;
+    int socket_count;
+    VirtualClient *clients;
+    int client_count;
+    VirtualClient **timers;
+    int timer_count;
+    unsigned seed;
+} Engine;
+
+const char *server_uri;
+long think_min_us = THINK_MIN_MS * 1000L;
+long think_max_us = THINK_MAX_MS * 1000L;
+int quiet;
+long completed;
+
+int fib(int n) {
+    if (n == 0) return 0;
+    if (n == 1) return 1;
+    int prev = 0;
+    int curr = 1;
+    int next;
+    for (int i = 2; i <= n; i++) {
+        next = prev + curr;
+        prev = curr;
+        curr = next;
+    }
+    return curr;
+}
+
+long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+void timer_push(Engine *engine, VirtualClient *client) {
+    int i = engine->timer_count++;
+    while (i > 0 && engine->timers[(i - 1) / 2]->wake_us > client->wake_us) {
+        engine->timers[i] = engine->timers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    engine->timers[i] = client;
+}
+
+VirtualClient *timer_pop(Engine *engine) {
+    VirtualClient *top = engine->timers[0];
+    VirtualClient *last = engine->timers[--engine->timer_count];
+    int i = 0;
+    while (2 * i + 1 < engine->timer_count) {
+        int child = 2 * i + 1;
+        if (child + 1 < engine->timer_count && engine->timers[child + 1]->wake_us < engine->timers[child]->wake_us) {
+            ++child;
+        }
+        if (last->wake_us <= engine->timers[child]->wake_us) {
+            break;
+        }
+        engine->timers[i] = engine->timers[child];
+        i = child;
+    }
+    engine->timers[i] = last;
+    return top;
+}
+
+void client_schedule(Engine *engine, VirtualClient *client, long delay_us) {
+    client->wake_us = now_us() + delay_us;
+    timer_push(engine, client);
+}
+
+void client_sleep(Engine *engine, VirtualClient *client) {
+    client->state = STATE_READING;
+    client->attempt = 0;
+    client->index = rand_r(&engine->seed) % ARRAY_SIZE;
+    client->new_value = rand_r(&engine->seed) % 40;
+    long spread = think_max_us - think_min_us;
+    client_schedule(engine, client, think_min_us + (spread > 0 ? rand_r(&engine->seed) % (spread + 1) : 0));
+}
+
+void client_issue(Engine *engine, VirtualClient *client) {
+    Socket *sock = client->sock;
+    char request[REQUEST_SIZE];
+    if (client->state == STATE_READING) {
+        snprintf(request, sizeof(request), "READ %d", client->index);
+    } else {
+        snprintf(request, sizeof(request), "WRITE %d %d", client->index, client->new_value);
+    }
+    if (frame_appendf(&sock->conn.out, "%s", request) < 0) {
+        client_schedule(engine, client, BUSY_BACKOFF_MIN_US);
+        return;
+    }
+    sock->pending[sock->tail++ % sock->cap] = client;
+}
+
+void client_reply(Engine *engine, VirtualClient *client, const char *reply) {
+    if (strcmp(reply, "BUSY") == 0) {
+        long cap = (long)BUSY_BACKOFF_MIN_US << (client->attempt < 10 ? client->attempt : 10);
+        if (cap > BUSY_BACKOFF_MAX_US) {
+            cap = BUSY_BACKOFF_MAX_US;
+        }
+        ++client->attempt;
+        client_schedule(engine, client, cap / 2 + rand_r(&engine->seed) % (cap / 2 + 1));
+        return;
+    }
+    __atomic_add_fetch(&completed, 1, __ATOMIC_RELAXED);
+    int value, old_value;
+    if (client->state == STATE_READING && sscanf(reply, "VALUE %d", &value) == 1) {
+        if (client->role == ROLE_WRITER) {
+            client->state = STATE_WRITING;
+            client->attempt = 0;
+            client_issue(engine, client);
+            return;
+        }
+        if (!quiet) {
+            log_write(LOG_INFO, "Reader[%d]: DB[%d] = %d, Fibonacci = %d\n", client->id, client->index, value,
+                      fib(value));
+        }
+    } else if (client->state == STATE_WRITING && sscanf(reply, "UPDATED FROM %d TO %d", &old_value, &value) == 2) {
+        if (!quiet) {
+            log_write(LOG_INFO, "Writer[%d]: updated DB[%d] from %d to %d\n", client->id, client->index, old_value,
+                      value);
+        }
+    } else if (!quiet) {
+        log_write(LOG_INFO, "%s[%d] received: %s\n", client->role == ROLE_READER ? "Reader" : "Writer", client->id,
+                  reply);
+    }
+    client_sleep(engine, client);
+}
+
+int socket_flush(Engine *engine, Socket *sock) {
+    FrameBuffer *out = &sock->conn.out;
+    size_t sent = 0;
+    while (sent < out->len) {
+        ssize_t n = send(sock->conn.chan.fd, out->data + sent, out->len - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;
+            }
+            return -1;
+        }
+        sent += n;
+    }
+    memmove(out->data, out->data + sent, out->len - sent);
+    out->len -= sent;
+    int want_write = out->len > 0;
+    if (want_write != sock->want_write) {
+        struct epoll_event event = {EPOLLIN | (want_write ? EPOLLOUT : 0), {.ptr = sock}};
+        epoll_ctl(engine->epoll_fd, EPOLL_CTL_MOD, sock->conn.chan.fd, &event);
+        sock->want_write = want_write;
+    }
+    return 0;
+}
+
+int socket_read(Engine *engine, Socket *sock) {
+    char reply[CONN_MAX_FRAME];
+    while (1) {
+        ssize_t n = conn_fill(&sock->conn);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+            return -1;
+        }
+        int status;
+        while ((status = conn_next_frame(&sock->conn, reply, sizeof(reply))) > 0) {
+            if (sock->head == sock->tail) {
+                return -1;
+            }
+            client_reply(engine, sock->pending[sock->head++ % sock->cap], reply);
+        }
+        if (status < 0) {
+            return -1;
+        }
+        if (n < 0) {
+            return 0;
+        }
+    }
+}
+
+int socket_open(Engine *engine, Socket *sock, unsigned cap) {
+    Channel chan;
+    if (channel_connect(&chan, server_uri) < 0) {
+        return -1;
+    }
+    if (chan.shm) {
+        fprintf(stderr, "Async client supports tcp:// and unix:// only\n");
+        channel_close(&chan);
+        return -1;
+    }
+    if (channel_send_all(&chan, "WRITER\n", 7) < 0) {
+        perror("Handshake send failed");
+        channel_close(&chan);
+        return -1;
+    }
+    fcntl(chan.fd, F_SETFL, fcntl(chan.fd, F_GETFL) | O_NONBLOCK);
+    conn_init(&sock->conn, &chan);
+    sock->pending = malloc(sizeof(VirtualClient *) * cap);
+    sock->cap = cap;
+    sock->head = 0;
+    sock->tail = 0;
+    sock->want_write = 0;
+    struct epoll_event event = {EPOLLIN, {.ptr = sock}};
+    if (!sock->pending || epoll_ctl(engine->epoll_fd, EPOLL_CTL_ADD, chan.fd, &event) < 0) {
+        perror("Socket setup failed");
+        channel_close(&chan);
+        return -1;
+    }
+    return 0;
+}
+
+void *engine_run(void *arg) {
+    Engine *engine = arg;
+    struct epoll_event events[MAX_EVENTS];
+    for (int i = 0; i < engine->client_count; ++i) {
+        client_sleep(engine, &engine->clients[i]);
+    }
+    while (1) {
+        long now = now_us();
+        while (engine->timer_count > 0 && engine->timers[0]->wake_us <= now) {
+            client_issue(engine, timer_pop(engine));
+        }
+        for (int i = 0; i < engine->socket_count; ++i) {
+            if (engine->sockets[i].conn.out.len > 0 && socket_flush(engine, &engine->sockets[i]) < 0) {
+                perror("send() failed");
+                exit(EXIT_FAILURE);
+            }
+        }
+        int timeout = -1;
+        if (engine->timer_count > 0) {
+            timeout = (engine->timers[0]->wake_us - now_us() + 999) / 1000;
+            timeout = timeout < 0 ? 0 : timeout;
+        }
+        int n = epoll_wait(engine->epoll_fd, events, MAX_EVENTS, timeout);
+        for (int i = 0; i < n; ++i) {
+            Socket *sock = events[i].data.ptr;
+            if ((events[i].events & EPOLLOUT) && socket_flush(engine, sock) < 0) {
+                perror("send() failed");
+                exit(EXIT_FAILURE);
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && socket_read(engine, sock) < 0) {
+                fprintf(stderr, "Server closed connection\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = 1;
+    int sockets = 1;
+    int log_mode = LOG_ASYNC;
+    int log_level = LOG_INFO;
+    static struct option options[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"sockets", required_argument, NULL, 's'},
+        {"think-ms", required_argument, NULL, 'k'},
+        {"quiet", no_argument, NULL, 'q'},
+        {"log", required_argument, NULL, 'o'},
+        {"log-level", required_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt_char;
+    while ((opt_char = getopt_long(argc, argv, "t:s:k:qo:v:", options, NULL)) != -1) {
+        switch (opt_char) {
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 's':
+                sockets = atoi(optarg);
+                break;
+            case 'k': {
+                long min_ms, max_ms;
+                int fields = sscanf(optarg, "%ld-%ld", &min_ms, &max_ms);
+                think_min_us = min_ms * 1000;
+                think_max_us = (fields == 2 ? max_ms : min_ms) * 1000;
+                break;
+            }
+            case 'q':
+                quiet = 1;
+                break;
+            case 'o':
+                if ((log_mode = log_parse_mode(optarg)) < 0) {
+                    threads = 0;
+                }
+                break;
+            case 'v':
+                if ((log_level = log_parse_level(optarg)) < 0) {
+                    threads = 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    int positional = argc - optind;
+    if ((positional != 3 && positional != 4) || threads < 1 || sockets < threads || think_max_us < think_min_us) {
+        fprintf(stderr,
+                "Usage: %s <server_ip> <port> <num_readers> <num_writers> [--threads <n>] [--sockets <n>] "
+                "[--think-ms <min>[-<max>]] [--quiet] [--log sync|async|binary] [--log-level <level>]\n"
+                "       %s <uri> <num_readers> <num_writers> [options]\n",
+                argv[0], argv[0]);
+        return -1;
+    }
+    char uri[256];
+    if (positional == 4) {
+        snprintf(uri, sizeof(uri), "tcp://%s:%s", argv[optind], argv[optind + 1]);
+    } else {
+        snprintf(uri, sizeof(uri), "%s", argv[optind]);
+    }
+    server_uri = uri;
+    int readers = atoi(argv[argc - 2]);
+    int writers = atoi(argv[argc - 1]);
+    int total = readers + writers;
+
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    log_init(log_mode, log_level);
+
+    Engine *engines = calloc(threads, sizeof(Engine));
+    VirtualClient *clients = calloc(total, sizeof(VirtualClient));
+    if (!engines || !clients) {
+        fprintf(stderr, "Memory allocation error\n");
+        return -1;
+    }
+    for (int e = 0; e < threads; ++e) {
+        Engine *engine = &engines[e];
+        engine->seed = time(NULL) ^ (e * 2654435761u);
+        engine->epoll_fd = epoll_create1(0);
+        engine->socket_count = sockets / threads + (e < sockets % threads);
+        engine->sockets = calloc(engine->socket_count, sizeof(Socket));
+        engine->clients = clients + (long)total * e / threads;
+        engine->client_count = (long)total * (e + 1) / threads - (long)total * e / threads;
+        engine->timers = malloc(sizeof(VirtualClient *) * (engine->client_count + 1));
+        if (engine->epoll_fd < 0 || !engine->sockets || !engine->timers) {
+            perror("Engine setup failed");
+            return -1;
+        }
+        unsigned cap = engine->client_count / engine->socket_count + 1;
+        for (int s = 0; s < engine->socket_count; ++s) {
+            if (socket_open(engine, &engine->sockets[s], cap) < 0) {
+                return -1;
+            }
+        }
+        for (int i = 0; i < engine->client_count; ++i) {
+            VirtualClient *client = &engine->clients[i];
+            int id = client - clients;
+            client->role = id < readers ? ROLE_READER : ROLE_WRITER;
+            client->id = id < readers ? id + 1 : id - readers + 1;
+            client->sock = &engine->sockets[i % engine->socket_count];
+        }
+    }
+    log_write(LOG_INFO, "Connected to server: %d readers, %d writers on %d threads, %d sockets.\n", readers, writers,
+              threads, sockets);
+
+    for (int e = 0; e < threads; ++e) {
+        if (pthread_create(&engines[e].tid, NULL, engine_run, &engines[e]) != 0) {
+            fprintf(stderr, "Error creating engine thread\n");
+            return -1;
+        }
+    }
+    long last = 0;
+    struct timespec interval = {1, 0};
+    while (sigtimedwait(&stop_signals, NULL, &interval) < 0) {
+        long current = __atomic_load_n(&completed, __ATOMIC_RELAXED);
+        if (quiet) {
+            log_write(LOG_INFO, "requests/s: %ld\n", current - last);
+            fflush(stdout);
+        }
+        last = current;
+    }
+    log_write(LOG_INFO, "Terminating async clients...\n");
+    exit(0);
+}
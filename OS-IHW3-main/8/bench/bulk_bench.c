@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../dbclient.h"
+
+#define REQUEST_TIMEOUT_MS 10000
+#define MAX_BATCH 100000
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <uri> <db_size> <updates>\n", argv[0]);
+        return -1;
+    }
+    const char *uri = argv[1];
+    int db_size = atoi(argv[2]);
+    long updates = atol(argv[3]);
+    if (db_size <= 0 || updates <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+    DbClient *client = db_client_open(uri, "WRITER", 1);
+    if (!client) {
+        return -1;
+    }
+    int *indices = malloc(sizeof(int) * MAX_BATCH);
+    int *values = malloc(sizeof(int) * MAX_BATCH);
+    unsigned seed = 1;
+    for (int i = 0; i < MAX_BATCH; ++i) {
+        indices[i] = rand_r(&seed) % db_size;
+        values[i] = i;
+    }
+
+    double started = now_us();
+    for (long i = 0; i < updates; ++i) {
+        int old_value;
+        if (db_write(client, indices[i % MAX_BATCH], i, &old_value, REQUEST_TIMEOUT_MS) != DB_OK) {
+            fprintf(stderr, "Write failed\n");
+            return -1;
+        }
+    }
+    double write_us = (now_us() - started) / updates;
+    printf("write per_update_us=%.3f\n", write_us);
+
+    double batch_us[6];
+    int batch = 1;
+    for (int step = 0; step < 6; ++step, batch *= 10) {
+        long done = 0;
+        started = now_us();
+        do {
+            int written;
+            if (db_bulk_write(client, indices, values, batch, &written, REQUEST_TIMEOUT_MS) != DB_OK) {
+                fprintf(stderr, "Bulk write failed\n");
+                return -1;
+            }
+            done += batch;
+        } while (done < updates);
+        batch_us[step] = (now_us() - started) / done;
+        printf("bulk batch=%d updates=%ld per_update_us=%.3f\n", batch, done, batch_us[step]);
+    }
+    printf("db_size=%d write_us=%.3f bulk1_us=%.3f bulk100_us=%.3f bulk10k_us=%.3f bulk100k_us=%.3f speedup=%.1f\n",
+           db_size, write_us, batch_us[0], batch_us[2], batch_us[4], batch_us[5], write_us / batch_us[5]);
+    free(indices);
+    free(values);
+    db_client_close(client);
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../dbclient.h"
+
+#define REQUEST_TIMEOUT_MS 1000
+#define READERS_PER_CONNECTION 4
+#define ZIPF_EXPONENT 0.99
+#define FIRST_WRITE_VALUE 1000000
+
+typedef struct {
+    DbClient *client;
+    unsigned long seed;
+    long reads;
+    long max_stale_us;
+} ReadThread;
+
+static double *zipf_cdf;
+static int db_size;
+static volatile int running;
+static long *acked_us;
+static int *acked_value;
+
+static long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static double next_uniform(unsigned long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int next_index(unsigned long *state) {
+    double u = next_uniform(state);
+    int low = 0, high = db_size - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (zipf_cdf[mid] < u) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void *read_loop(void *arg) {
+    ReadThread *thread = arg;
+    while (running) {
+        int index = next_index(&thread->seed);
+        long started = now_us();
+        int value;
+        if (db_read(thread->client, index, &value, REQUEST_TIMEOUT_MS) != DB_OK) {
+            continue;
+        }
+        ++thread->reads;
+        int newest = __atomic_load_n(&acked_value[index], __ATOMIC_ACQUIRE);
+        long newest_us = __atomic_load_n(&acked_us[index], __ATOMIC_ACQUIRE);
+        if (value < newest && newest_us < started && started - newest_us > thread->max_stale_us) {
+            thread->max_stale_us = started - newest_us;
+        }
+    }
+    return NULL;
+}
+
+static long server_admitted(DbClient *client) {
+    char reply[DB_REPLY_SIZE];
+    const char *field;
+    if (db_call(client, "STATS", reply, sizeof(reply), REQUEST_TIMEOUT_MS) != DB_OK ||
+        !(field = strstr(reply, "admitted="))) {
+        return -1;
+    }
+    return atol(field + strlen("admitted="));
+}
+
+static int run_phase(const char *uri, int readers, int seconds, int writes_per_sec, int cache, DbClient *writer,
+                     double *reads_per_sec, double *server_per_sec, double *hit_rate, long *invalidations,
+                     double *max_stale_ms) {
+    DbClient *client = db_client_open(uri, "READER", (readers + READERS_PER_CONNECTION - 1) / READERS_PER_CONNECTION);
+    if (!client) {
+        return -1;
+    }
+    if (cache && db_client_enable_cache(client) != DB_OK) {
+        db_client_close(client);
+        return -1;
+    }
+    usleep(100000);
+    ReadThread *threads = calloc(readers, sizeof(ReadThread));
+    pthread_t *tids = malloc(sizeof(pthread_t) * readers);
+    unsigned long writer_seed = 0x9e3779b97f4a7c15UL;
+    static int next_value = FIRST_WRITE_VALUE;
+    long admitted = server_admitted(writer);
+    long started = now_us();
+    running = 1;
+    for (int i = 0; i < readers; ++i) {
+        threads[i].client = client;
+        threads[i].seed = 0x2545f4914f6cdd1dUL * (i + 1);
+        pthread_create(&tids[i], NULL, read_loop, &threads[i]);
+    }
+    long deadline = started + seconds * 1000000L;
+    long interval_us = writes_per_sec > 0 ? 1000000L / writes_per_sec : 0;
+    for (long next_write = started; now_us() < deadline;) {
+        if (interval_us == 0) {
+            usleep(10000);
+            continue;
+        }
+        int index = next_index(&writer_seed);
+        int old_value;
+        if (db_write(writer, index, ++next_value, &old_value, REQUEST_TIMEOUT_MS) == DB_OK) {
+            __atomic_store_n(&acked_us[index], now_us(), __ATOMIC_RELEASE);
+            __atomic_store_n(&acked_value[index], next_value, __ATOMIC_RELEASE);
+        }
+        next_write += interval_us;
+        long delay = next_write - now_us();
+        if (delay > 0) {
+            usleep(delay);
+        }
+    }
+    running = 0;
+    long reads = 0, max_stale_us = 0;
+    for (int i = 0; i < readers; ++i) {
+        pthread_join(tids[i], NULL);
+        reads += threads[i].reads;
+        if (threads[i].max_stale_us > max_stale_us) {
+            max_stale_us = threads[i].max_stale_us;
+        }
+    }
+    double elapsed = (now_us() - started) / 1e6;
+    DbClientStats stats;
+    db_client_stats(client, &stats);
+    *reads_per_sec = reads / elapsed;
+    *server_per_sec = (server_admitted(writer) - admitted) / elapsed;
+    long lookups = stats.cache_hits + stats.cache_misses;
+    *hit_rate = lookups ? 100.0 * stats.cache_hits / lookups : 0;
+    *invalidations = stats.invalidations;
+    *max_stale_ms = max_stale_us / 1000.0;
+    db_client_close(client);
+    free(tids);
+    free(threads);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 6) {
+        fprintf(stderr, "Usage: %s <uri> <db_size> <readers> <seconds> <writes_per_sec>\n", argv[0]);
+        return -1;
+    }
+    const char *uri = argv[1];
+    db_size = atoi(argv[2]);
+    int readers = atoi(argv[3]);
+    int seconds = atoi(argv[4]);
+    int writes_per_sec = atoi(argv[5]);
+    if (db_size <= 0 || readers <= 0 || seconds <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+
+    zipf_cdf = malloc(sizeof(double) * db_size);
+    acked_us = calloc(db_size, sizeof(long));
+    acked_value = calloc(db_size, sizeof(int));
+    double total = 0;
+    for (int i = 0; i < db_size; ++i) {
+        total += 1.0 / pow(i + 1, ZIPF_EXPONENT);
+        zipf_cdf[i] = total;
+    }
+    for (int i = 0; i < db_size; ++i) {
+        zipf_cdf[i] /= total;
+    }
+    DbClient *writer = db_client_open(uri, "WRITER", 1);
+    if (!writer) {
+        return -1;
+    }
+
+    double base_reads, base_server, base_hits, reads, server, hit_rate, base_stale, max_stale;
+    long base_invalidations, invalidations;
+    if (run_phase(uri, readers, seconds, writes_per_sec, 0, writer, &base_reads, &base_server, &base_hits,
+                  &base_invalidations, &base_stale) < 0 ||
+        run_phase(uri, readers, seconds, writes_per_sec, 1, writer, &reads, &server, &hit_rate, &invalidations,
+                  &max_stale) < 0) {
+        db_client_close(writer);
+        return -1;
+    }
+    db_client_close(writer);
+    double base_per_read = base_reads > 0 ? base_server / base_reads : 0;
+    double per_read = reads > 0 ? server / reads : 0;
+    printf("nocache readers=%d reads=%.0f/s server_requests=%.0f/s server_per_read=%.3f\n", readers, base_reads,
+           base_server, base_per_read);
+    printf("cache readers=%d db_size=%d writes=%d/s hit_rate=%.1f%% reads=%.0f/s server_requests=%.0f/s "
+           "server_per_read=%.3f load_reduction=%.1f%% invalidations=%ld max_stale_ms=%.1f\n",
+           readers, db_size, writes_per_sec, hit_rate, reads, server, per_read,
+           base_per_read > 0 ? 100.0 * (1 - per_read / base_per_read) : 0.0, invalidations, max_stale);
+    free(zipf_cdf);
+    free(acked_us);
+    free(acked_value);
+    return 0;
+}
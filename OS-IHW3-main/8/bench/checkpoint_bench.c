@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "../checkpoint.h"
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static long rss_kb(void) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) {
+        return -1;
+    }
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmRSS: %ld kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <data_dir> <entries> <log_entries>\n", argv[0]);
+        return -1;
+    }
+    const char *dir = argv[1];
+    size_t size = strtoul(argv[2], NULL, 10);
+    long log_entries = atol(argv[3]);
+    long page_entries = sysconf(_SC_PAGESIZE) / sizeof(int);
+
+    int *db = NULL;
+    if (checkpoint_load(dir, &db, &size) != 0) {
+        fprintf(stderr, "Data dir %s must be empty\n", dir);
+        return -1;
+    }
+    db = malloc(size * sizeof(int));
+    if (!db) {
+        perror("malloc failed");
+        return -1;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        db[i] = i + 1;
+    }
+    if (checkpoint_replay(db, size) < 0 || checkpoint_log_open() < 0) {
+        return -1;
+    }
+    long rss_before = rss_kb();
+
+    double start = now_ms();
+    pid_t pid = checkpoint_fork(db, size);
+    double forked = now_ms();
+    if (pid < 0) {
+        return -1;
+    }
+
+    char *dirty = calloc(size / page_entries + 1, 1);
+    long writes = 0;
+    long dirty_pages = 0;
+    srand(1);
+    while (waitpid(pid, NULL, WNOHANG) == 0) {
+        size_t index = ((size_t)rand() * RAND_MAX + rand()) % size;
+        db[index] = rand();
+        checkpoint_log(index, db[index]);
+        if (!dirty[index / page_entries]) {
+            dirty[index / page_entries] = 1;
+            ++dirty_pages;
+        }
+        ++writes;
+    }
+    double done = now_ms();
+    long rss_after = rss_kb();
+
+    for (long i = 0; i < log_entries; ++i) {
+        size_t index = ((size_t)rand() * RAND_MAX + rand()) % size;
+        db[index] = rand();
+        checkpoint_log(index, db[index]);
+    }
+    checkpoint_close();
+
+    printf("entries: %zu\n", size);
+    printf("checkpoint_pause_ms: %.3f\n", forked - start);
+    printf("checkpoint_duration_ms: %.3f\n", done - start);
+    printf("writes_during_checkpoint: %ld\n", writes);
+    printf("cow_overhead_kb: %ld\n", dirty_pages * page_entries * (long)sizeof(int) / 1024);
+    printf("parent_rss_kb: %ld -> %ld\n", rss_before, rss_after);
+
+    int *restored = NULL;
+    size_t restored_size = 0;
+    start = now_ms();
+    if (checkpoint_load(dir, &restored, &restored_size) != 1) {
+        fprintf(stderr, "Checkpoint not found\n");
+        return -1;
+    }
+    double loaded = now_ms();
+    long replayed = checkpoint_replay(restored, restored_size);
+    done = now_ms();
+
+    printf("restart_load_ms: %.3f\n", loaded - start);
+    printf("restart_replay_ms: %.3f (%ld entries)\n", done - loaded, replayed);
+    printf("restart_total_ms: %.3f\n", done - start);
+    printf("consistent: %s\n", memcmp(db, restored, size * sizeof(int)) == 0 ? "yes" : "no");
+    return 0;
+}
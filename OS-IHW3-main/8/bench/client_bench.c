@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../dbclient.h"
+
+typedef struct {
+    const char *uri;
+    DbClient *client;
+    double deadline;
+    long requests;
+    long failures;
+} BenchThread;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *run(void *arg) {
+    BenchThread *bench = arg;
+    int value;
+    while (now_us() < bench->deadline) {
+        DbClient *client = bench->client ? bench->client : db_client_open(bench->uri, "READER", 1);
+        if (!client || db_read(client, bench->requests % 10, &value, 1000) != DB_OK) {
+            ++bench->failures;
+        } else {
+            ++bench->requests;
+        }
+        if (client && client != bench->client) {
+            db_client_close(client);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 5) {
+        fprintf(stderr, "Usage: %s <uri> <threads> <connections, 0 = connect per request> <seconds>\n", argv[0]);
+        return -1;
+    }
+    int threads = atoi(argv[2]);
+    int connections = atoi(argv[3]);
+    double seconds = atof(argv[4]);
+    DbClient *client = NULL;
+    if (connections > 0 && !(client = db_client_open(argv[1], "READER", connections))) {
+        return -1;
+    }
+    BenchThread benches[threads];
+    pthread_t tids[threads];
+    double start = now_us();
+    for (int i = 0; i < threads; ++i) {
+        benches[i] = (BenchThread){argv[1], client, start + seconds * 1e6, 0, 0};
+        pthread_create(&tids[i], NULL, run, &benches[i]);
+    }
+    long requests = 0, failures = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+        requests += benches[i].requests;
+        failures += benches[i].failures;
+    }
+    double elapsed = (now_us() - start) / 1e6;
+    printf("%s threads=%d connections=%d req/s=%.0f failures=%ld\n", argv[1], threads, connections,
+           requests / elapsed, failures);
+    if (client) {
+        db_client_close(client);
+    }
+    return 0;
+}
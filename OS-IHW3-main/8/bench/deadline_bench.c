@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../dbclient.h"
+#include "../frame.h"
+
+#define MAX_CONNECTIONS 64
+#define SEND_BATCH 256
+#define PACE_US 1000
+#define RING_SIZE (1 << 20)
+#define DRAIN_SECONDS 3
+
+typedef struct {
+    Channel chan;
+    int deadlines;
+    long rate;
+    long timeout_us;
+    double *sent_at;
+    long sent;
+    long received;
+    long good;
+    long expired;
+} LoadConn;
+
+static volatile int sending;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *send_loop(void *arg) {
+    LoadConn *load = arg;
+    char out[SEND_BATCH * 64];
+    double started = now_us();
+    while (sending) {
+        long due = (long)((now_us() - started) * load->rate / 1e6);
+        if (due - load->sent > SEND_BATCH) {
+            due = load->sent + SEND_BATCH;
+        }
+        size_t used = 0;
+        double now = now_us();
+        for (; load->sent < due && load->sent - __atomic_load_n(&load->received, __ATOMIC_ACQUIRE) < RING_SIZE;
+             ++load->sent) {
+            char request[64];
+            int len = load->deadlines ? snprintf(request, sizeof(request), "DEADLINE %ld WRITE %ld %ld",
+                                                 load->timeout_us, load->sent % 10, load->sent)
+                                      : snprintf(request, sizeof(request), "WRITE %ld %ld", load->sent % 10, load->sent);
+            memcpy(out + used, &len, sizeof(int));
+            memcpy(out + used + sizeof(int), request, len);
+            used += sizeof(int) + len;
+            load->sent_at[load->sent % RING_SIZE] = now;
+        }
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        if (used > 0 && channel_send_all(&load->chan, out, used) < 0) {
+            break;
+        }
+        if (load->sent >= due) {
+            usleep(PACE_US);
+        }
+    }
+    return NULL;
+}
+
+static void *receive_loop(void *arg) {
+    LoadConn *load = arg;
+    char reply[DB_REPLY_SIZE];
+    while (recv_frame(&load->chan, reply, sizeof(reply)) >= 0) {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        double latency = now_us() - load->sent_at[load->received % RING_SIZE];
+        int count = 1;
+        if (strncmp(reply, "EXPIRED", 7) == 0) {
+            sscanf(reply, "EXPIRED %d", &count);
+            load->expired += count;
+        } else if (strncmp(reply, "UPDATED", 7) == 0 && latency <= load->timeout_us) {
+            ++load->good;
+        }
+        __atomic_store_n(&load->received, load->received + count, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static int run_phase(const char *uri, int connections, int seconds, long rate, long timeout_us, int deadlines,
+                     double *goodput, double *expired_per_sec) {
+    LoadConn loads[MAX_CONNECTIONS] = {{{0}}};
+    pthread_t senders[MAX_CONNECTIONS], receivers[MAX_CONNECTIONS];
+    for (int i = 0; i < connections; ++i) {
+        LoadConn *load = &loads[i];
+        load->deadlines = deadlines;
+        load->rate = rate / connections;
+        load->timeout_us = timeout_us;
+        load->sent_at = malloc(sizeof(double) * RING_SIZE);
+        if (!load->sent_at || channel_connect(&load->chan, uri) < 0 ||
+            channel_send_all(&load->chan, "WRITER\n", 7) < 0) {
+            fprintf(stderr, "Failed to open connection %d\n", i);
+            return -1;
+        }
+    }
+    sending = 1;
+    for (int i = 0; i < connections; ++i) {
+        pthread_create(&receivers[i], NULL, receive_loop, &loads[i]);
+        pthread_create(&senders[i], NULL, send_loop, &loads[i]);
+    }
+    sleep(seconds);
+    sending = 0;
+    for (int i = 0; i < connections; ++i) {
+        pthread_join(senders[i], NULL);
+    }
+    sleep(DRAIN_SECONDS);
+    long sent = 0, good = 0, expired = 0;
+    for (int i = 0; i < connections; ++i) {
+        channel_shutdown(&loads[i].chan);
+        pthread_join(receivers[i], NULL);
+        channel_close(&loads[i].chan);
+        sent += loads[i].sent;
+        good += loads[i].good;
+        expired += loads[i].expired;
+        free(loads[i].sent_at);
+    }
+    *goodput = (double)good / seconds;
+    *expired_per_sec = (double)expired / seconds;
+    printf("deadlines=%d offered=%.0f/s goodput=%.0f/s expired=%.0f/s\n", deadlines, (double)sent / seconds,
+           *goodput, *expired_per_sec);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 6) {
+        fprintf(stderr, "Usage: %s <uri> <connections> <seconds> <rate> <timeout_ms>\n", argv[0]);
+        return -1;
+    }
+    const char *uri = argv[1];
+    int connections = atoi(argv[2]);
+    int seconds = atoi(argv[3]);
+    long rate = atol(argv[4]);
+    long timeout_us = atol(argv[5]) * 1000;
+    if (connections <= 0 || connections > MAX_CONNECTIONS || seconds <= 0 || rate <= 0 || timeout_us <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+    double plain_goodput, goodput, plain_expired, expired;
+    if (run_phase(uri, connections, seconds, rate, timeout_us, 0, &plain_goodput, &plain_expired) < 0 ||
+        run_phase(uri, connections, seconds, rate, timeout_us, 1, &goodput, &expired) < 0) {
+        return -1;
+    }
+    printf("connections=%d rate=%ld timeout_ms=%ld plain_goodput=%.0f/s deadline_goodput=%.0f/s expired=%.0f/s\n",
+           connections, rate, timeout_us / 1000, plain_goodput, goodput, expired);
+    return 0;
+}
@@ -0,0 +1,182 @@
+#!/bin/sh
+# Usage: e2e.sh <build_dir> <results.json> [baseline.json]
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <build_dir> <results.json> [baseline.json]" >&2
+    exit 1
+fi
+BIN=$1
+OUT=$2
+BASELINE=$3
+HOST=127.0.0.1
+PORT=${E2E_PORT:-19380}
+SECONDS_PER_RUN=${E2E_SECONDS:-3}
+WORK=$(mktemp -d)
+SERVER_PID=
+
+stop_server() {
+    if [ -n "$SERVER_PID" ]; then
+        kill -INT "$SERVER_PID" 2>/dev/null
+        wait "$SERVER_PID" 2>/dev/null
+        SERVER_PID=
+    fi
+}
+
+trap 'stop_server; rm -rf "$WORK"' EXIT
+
+start_binary() {
+    PORT=$((PORT + 1))
+    SERVER_BINARY=$1
+    shift
+    stdbuf -oL "$SERVER_BINARY" "$@" $HOST $PORT >"$WORK/server.log" 2>&1 &
+    SERVER_PID=$!
+    for i in 1 2 3 4 5 6 7 8 9 10; do
+        if grep -q "Server listening" "$WORK/server.log"; then
+            return 0
+        fi
+        sleep 0.2
+    done
+    echo "server failed to start" >&2
+    cat "$WORK/server.log" >&2
+    exit 1
+}
+
+start_server() {
+    start_binary "$BIN/server" "$@"
+}
+
+# Turns "a=1 b=2.5/s c=3%" into "\"a\": 1, \"b\": 2.5, \"c\": 3".
+to_json() {
+    tr ' ' '\n' | awk -F= 'NF == 2 {
+        value = $2
+        sub(/\/s$/, "", value)
+        sub(/%$/, "", value)
+        if (value !~ /^-?[0-9.]+$/) {
+            value = "\"" value "\""
+        }
+        fields = fields (fields ? ", " : "") "\"" $1 "\": " value
+    } END { print fields }'
+}
+
+scenario() {
+    NAME=$1
+    shift
+    RESULT=$("$@" 2>"$WORK/$NAME.err" | tail -n 1 | to_json)
+    if [ -z "$RESULT" ]; then
+        echo "scenario $NAME failed" >&2
+        tail -n 20 "$WORK/$NAME.err" >&2
+        exit 1
+    fi
+    echo "{\"name\": \"$NAME\", $RESULT}" >>"$WORK/results"
+    echo "$NAME: $RESULT" >&2
+}
+
+"$BIN/micro_bench" 2000000 >>"$WORK/results" || exit 1
+scenario log_write "$BIN/log_bench" 4 200000 "$WORK/log.out"
+
+start_server
+URI=tcp://$HOST:$PORT
+scenario read_depth1 "$BIN/overload_bench" $URI 16 1 $SECONDS_PER_RUN
+scenario read_depth8 "$BIN/overload_bench" $URI 32 8 $SECONDS_PER_RUN
+scenario pool_shared "$BIN/client_bench" $URI 16 4 $SECONDS_PER_RUN
+scenario connect_per_request "$BIN/client_bench" $URI 4 0 $SECONDS_PER_RUN
+scenario fanout_tcp "$BIN/fanout_bench" $URI $SERVER_PID 10 tcp 20000 $SECONDS_PER_RUN
+stop_server
+
+start_server --slot-locks
+URI=tcp://$HOST:$PORT
+scenario slot_pool_shared "$BIN/client_bench" $URI 16 4 $SECONDS_PER_RUN
+stop_server
+
+start_server --size 1000
+URI=tcp://$HOST:$PORT
+scenario read_cache "$BIN/cache_bench" $URI 1000 8 $SECONDS_PER_RUN 200
+stop_server
+
+start_server --qos-slots 1
+URI=tcp://$HOST:$PORT
+scenario qos_flood "$BIN/qos_bench" $URI $SECONDS_PER_RUN 8
+stop_server
+
+start_server --codel-target 0 --max-inflight 0
+URI=tcp://$HOST:$PORT
+scenario deadline_overload "$BIN/deadline_bench" $URI 8 $SECONDS_PER_RUN 700000 20
+stop_server
+
+start_server --size 100000
+URI=tcp://$HOST:$PORT
+scenario bulk_write "$BIN/bulk_bench" $URI 100000 20000
+stop_server
+
+start_server --size 1000 --listen unix://$WORK/db.sock --max-connections 20000
+scenario watch_park "$BIN/watch_bench" unix://$WORK/db.sock $SERVER_PID 10000 1000 50
+stop_server
+
+start_server --udp-fanout
+URI=tcp://$HOST:$PORT
+scenario fanout_udp "$BIN/fanout_bench" $URI $SERVER_PID 10 udp 20000 $SECONDS_PER_RUN
+stop_server
+
+start_binary "$BIN/../4-5/server"
+scenario stage_4_5 "$BIN/stage_bench" $HOST $PORT 0 0 4 $SECONDS_PER_RUN
+stop_server
+
+start_binary "$BIN/../4-5/server_rwlock"
+scenario stage_4_5_rwlock "$BIN/stage_bench" $HOST $PORT 0 0 4 $SECONDS_PER_RUN
+stop_server
+
+start_binary "$BIN/../6-7/server"
+scenario stage_6_7 "$BIN/stage_bench" $HOST $PORT 1 0 4 $SECONDS_PER_RUN
+scenario stage_6_7_observer "$BIN/stage_bench" $HOST $PORT 1 1 4 $SECONDS_PER_RUN
+stop_server
+
+PORT=$((PORT + 1))
+scenario stage_4_5_prefork "$BIN/prefork_bench" "$BIN/../4-5/server" $PORT 4 8 $SECONDS_PER_RUN
+PORT=$((PORT + 1))
+
+start_server
+URI=tcp://$HOST:$PORT
+scenario soak "$BIN/soak_bench" $URI $SERVER_PID $((SECONDS_PER_RUN * 4)) 8 1
+stop_server
+
+PORT=$((PORT + 1))
+scenario recovery "$BIN/recovery_bench" "$BIN/server" $PORT 100 500 jitter
+
+awk 'BEGIN { print "[" } { printf "%s  %s", (NR > 1 ? ",\n" : ""), $0 } END { print "\n]" }' "$WORK/results" >"$OUT"
+echo "results written to $OUT" >&2
+
+if [ -n "$BASELINE" ] && [ -f "$BASELINE" ]; then
+    # One object per line in both files: compare every numeric field by name.
+    awk '
+        function parse(line, prefix,    n, parts, i, kv, name) {
+            gsub(/[{}\[\]]/, "", line)
+            n = split(line, parts, ", ")
+            name = ""
+            for (i = 1; i <= n; ++i) {
+                split(parts[i], kv, ": ")
+                gsub(/[" ,]/, "", kv[1])
+                gsub(/[" ,]/, "", kv[2])
+                if (kv[1] == "name") {
+                    name = kv[2]
+                } else if (name != "" && kv[2] ~ /^-?[0-9.]+$/) {
+                    keys[prefix, name "." kv[1]] = kv[2]
+                    order[prefix, ++count[prefix]] = name "." kv[1]
+                }
+            }
+        }
+        FNR == NR { parse($0, "base"); next }
+        { parse($0, "new") }
+        END {
+            printf "%-40s %14s %14s %8s\n", "metric", "baseline", "current", "change"
+            for (i = 1; i <= count["base"]; ++i) {
+                key = order["base", i]
+                if (!(("new", key) in keys)) {
+                    continue
+                }
+                base = keys["base", key]
+                cur = keys["new", key]
+                change = base != 0 ? sprintf("%+.1f%%", (cur - base) * 100 / base) : "n/a"
+                printf "%-40s %14s %14s %8s\n", key, base, cur, change
+            }
+        }' "$BASELINE" "$OUT"
+fi
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "../eventcodec.h"
+
+#define BLOCK_SIZE 12288
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <events>\n", argv[0]);
+        return -1;
+    }
+    long count = atol(argv[1]);
+    Event *events = malloc(sizeof(Event) * count);
+    long ts = event_now_us();
+    srand(1);
+    for (long i = 0; i < count; ++i) {
+        ts += rand() % 200;
+        int index = rand() % 10;
+        int value = rand() % 40;
+        if (i % 50 == 0) {
+            events[i] = (Event){EVENT_CONNECT, ts};
+        } else if (i % 3 == 0) {
+            events[i] = (Event){EVENT_UPDATE, ts, index, value, rand() % 40};
+        } else {
+            events[i] = (Event){EVENT_READ, ts, index, value};
+        }
+    }
+
+    char text[1024];
+    size_t text_bytes = 0;
+    double start = now_s();
+    for (long i = 0; i < count; ++i) {
+        text_bytes += sizeof(int) + event_format(&events[i], text, sizeof(text));
+    }
+    double text_s = now_s() - start;
+
+    static uint8_t block[BLOCK_SIZE + EVENT_MAX_ENCODED];
+    static uint8_t packed[BLOCK_SIZE * 2];
+    size_t binary_bytes = 0, zlib_bytes = 0;
+    double zlib_s = 0;
+    start = now_s();
+    size_t len = 0;
+    Event prev = {0};
+    for (long i = 0; i < count; ++i) {
+        len += event_encode(&events[i], &prev, block + len);
+        prev = events[i];
+        if (len >= BLOCK_SIZE || i == count - 1) {
+            binary_bytes += sizeof(int) + 1 + 20 + len;
+            double zlib_start = now_s();
+            uLongf packed_len = sizeof(packed);
+            compress2(packed, &packed_len, block, len, Z_BEST_SPEED);
+            zlib_s += now_s() - zlib_start;
+            zlib_bytes += sizeof(int) + 1 + 10 + packed_len;
+            len = 0;
+            prev = (Event){0};
+        }
+    }
+    double binary_s = now_s() - start - zlib_s;
+
+    Event decoded;
+    prev = (Event){0};
+    len = 0;
+    for (long i = 0; i < count && i < 1000; ++i) {
+        len += event_encode(&events[i], &prev, block + len);
+        prev = events[i];
+    }
+    prev = (Event){0};
+    for (size_t pos = 0, i = 0; pos < len; ++i) {
+        pos += event_decode(block + pos, len - pos, &prev, &decoded);
+        if (memcmp(&decoded, &events[i], sizeof(Event)) != 0) {
+            fprintf(stderr, "Round trip mismatch at %zu\n", i);
+            return -1;
+        }
+        prev = decoded;
+    }
+
+    printf("text:   %.1f bytes/event, %.0f ns/event\n", (double)text_bytes / count, text_s * 1e9 / count);
+    printf("binary: %.1f bytes/event, %.0f ns/event\n", (double)binary_bytes / count, binary_s * 1e9 / count);
+    printf("zlib:   %.1f bytes/event, %.0f ns/event\n", (double)zlib_bytes / count,
+           (binary_s + zlib_s) * 1e9 / count);
+    free(events);
+    return 0;
+}
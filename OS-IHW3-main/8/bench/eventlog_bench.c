@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "../eventlog.h"
+#include "../eventcodec.h"
+#include "../frame.h"
+
+typedef struct {
+    Channel chan;
+    unsigned long expected;
+    int frames;
+} Sink;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *drain(void *arg) {
+    Sink *sink = arg;
+    static char buffer[CONN_BUF_SIZE];
+    for (unsigned long i = 0; i < sink->expected;) {
+        int len = recv_frame(&sink->chan, buffer, sizeof(buffer));
+        if (len < 0) {
+            fprintf(stderr, "Catch-up stream ended early\n");
+            exit(EXIT_FAILURE);
+        }
+        if (sink->frames) {
+            ++i;
+        } else {
+            uint64_t first, count;
+            size_t used = varint_get((uint8_t *)buffer + 1, len - 1, &first);
+            i += buffer[0] == 'B' && varint_get((uint8_t *)buffer + 1 + used, len - 1 - used, &count) ? count : 0;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "Usage: %s <log_bytes> <events> [text|binary]\n", argv[0]);
+        return -1;
+    }
+    EventFormat format = argc == 4 && strcmp(argv[3], "binary") == 0 ? EVENTS_BINARY : EVENTS_TEXT_SEQ;
+    size_t log_bytes = strtoul(argv[1], NULL, 10);
+    long events = atol(argv[2]);
+    if (eventlog_open(NULL, log_bytes) < 0) {
+        return -1;
+    }
+
+    uint8_t record[EVENT_MAX_ENCODED];
+    double start = now_s();
+    for (long i = 0; i < events; ++i) {
+        Event event = {EVENT_UPDATE, event_now_us(), i % 10, i % 40, i % 37};
+        eventlog_append(record, event_encode(&event, NULL, record));
+    }
+    double append_s = now_s() - start;
+    unsigned long first = eventlog_first();
+    unsigned long retained = eventlog_next() - first;
+    printf("append: %.2fM events/s, retained %lu events in %zu bytes (%.1f bytes/event, %.1f with index)\n",
+           events / append_s / 1e6, retained, eventlog_used(), (double)eventlog_used() / retained,
+           (double)eventlog_used() / retained + sizeof(unsigned long) * (double)(log_bytes / 16 + 1) / retained);
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair() failed");
+        return -1;
+    }
+    Sink sink = {{fds[1], NULL, 0}, retained};
+    sink.frames = format == EVENTS_TEXT_SEQ;
+    pthread_t tid;
+    pthread_create(&tid, NULL, drain, &sink);
+    static FrameBuffer out;
+    unsigned long cursor = first;
+    start = now_s();
+    while (cursor < first + retained) {
+        out.len = 0;
+        eventlog_read(&cursor, &out, format);
+        if (send_all(fds[0], out.data, out.len) < 0) {
+            perror("send() failed");
+            return -1;
+        }
+    }
+    pthread_join(tid, NULL);
+    double catchup_s = now_s() - start;
+    printf("catch-up: %.2fM events/s (%lu events in %.1f ms)\n", retained / catchup_s / 1e6, retained,
+           catchup_s * 1e3);
+    eventlog_close();
+    return 0;
+}
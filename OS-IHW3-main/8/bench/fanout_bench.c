@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "../frame.h"
+#include "../udpfan.h"
+
+typedef struct {
+    int fd;
+    int udp;
+    int header_len;
+    int remaining;
+    char header[sizeof(int)];
+} Sink;
+
+static long delivered;
+static volatile int running = 1;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double process_cpu_s(int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    unsigned long utime = 0, stime = 0;
+    if (fscanf(f, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+        utime = stime = 0;
+    }
+    fclose(f);
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static void count_stream(Sink *sink, const char *data, ssize_t n) {
+    for (ssize_t pos = 0; pos < n;) {
+        if (sink->remaining > 0) {
+            ssize_t take = n - pos < sink->remaining ? n - pos : sink->remaining;
+            sink->remaining -= take;
+            pos += take;
+            continue;
+        }
+        sink->header[sink->header_len++] = data[pos++];
+        if (sink->header_len == sizeof(int)) {
+            memcpy(&sink->remaining, sink->header, sizeof(int));
+            sink->header_len = 0;
+            ++delivered;
+        }
+    }
+}
+
+static void *drain(void *arg) {
+    int epoll_fd = *(int *)arg;
+    struct epoll_event events[64];
+    static char buffer[65536];
+    while (running) {
+        int n = epoll_wait(epoll_fd, events, 64, 100);
+        for (int i = 0; i < n; ++i) {
+            Sink *sink = events[i].data.ptr;
+            ssize_t len;
+            while ((len = recv(sink->fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+                if (sink->udp) {
+                    delivered += ((UdpEventHeader *)buffer)->count;
+                } else {
+                    count_stream(sink, buffer, len);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+static int open_observer(const char *uri, int udp, int epoll_fd, Sink *sink) {
+    Channel chan;
+    if (channel_connect(&chan, uri) < 0) {
+        return -1;
+    }
+    char handshake[64];
+    sink->fd = chan.fd;
+    sink->udp = udp;
+    if (udp) {
+        struct sockaddr_in addr = {0};
+        socklen_t addr_len = sizeof(addr);
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        sink->fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sink->fd < 0 || bind(sink->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+            getsockname(sink->fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+            perror("UDP socket setup failed");
+            return -1;
+        }
+        snprintf(handshake, sizeof(handshake), "OBSERVER UDP %d\n", ntohs(addr.sin_port));
+    } else {
+        snprintf(handshake, sizeof(handshake), "OBSERVER FROM 0\n");
+    }
+    if (channel_send_all(&chan, handshake, strlen(handshake)) < 0) {
+        return -1;
+    }
+    struct epoll_event event = {EPOLLIN, {.ptr = sink}};
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sink->fd, &event);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 7) {
+        fprintf(stderr, "Usage: %s <uri> <server_pid> <observers> <tcp|udp> <events_per_sec> <seconds>\n", argv[0]);
+        return -1;
+    }
+    const char *uri = argv[1];
+    int server_pid = atoi(argv[2]);
+    int observers = atoi(argv[3]);
+    int udp = strcmp(argv[4], "udp") == 0;
+    int rate = atoi(argv[5]);
+    double seconds = atof(argv[6]);
+
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    int epoll_fd = epoll_create1(0);
+    Sink *sinks = calloc(observers, sizeof(Sink));
+    for (int i = 0; i < observers; ++i) {
+        if (open_observer(uri, udp, epoll_fd, &sinks[i]) < 0) {
+            fprintf(stderr, "Observer %d failed to subscribe\n", i);
+            return -1;
+        }
+    }
+    pthread_t tid;
+    pthread_create(&tid, NULL, drain, &epoll_fd);
+
+    Channel writer;
+    char reply[1024];
+    if (channel_connect(&writer, uri) < 0 || channel_send_all(&writer, "WRITER\n", 7) < 0) {
+        return -1;
+    }
+    sleep(1);
+    delivered = 0;
+    long sent = 0;
+    double cpu_start = process_cpu_s(server_pid);
+    double start = now_s();
+    while (now_s() - start < seconds) {
+        double due = start + (double)sent / rate;
+        double wait = due - now_s();
+        if (wait > 0) {
+            struct timespec ts = {(time_t)wait, (long)((wait - (time_t)wait) * 1e9)};
+            nanosleep(&ts, NULL);
+        }
+        char request[64];
+        snprintf(request, sizeof(request), "WRITE %ld %ld", sent % 10, sent % 40);
+        if (send_frame(&writer, request) < 0 || recv_frame(&writer, reply, sizeof(reply)) < 0) {
+            fprintf(stderr, "Writer failed\n");
+            return -1;
+        }
+        ++sent;
+    }
+    double elapsed = now_s() - start;
+    double cpu = process_cpu_s(server_pid) - cpu_start;
+    sleep(1);
+    running = 0;
+    pthread_join(tid, NULL);
+    printf("%s observers=%d events/s=%.0f server_cpu=%.1f%% delivered=%.1f%%\n", udp ? "udp" : "tcp", observers,
+           sent / elapsed, 100 * cpu / elapsed, 100.0 * delivered / ((double)sent * observers));
+    return 0;
+}
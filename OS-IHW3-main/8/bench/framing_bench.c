@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../frame.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 5 && argc != 6) {
+        fprintf(stderr, "Usage: %s <server_ip> <port> <requests> <depth> [legacy]\n", argv[0]);
+        return -1;
+    }
+    const char *server_ip = argv[1];
+    int port = atoi(argv[2]);
+    long requests = atol(argv[3]);
+    int depth = atoi(argv[4]);
+    int legacy = argc == 6 && strcmp(argv[5], "legacy") == 0;
+    if (legacy) {
+        depth = 1;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in serv_addr;
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port);
+    if (sock < 0 || inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0 ||
+        connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+        perror("Connection failed");
+        return -1;
+    }
+    Channel chan;
+    channel_init(&chan, sock);
+    const char *handshake_message = legacy ? "READER" : "READER\n";
+    send(sock, handshake_message, strlen(handshake_message), 0);
+    usleep(100000);
+
+    char batch[65536];
+    char buffer[1024];
+    double start = now_sec();
+    for (long done = 0; done < requests; done += depth) {
+        size_t len = 0;
+        for (int i = 0; i < depth; ++i) {
+            char request[32];
+            int n = snprintf(request, sizeof(request), "READ %ld", (done + i) % 10);
+            memcpy(batch + len, &n, sizeof(int));
+            memcpy(batch + len + sizeof(int), request, n);
+            len += sizeof(int) + n;
+        }
+        if (send(sock, batch, len, 0) != (ssize_t)len) {
+            perror("send() failed");
+            return -1;
+        }
+        for (int i = 0; i < depth; ++i) {
+            int n = legacy ? recv(sock, buffer, sizeof(buffer) - 1, 0) : recv_frame(&chan, buffer, sizeof(buffer));
+            if (n <= 0) {
+                fprintf(stderr, "Receive failed\n");
+                return -1;
+            }
+        }
+    }
+    double elapsed = now_sec() - start;
+    printf("requests=%ld depth=%d%s req/s=%.0f avg_us=%.2f\n", requests, depth, legacy ? " legacy" : "",
+           requests / elapsed, elapsed * 1e6 / requests * depth);
+    close(sock);
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "../mvcc.h"
+#include "../txn.h"
+
+#define DB_SIZE 65536
+#define MAX_THREADS 64
+
+static int db[DB_SIZE];
+static sem_t db_sem;
+static sem_t writer_sem;
+static int slot_locks;
+static volatile int running;
+static long writes;
+
+static void *worker(void *arg) {
+    unsigned int seed = (unsigned long)arg;
+    long local_writes = 0;
+    while (running) {
+        int index = rand_r(&seed) % DB_SIZE;
+        int old_value;
+        if (!slot_locks) {
+            sem_wait(&writer_sem);
+            sem_wait(&db_sem);
+        }
+        txn_write_one(index, local_writes, &old_value);
+        if (!slot_locks) {
+            sem_post(&db_sem);
+            sem_post(&writer_sem);
+        }
+        ++local_writes;
+    }
+    __atomic_add_fetch(&writes, local_writes, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static double run(int threads, int seconds) {
+    pthread_t tids[MAX_THREADS];
+    writes = 0;
+    running = 1;
+    for (long i = 0; i < threads; ++i) {
+        pthread_create(&tids[i], NULL, worker, (void *)(i + 1));
+    }
+    sleep(seconds);
+    running = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    return (double)writes / seconds;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <seconds_per_point>\n", argv[0]);
+        return -1;
+    }
+    int seconds = atoi(argv[1]);
+    if (mvcc_init(db, DB_SIZE) < 0 || txn_init(db, DB_SIZE) < 0) {
+        return -1;
+    }
+    sem_init(&db_sem, 0, 1);
+    sem_init(&writer_sem, 0, 1);
+    printf("threads  global_writes/s  slot_writes/s\n");
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        slot_locks = 0;
+        double global = run(threads, seconds);
+        slot_locks = 1;
+        double slot = run(threads, seconds);
+        printf("%7d  %15.0f  %13.0f\n", threads, global, slot);
+    }
+    return 0;
+}
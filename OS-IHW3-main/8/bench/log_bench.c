@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "../log.h"
+
+#define MAX_THREADS 64
+
+typedef struct {
+    int id;
+    long messages;
+} LogThread;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *log_loop(void *arg) {
+    LogThread *thread = arg;
+    for (long i = 0; i < thread->messages; ++i) {
+        int index = i % 10;
+        log_write(LOG_INFO, "Reader[%d]: DB[%d] = %d, Fibonacci = %d\n", thread->id, index, index * 3, 832040);
+    }
+    return NULL;
+}
+
+static int run_mode(LogMode mode, int threads, long messages, const char *path, double *ops, double *bytes) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int saved = dup(STDOUT_FILENO);
+    if (fd < 0 || saved < 0) {
+        perror("open() failed");
+        return -1;
+    }
+    fflush(stdout);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+    log_init(mode, LOG_INFO);
+
+    LogThread bench[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    double started = now_us();
+    for (int i = 0; i < threads; ++i) {
+        bench[i].id = i + 1;
+        bench[i].messages = messages;
+        pthread_create(&tids[i], NULL, log_loop, &bench[i]);
+    }
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    double logged = now_us() - started;
+    log_shutdown();
+    fflush(stdout);
+    double flushed = now_us() - started;
+
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    struct stat st;
+    long total = (long)threads * messages;
+    *ops = total / (logged / 1e6);
+    *bytes = stat(path, &st) == 0 ? (double)st.st_size / total : -1;
+    printf("mode=%s ops/s=%.0f call_ns=%.1f flushed_ops/s=%.0f bytes_per_message=%.1f\n",
+           mode == LOG_SYNC ? "sync" : mode == LOG_ASYNC ? "async" : "binary", *ops, logged * 1e3 / messages,
+           total / (flushed / 1e6), *bytes);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <threads> <messages_per_thread> <output_path>\n", argv[0]);
+        return -1;
+    }
+    int threads = atoi(argv[1]);
+    long messages = atol(argv[2]);
+    const char *path = argv[3];
+    if (threads <= 0 || threads > MAX_THREADS || messages <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    double sync_ops, async_ops, binary_ops, sync_bytes, async_bytes, binary_bytes;
+    if (run_mode(LOG_SYNC, threads, messages, path, &sync_ops, &sync_bytes) < 0 ||
+        run_mode(LOG_ASYNC, threads, messages, path, &async_ops, &async_bytes) < 0 ||
+        run_mode(LOG_BINARY, threads, messages, path, &binary_ops, &binary_bytes) < 0) {
+        return -1;
+    }
+    unlink(path);
+    printf("threads=%d sync_ops/s=%.0f async_ops/s=%.0f binary_ops/s=%.0f binary_bytes_per_message=%.1f "
+           "async_speedup=%.1f\n",
+           threads, sync_ops, async_ops, binary_ops, binary_bytes, async_ops / sync_ops);
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "../conn.h"
+#include "../eventlog.h"
+#include "../eventcodec.h"
+
+#define EVENT_LOG_SIZE (1 << 20)
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int fib(int n) {
+    if (n == 0) return 0;
+    if (n == 1) return 1;
+    int prev = 0;
+    int curr = 1;
+    int next;
+    for (int i = 2; i <= n; i++) {
+        next = prev + curr;
+        prev = curr;
+        curr = next;
+    }
+    return curr;
+}
+
+static Conn conn;
+
+static size_t fill_requests(long start) {
+    conn.in_start = 0;
+    conn.in_end = 0;
+    long count = 0;
+    while (1) {
+        char request[32];
+        int len = (start + count) % 4 == 0 ? snprintf(request, sizeof(request), "WRITE %ld %ld", count % 10, count % 40)
+                                           : snprintf(request, sizeof(request), "READ %ld", count % 10);
+        if (conn.in_end + sizeof(int) + len > sizeof(conn.in)) {
+            break;
+        }
+        memcpy(conn.in + conn.in_end, &len, sizeof(int));
+        memcpy(conn.in + conn.in_end + sizeof(int), request, len);
+        conn.in_end += sizeof(int) + len;
+        ++count;
+    }
+    return count;
+}
+
+static double bench_parse(long iterations, int reply) {
+    char frame[CONN_MAX_FRAME];
+    long checksum = 0;
+    long done = 0;
+    double elapsed = 0;
+    while (done < iterations) {
+        long batch = fill_requests(done);
+        double start = now_s();
+        for (long i = 0; i < batch; ++i) {
+            conn_next_frame(&conn, frame, sizeof(frame));
+            char *end;
+            int index;
+            int value = 0;
+            if (strncmp(frame, "READ", 4) == 0) {
+                index = strtol(frame + 4, &end, 10);
+            } else {
+                index = strtol(frame + 5, &end, 10);
+                value = strtol(end, &end, 10);
+            }
+            checksum += index + value;
+            if (reply) {
+                if (conn.out.len + 32 > sizeof(conn.out.data)) {
+                    conn.out.len = 0;
+                }
+                frame_appendf(&conn.out, "VALUE %d", value);
+            }
+        }
+        elapsed += now_s() - start;
+        done += batch;
+    }
+    if (checksum == -1) {
+        printf("%ld\n", checksum);
+    }
+    return elapsed * 1e9 / done;
+}
+
+static double bench_sem_pair(long iterations) {
+    sem_t writer_sem;
+    sem_t db_sem;
+    sem_init(&writer_sem, 0, 1);
+    sem_init(&db_sem, 0, 1);
+    double start = now_s();
+    for (long i = 0; i < iterations; ++i) {
+        sem_wait(&writer_sem);
+        sem_wait(&db_sem);
+        sem_post(&db_sem);
+        sem_post(&writer_sem);
+    }
+    double elapsed = now_s() - start;
+    sem_destroy(&db_sem);
+    sem_destroy(&writer_sem);
+    return elapsed * 1e9 / iterations;
+}
+
+static double bench_mutex(long iterations) {
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    double start = now_s();
+    for (long i = 0; i < iterations; ++i) {
+        pthread_mutex_lock(&lock);
+        pthread_mutex_unlock(&lock);
+    }
+    return (now_s() - start) * 1e9 / iterations;
+}
+
+static double bench_notify(long iterations) {
+    double start = now_s();
+    for (long i = 0; i < iterations; ++i) {
+        Event event = {EVENT_READ, event_now_us(), i % 10, i % 40};
+        uint8_t record[EVENT_MAX_ENCODED];
+        eventlog_append(record, event_encode(&event, NULL, record));
+    }
+    return (now_s() - start) * 1e9 / iterations;
+}
+
+static double bench_notify_batch(long iterations) {
+    static FrameBuffer events;
+    double start = now_s();
+    for (long i = 0; i < iterations; ++i) {
+        Event event = {EVENT_UPDATE, event_now_us(), i % 10, i % 40, (i + 1) % 40};
+        uint8_t record[EVENT_MAX_ENCODED];
+        size_t len = event_encode(&event, NULL, record);
+        if (frame_append(&events, record, len) < 0) {
+            eventlog_append_frames(events.data, events.len);
+            events.len = 0;
+            frame_append(&events, record, len);
+        }
+    }
+    eventlog_append_frames(events.data, events.len);
+    return (now_s() - start) * 1e9 / iterations;
+}
+
+static double bench_fib(long iterations) {
+    volatile int sink = 0;
+    double start = now_s();
+    for (long i = 0; i < iterations; ++i) {
+        sink += fib(1 + i % 46);
+    }
+    return (now_s() - start) * 1e9 / iterations;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <iterations>\n", argv[0]);
+        return -1;
+    }
+    long iterations = atol(argv[1]);
+    if (iterations <= 0 || eventlog_open(NULL, EVENT_LOG_SIZE) < 0) {
+        return -1;
+    }
+    printf("{\"name\": \"micro\", \"parse_ns\": %.2f, \"parse_reply_ns\": %.2f, \"sem_pair_ns\": %.2f, "
+           "\"mutex_ns\": %.2f, \"notify_ns\": %.2f, \"notify_batch_ns\": %.2f, "
+           "\"fib_ns\": %.2f}\n",
+           bench_parse(iterations, 0), bench_parse(iterations, 1), bench_sem_pair(iterations), bench_mutex(iterations),
+           bench_notify(iterations), bench_notify_batch(iterations), bench_fib(iterations));
+    eventlog_close();
+    return 0;
+}
@@ -0,0 +1,125 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../mvcc.h"
+
+#define DB_SIZE 1000
+#define TXN_READS 100
+#define MAX_SAMPLES 1000000
+
+static int db[DB_SIZE];
+static int use_mvcc;
+static volatile int running = 1;
+static pthread_rwlock_t db_lock;
+static double samples[MAX_SAMPLES];
+static long sample_count;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *reader(void *arg) {
+    unsigned int seed = (unsigned long)arg;
+    while (running) {
+        Snapshot snap;
+        long sum = 0;
+        if (use_mvcc) {
+            mvcc_begin(&snap);
+        } else {
+            pthread_rwlock_rdlock(&db_lock);
+        }
+        for (int i = 0; i < TXN_READS; ++i) {
+            int index = rand_r(&seed) % DB_SIZE;
+            sum += use_mvcc ? mvcc_read(&snap, index) : db[index];
+            if (i % 10 == 0) {
+                usleep(100);
+            }
+        }
+        if (use_mvcc) {
+            mvcc_end(&snap);
+        } else {
+            pthread_rwlock_unlock(&db_lock);
+        }
+        (void)sum;
+    }
+    return NULL;
+}
+
+static void *writer(void *arg) {
+    unsigned int seed = 7;
+    while (running && sample_count < MAX_SAMPLES) {
+        int index = rand_r(&seed) % DB_SIZE;
+        int value = rand_r(&seed);
+        double start = now_us();
+        if (use_mvcc) {
+            Version *reserved = mvcc_reserve(1);
+            unsigned long ts = mvcc_commit_begin();
+            mvcc_install(&reserved, index, value, ts);
+            mvcc_commit_end(ts);
+            mvcc_collect(index);
+        } else {
+            pthread_rwlock_wrlock(&db_lock);
+            db[index] = value;
+            pthread_rwlock_unlock(&db_lock);
+        }
+        samples[sample_count++] = now_us() - start;
+        usleep(50);
+    }
+    return NULL;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void run(int mvcc, int readers, int seconds) {
+    use_mvcc = mvcc;
+    running = 1;
+    sample_count = 0;
+    pthread_t writer_tid;
+    pthread_t reader_tids[readers];
+    for (int i = 0; i < readers; ++i) {
+        pthread_create(&reader_tids[i], NULL, reader, (void *)(unsigned long)(i + 1));
+    }
+    pthread_create(&writer_tid, NULL, writer, NULL);
+    sleep(seconds);
+    running = 0;
+    pthread_join(writer_tid, NULL);
+    for (int i = 0; i < readers; ++i) {
+        pthread_join(reader_tids[i], NULL);
+    }
+    qsort(samples, sample_count, sizeof(double), compare);
+    printf("%-5s readers=%d writes=%ld p50_us=%.1f p99_us=%.1f max_us=%.1f retained=%zu\n",
+           mvcc ? "mvcc" : "lock", readers, sample_count, samples[sample_count / 2],
+           samples[sample_count * 99 / 100], samples[sample_count - 1], mvcc ? mvcc_retained() : 0);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <readers> <seconds>\n", argv[0]);
+        return -1;
+    }
+    int readers = atoi(argv[1]);
+    int seconds = atoi(argv[2]);
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&db_lock, &attr);
+    for (int i = 0; i < DB_SIZE; ++i) {
+        db[i] = i + 1;
+    }
+    if (mvcc_init(db, DB_SIZE) < 0) {
+        return -1;
+    }
+    run(0, readers, seconds);
+    run(1, readers, seconds);
+    return 0;
+}
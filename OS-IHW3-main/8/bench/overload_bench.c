@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../frame.h"
+
+#define MAX_DEPTH 256
+
+typedef struct {
+    const char *uri;
+    int depth;
+    double deadline;
+    long ok;
+    long busy;
+    long capacity;
+    double *latencies;
+} BenchThread;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void *run(void *arg) {
+    BenchThread *bench = arg;
+    Channel chan;
+    if (channel_connect(&chan, bench->uri) < 0 || channel_send_all(&chan, "READER\n", 7) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    double sent[MAX_DEPTH];
+    char request[32];
+    char buffer[1024];
+    long issued = 0;
+    for (; issued < bench->depth; ++issued) {
+        snprintf(request, sizeof(request), "READ %ld", issued % 10);
+        sent[issued % bench->depth] = now_us();
+        if (send_frame(&chan, request) < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (long done = 0; done < issued; ++done) {
+        if (recv_frame(&chan, buffer, sizeof(buffer)) < 0) {
+            if (done == 0) {
+                ++bench->busy;
+            }
+            break;
+        }
+        double now = now_us();
+        if (strcmp(buffer, "BUSY") == 0) {
+            ++bench->busy;
+        } else if (bench->ok++ < bench->capacity) {
+            bench->latencies[bench->ok - 1] = now - sent[done % bench->depth];
+        }
+        if (now < bench->deadline) {
+            snprintf(request, sizeof(request), "READ %ld", issued % 10);
+            sent[issued % bench->depth] = now;
+            if (send_frame(&chan, request) < 0) {
+                break;
+            }
+            ++issued;
+        }
+    }
+    channel_close(&chan);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 5) {
+        fprintf(stderr, "Usage: %s <uri> <clients> <depth> <seconds>\n", argv[0]);
+        return -1;
+    }
+    int clients = atoi(argv[2]);
+    int depth = atoi(argv[3]);
+    double seconds = atof(argv[4]);
+    if (depth < 1 || depth > MAX_DEPTH) {
+        fprintf(stderr, "Depth must be between 1 and %d\n", MAX_DEPTH);
+        return -1;
+    }
+    long capacity = 4000000;
+    BenchThread *benches = calloc(clients, sizeof(BenchThread));
+    pthread_t *tids = malloc(sizeof(pthread_t) * clients);
+
+    double start = now_us();
+    for (int i = 0; i < clients; ++i) {
+        benches[i].uri = argv[1];
+        benches[i].depth = depth;
+        benches[i].deadline = start + seconds * 1e6;
+        benches[i].capacity = capacity / clients;
+        benches[i].latencies = malloc(sizeof(double) * benches[i].capacity);
+        pthread_create(&tids[i], NULL, run, &benches[i]);
+    }
+    for (int i = 0; i < clients; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    double elapsed = (now_us() - start) / 1e6;
+
+    long ok = 0, busy = 0;
+    for (int i = 0; i < clients; ++i) {
+        ok += benches[i].ok;
+        busy += benches[i].busy;
+    }
+    double *latencies = malloc(sizeof(double) * (ok + 1));
+    long n = 0;
+    for (int i = 0; i < clients; ++i) {
+        long recorded = benches[i].ok < benches[i].capacity ? benches[i].ok : benches[i].capacity;
+        memcpy(latencies + n, benches[i].latencies, sizeof(double) * recorded);
+        n += recorded;
+        free(benches[i].latencies);
+    }
+    qsort(latencies, n, sizeof(double), compare);
+    printf("%s clients=%d depth=%d goodput=%.0f/s busy=%.1f%% p50_us=%.1f p99_us=%.1f\n", argv[1], clients, depth,
+           ok / elapsed, ok + busy ? 100.0 * busy / (ok + busy) : 0.0, n ? latencies[n / 2] : 0.0,
+           n ? latencies[n * 99 / 100] : 0.0);
+    free(latencies);
+    free(benches);
+    free(tids);
+    return 0;
+}
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MAX_THREADS 64
+#define MARKER 424242
+#define POLL_US 200
+#define RECOVERY_LIMIT_US 10000000L
+
+typedef struct {
+    int port;
+    int id;
+    long ops;
+    long failures;
+} LoadThread;
+
+typedef struct {
+    double ops;
+    double first_ok_ms;
+    double recovery_ms;
+    int data_kept;
+    long dropped;
+} ModeResult;
+
+static const char *server_path;
+static volatile int running;
+
+static long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static pid_t start_server(int port, int workers) {
+    char port_text[16], workers_text[16];
+    snprintf(port_text, sizeof(port_text), "%d", port);
+    snprintf(workers_text, sizeof(workers_text), "%d", workers);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        execl(server_path, server_path, "127.0.0.1", port_text, workers_text, (char *)NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+static int stage_connect(int port) {
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    return sock;
+}
+
+static int stage_request(int sock, const char *request, char *reply, size_t size) {
+    char frame[64];
+    int len = strlen(request);
+    memcpy(frame, &len, sizeof(int));
+    memcpy(frame + sizeof(int), request, len);
+    if (send(sock, frame, sizeof(int) + len, MSG_NOSIGNAL) != (ssize_t)(sizeof(int) + len)) {
+        return -1;
+    }
+    ssize_t received = read(sock, reply, size - 1);
+    if (received <= 0) {
+        return -1;
+    }
+    reply[received] = '\0';
+    return 0;
+}
+
+static int read_marker(int port) {
+    int sock = stage_connect(port);
+    if (sock < 0) {
+        return -1;
+    }
+    char reply[64];
+    int value = -1;
+    if (stage_request(sock, "READ 0", reply, sizeof(reply)) == 0 && sscanf(reply, "VALUE %d", &value) != 1) {
+        value = -1;
+    }
+    close(sock);
+    return value;
+}
+
+static int count_workers(pid_t server, pid_t *first) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/children", server, server);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    int count = 0, pid;
+    while (fscanf(file, "%d", &pid) == 1) {
+        if (count++ == 0 && first) {
+            *first = pid;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+static void *load(void *arg) {
+    LoadThread *thread = arg;
+    int sock = stage_connect(thread->port);
+    if (sock < 0) {
+        ++thread->failures;
+        return NULL;
+    }
+    char request[64], reply[64];
+    for (long i = 0; running; ++i) {
+        if (i % 2) {
+            snprintf(request, sizeof(request), "READ %ld", i % 9 + 1);
+        } else {
+            snprintf(request, sizeof(request), "WRITE %ld %d", i % 9 + 1, thread->id);
+        }
+        if (stage_request(sock, request, reply, sizeof(reply)) < 0) {
+            ++thread->failures;
+            break;
+        }
+        ++thread->ops;
+    }
+    close(sock);
+    return NULL;
+}
+
+static int run_mode(int port, int workers, int threads, int seconds, ModeResult *result) {
+    pid_t server = start_server(port, workers);
+    long deadline = now_us() + RECOVERY_LIMIT_US;
+    while (read_marker(port) < 0 || (workers > 0 && count_workers(server, NULL) < workers)) {
+        if (now_us() > deadline) {
+            fprintf(stderr, "server on port %d did not start\n", port);
+            kill(server, SIGKILL);
+            waitpid(server, NULL, 0);
+            return -1;
+        }
+        usleep(POLL_US);
+    }
+
+    LoadThread bench[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    running = 1;
+    long started = now_us();
+    for (int i = 0; i < threads; ++i) {
+        bench[i] = (LoadThread){port, i + 1, 0, 0};
+        pthread_create(&tids[i], NULL, load, &bench[i]);
+    }
+    sleep(seconds);
+    long ops = 0, failures = 0;
+    for (int i = 0; i < threads; ++i) {
+        ops += bench[i].ops;
+    }
+    result->ops = ops / ((now_us() - started) / 1e6);
+
+    char reply[64], request[64];
+    int sock = stage_connect(port);
+    snprintf(request, sizeof(request), "WRITE 0 %d", MARKER);
+    if (sock < 0 || stage_request(sock, request, reply, sizeof(reply)) < 0) {
+        fprintf(stderr, "marker write failed\n");
+        failures++;
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+
+    pid_t victim = server;
+    if (workers > 0 && count_workers(server, &victim) <= 0) {
+        fprintf(stderr, "no workers found\n");
+        failures++;
+    }
+    long killed = now_us();
+    kill(victim, SIGKILL);
+    if (workers == 0) {
+        waitpid(server, NULL, 0);
+        server = start_server(port, workers);
+    }
+
+    int value = -1;
+    result->first_ok_ms = result->recovery_ms = -1;
+    while (now_us() - killed < RECOVERY_LIMIT_US) {
+        if (value < 0 && (value = read_marker(port)) >= 0) {
+            result->first_ok_ms = (now_us() - killed) / 1e3;
+        }
+        pid_t first = 0;
+        int restored = workers == 0 || (count_workers(server, &first) == workers && first != victim);
+        if (value >= 0 && restored) {
+            result->recovery_ms = (now_us() - killed) / 1e3;
+            break;
+        }
+        usleep(POLL_US);
+    }
+    result->data_kept = value == MARKER;
+
+    running = 0;
+    result->dropped = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+        result->dropped += bench[i].failures;
+    }
+    kill(server, SIGINT);
+    waitpid(server, NULL, 0);
+    printf("workers=%d ops/s=%.0f first_ok_ms=%.1f recovery_ms=%.1f data_kept=%d dropped=%ld failures=%ld\n",
+           workers, result->ops, result->first_ok_ms, result->recovery_ms, result->data_kept, result->dropped, failures);
+    return failures > 0 || result->recovery_ms < 0 ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 6) {
+        fprintf(stderr, "Usage: %s <server_binary> <port> <workers> <threads> <seconds>\n", argv[0]);
+        return -1;
+    }
+    server_path = argv[1];
+    int port = atoi(argv[2]);
+    int workers = atoi(argv[3]);
+    int threads = atoi(argv[4]);
+    int seconds = atoi(argv[5]);
+    if (workers <= 0 || threads <= 0 || threads > MAX_THREADS || seconds <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    ModeResult threaded, prefork;
+    if (run_mode(port, 0, threads, seconds, &threaded) < 0 || run_mode(port + 1, workers, threads, seconds, &prefork) < 0) {
+        return 1;
+    }
+    printf("workers=%d threaded_ops/s=%.0f prefork_ops/s=%.0f threaded_recovery_ms=%.1f prefork_recovery_ms=%.1f "
+           "prefork_first_ok_ms=%.1f threaded_data_kept=%d prefork_data_kept=%d threaded_dropped=%ld prefork_dropped=%ld\n",
+           workers, threaded.ops, prefork.ops, threaded.recovery_ms, prefork.recovery_ms, prefork.first_ok_ms,
+           threaded.data_kept, prefork.data_kept, threaded.dropped, prefork.dropped);
+    return 0;
+}
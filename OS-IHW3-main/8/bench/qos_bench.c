@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../dbclient.h"
+
+#define REQUEST_TIMEOUT_MS 1000
+#define FLOOD_BATCH 32
+#define PROBE_INTERVAL_US 1000
+#define MAX_SAMPLES 1000000
+#define MAX_FLOOD_THREADS 256
+
+typedef struct {
+    DbClient *client;
+    long requests;
+} FloodThread;
+
+static volatile int running;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void *flood_loop(void *arg) {
+    FloodThread *thread = arg;
+    const char *requests[FLOOD_BATCH];
+    char(*replies)[DB_REPLY_SIZE] = malloc(sizeof(*replies) * FLOOD_BATCH);
+    for (int i = 0; i < FLOOD_BATCH; ++i) {
+        requests[i] = "READ 0";
+    }
+    while (running) {
+        if (db_batch(thread->client, requests, replies, FLOOD_BATCH, REQUEST_TIMEOUT_MS) == DB_OK) {
+            thread->requests += FLOOD_BATCH;
+        }
+    }
+    free(replies);
+    return NULL;
+}
+
+static int run_phase(const char *uri, const char *probe_role, const char *flood_role, int flood_threads, int seconds,
+                     double *p50, double *p99, double *flood_per_sec) {
+    DbClient *probe = db_client_open(uri, probe_role, 1);
+    DbClient *flood = flood_threads > 0 ? db_client_open(uri, flood_role, flood_threads) : NULL;
+    if (!probe || (flood_threads > 0 && !flood)) {
+        return -1;
+    }
+    FloodThread threads[MAX_FLOOD_THREADS] = {{0}};
+    pthread_t tids[MAX_FLOOD_THREADS];
+    running = 1;
+    for (int i = 0; i < flood_threads; ++i) {
+        threads[i].client = flood;
+        pthread_create(&tids[i], NULL, flood_loop, &threads[i]);
+    }
+    usleep(200000);
+
+    double *latencies = malloc(sizeof(double) * MAX_SAMPLES);
+    long samples = 0;
+    double started = now_us();
+    while (now_us() - started < seconds * 1e6 && samples < MAX_SAMPLES) {
+        int value;
+        double sent = now_us();
+        if (db_read(probe, 0, &value, REQUEST_TIMEOUT_MS) == DB_OK) {
+            latencies[samples++] = now_us() - sent;
+        }
+        usleep(PROBE_INTERVAL_US);
+    }
+    double elapsed = (now_us() - started) / 1e6;
+    running = 0;
+    long flooded = 0;
+    for (int i = 0; i < flood_threads; ++i) {
+        pthread_join(tids[i], NULL);
+        flooded += threads[i].requests;
+    }
+    if (samples == 0) {
+        fprintf(stderr, "No probe requests succeeded\n");
+        return -1;
+    }
+    qsort(latencies, samples, sizeof(double), compare);
+    *p50 = latencies[samples / 2];
+    *p99 = latencies[samples * 99 / 100];
+    *flood_per_sec = flooded / elapsed;
+    printf("probe=\"%s\" flood=\"%s\" p50_us=%.1f p99_us=%.1f flood=%.0f/s\n", probe_role,
+           flood_threads > 0 ? flood_role : "none", *p50, *p99, *flood_per_sec);
+    free(latencies);
+    if (flood) {
+        db_client_close(flood);
+    }
+    db_client_close(probe);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <uri> <seconds> <flood_threads>\n", argv[0]);
+        return -1;
+    }
+    const char *uri = argv[1];
+    int seconds = atoi(argv[2]);
+    int flood_threads = atoi(argv[3]);
+    if (seconds <= 0 || flood_threads <= 0 || flood_threads > MAX_FLOOD_THREADS) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+    double idle_p50, idle_p99, fair_p50, fair_p99, qos_p50, qos_p99, idle_flood, fair_flood, qos_flood;
+    if (run_phase(uri, "READER QOS HIGH", NULL, 0, seconds, &idle_p50, &idle_p99, &idle_flood) < 0 ||
+        run_phase(uri, "READER QOS NORMAL", "READER QOS NORMAL", flood_threads, seconds, &fair_p50, &fair_p99,
+                  &fair_flood) < 0 ||
+        run_phase(uri, "READER QOS HIGH", "READER QOS LOW", flood_threads, seconds, &qos_p50, &qos_p99,
+                  &qos_flood) < 0) {
+        return -1;
+    }
+    printf("flood_threads=%d idle_p99_us=%.1f same_class_p99_us=%.1f high_over_low_p99_us=%.1f "
+           "same_class_flood=%.0f/s low_flood=%.0f/s\n",
+           flood_threads, idle_p99, fair_p99, qos_p99, fair_flood, qos_flood);
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include "../dbclient.h"
+
+#define REQUEST_TIMEOUT_MS 1000
+#define THINK_US 1000
+#define SAMPLE_US 1000
+#define WINDOW_US 10000
+#define MAX_SAMPLES 65536
+#define RECOVERY_LIMIT_US 20000000L
+
+typedef struct {
+    DbClient *client;
+    long first_ok_us;
+} LoadThread;
+
+static const char *server_path;
+static char port_text[16];
+static volatile int running = 1;
+static volatile long restart_us;
+
+static long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static pid_t start_server(void) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        execl(server_path, server_path, "127.0.0.1", port_text, (char *)NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+static void *load(void *arg) {
+    LoadThread *thread = arg;
+    unsigned long issued = 0;
+    while (running) {
+        int value;
+        int status = db_read(thread->client, issued++ % 10, &value, REQUEST_TIMEOUT_MS);
+        long restarted = restart_us;
+        if (status == DB_OK && restarted && thread->first_ok_us == 0) {
+            thread->first_ok_us = now_us() - restarted;
+        }
+        usleep(THINK_US);
+    }
+    return NULL;
+}
+
+static long connect_attempts(DbClient **clients, int count) {
+    long total = 0;
+    for (int i = 0; i < count; ++i) {
+        DbClientStats stats;
+        db_client_stats(clients[i], &stats);
+        total += stats.connect_attempts;
+    }
+    return total;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 6) {
+        fprintf(stderr, "Usage: %s <server_binary> <port> <clients> <down_ms> <jitter|nojitter>\n", argv[0]);
+        return -1;
+    }
+    server_path = argv[1];
+    snprintf(port_text, sizeof(port_text), "%s", argv[2]);
+    int count = atoi(argv[3]);
+    long down_us = atol(argv[4]) * 1000;
+    int jitter = strcmp(argv[5], "nojitter") != 0;
+    char uri[64];
+    snprintf(uri, sizeof(uri), "tcp://127.0.0.1:%s", port_text);
+
+    pid_t server = start_server();
+    usleep(300000);
+    DbClient **clients = calloc(count, sizeof(DbClient *));
+    LoadThread *threads = calloc(count, sizeof(LoadThread));
+    pthread_t *tids = malloc(sizeof(pthread_t) * count);
+    DbRetryPolicy policy = {DB_MAX_RETRIES, DB_BACKOFF_MIN_MS, DB_BACKOFF_MAX_MS, DB_RETRY_BUDGET,
+                            DB_RETRY_BUDGET_PERCENT, jitter};
+    for (int i = 0; i < count; ++i) {
+        clients[i] = db_client_open(uri, "READER", 1);
+        if (!clients[i]) {
+            kill(server, SIGKILL);
+            return -1;
+        }
+        db_client_set_retry(clients[i], &policy);
+        threads[i].client = clients[i];
+        pthread_create(&tids[i], NULL, load, &threads[i]);
+    }
+    sleep(1);
+
+    long base_attempts = connect_attempts(clients, count);
+    kill(server, SIGKILL);
+    waitpid(server, NULL, 0);
+    long killed_us = now_us();
+    static long samples[MAX_SAMPLES];
+    static long sample_times[MAX_SAMPLES];
+    int sample_count = 0;
+    int recovered = 0;
+    while (!recovered && sample_count < MAX_SAMPLES && now_us() - killed_us < down_us + RECOVERY_LIMIT_US) {
+        if (!restart_us && now_us() - killed_us >= down_us) {
+            restart_us = now_us();
+            server = start_server();
+        }
+        sample_times[sample_count] = now_us();
+        samples[sample_count++] = connect_attempts(clients, count) - base_attempts;
+        recovered = restart_us != 0;
+        for (int i = 0; i < count && recovered; ++i) {
+            recovered = threads[i].first_ok_us != 0;
+        }
+        usleep(SAMPLE_US);
+    }
+
+    double peak_rate = 0;
+    for (int i = 0, j = 0; i < sample_count; ++i) {
+        while (sample_times[i] - sample_times[j] > WINDOW_US) {
+            ++j;
+        }
+        if (sample_times[i] > sample_times[j]) {
+            double rate = (samples[i] - samples[j]) * 1e6 / (sample_times[i] - sample_times[j]);
+            if (rate > peak_rate && sample_times[i] - sample_times[j] >= WINDOW_US / 2) {
+                peak_rate = rate;
+            }
+        }
+    }
+    long first_ok = 0, last_ok = 0;
+    for (int i = 0; i < count; ++i) {
+        long ok = threads[i].first_ok_us;
+        if (ok && (!first_ok || ok < first_ok)) {
+            first_ok = ok;
+        }
+        if (ok > last_ok) {
+            last_ok = ok;
+        }
+    }
+
+    running = 0;
+    for (int i = 0; i < count; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    long retries = 0, denied = 0;
+    for (int i = 0; i < count; ++i) {
+        DbClientStats stats;
+        db_client_stats(clients[i], &stats);
+        retries += stats.retries;
+        denied += stats.retries_denied;
+        db_client_close(clients[i]);
+    }
+    kill(server, SIGKILL);
+    waitpid(server, NULL, 0);
+    printf("%s clients=%d down_ms=%ld recovered=%d first_ok_ms=%.1f all_ok_ms=%.1f peak_connects=%.0f/s "
+           "connect_attempts=%ld retries=%ld retries_denied=%ld\n",
+           jitter ? "jitter" : "nojitter", count, down_us / 1000, recovered, first_ok / 1000.0, last_ok / 1000.0,
+           peak_rate, samples[sample_count - 1], retries, denied);
+    free(tids);
+    free(threads);
+    free(clients);
+    return 0;
+}
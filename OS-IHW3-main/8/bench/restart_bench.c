@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../frame.h"
+
+#define RECONNECT_DELAY_US 10000
+
+typedef struct {
+    const char *uri;
+    double deadline;
+    long interval_us;
+    long ok;
+    long reconnects;
+    long capacity;
+    double *latencies;
+} BenchThread;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int connect_reader(BenchThread *bench, Channel *chan) {
+    while (now_us() < bench->deadline) {
+        if (channel_connect(chan, bench->uri) == 0) {
+            if (channel_send_all(chan, "READER\n", 7) == 0) {
+                return 0;
+            }
+            channel_close(chan);
+        }
+        usleep(RECONNECT_DELAY_US);
+    }
+    return -1;
+}
+
+static void *run(void *arg) {
+    BenchThread *bench = arg;
+    Channel chan;
+    if (connect_reader(bench, &chan) < 0) {
+        return NULL;
+    }
+    char request[32];
+    char buffer[1024];
+    for (long issued = 0; now_us() < bench->deadline; ++issued) {
+        snprintf(request, sizeof(request), "READ %ld", issued % 10);
+        double sent = now_us();
+        while (send_frame(&chan, request) < 0 || recv_frame(&chan, buffer, sizeof(buffer)) < 0) {
+            channel_close(&chan);
+            ++bench->reconnects;
+            if (connect_reader(bench, &chan) < 0) {
+                return NULL;
+            }
+        }
+        if (bench->ok++ < bench->capacity) {
+            bench->latencies[bench->ok - 1] = now_us() - sent;
+        }
+        if (bench->interval_us > 0) {
+            usleep(bench->interval_us);
+        }
+    }
+    channel_close(&chan);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 5) {
+        fprintf(stderr, "Usage: %s <uri> <clients> <seconds> <interval_us>\n", argv[0]);
+        return -1;
+    }
+    int clients = atoi(argv[2]);
+    int seconds = atoi(argv[3]);
+    long interval_us = atol(argv[4]);
+    long capacity = 4000000;
+    BenchThread *benches = calloc(clients, sizeof(BenchThread));
+    pthread_t *tids = malloc(sizeof(pthread_t) * clients);
+    double start = now_us();
+    for (int i = 0; i < clients; ++i) {
+        benches[i].uri = argv[1];
+        benches[i].deadline = start + seconds * 1e6;
+        benches[i].interval_us = interval_us;
+        benches[i].capacity = capacity / clients;
+        benches[i].latencies = malloc(sizeof(double) * benches[i].capacity);
+        pthread_create(&tids[i], NULL, run, &benches[i]);
+    }
+    for (int i = 0; i < clients; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+
+    long ok = 0, reconnects = 0;
+    for (int i = 0; i < clients; ++i) {
+        ok += benches[i].ok;
+        reconnects += benches[i].reconnects;
+    }
+    double *latencies = malloc(sizeof(double) * (ok + 1));
+    long n = 0;
+    for (int i = 0; i < clients; ++i) {
+        long recorded = benches[i].ok < benches[i].capacity ? benches[i].ok : benches[i].capacity;
+        memcpy(latencies + n, benches[i].latencies, sizeof(double) * recorded);
+        n += recorded;
+        free(benches[i].latencies);
+    }
+    qsort(latencies, n, sizeof(double), compare);
+    printf("%s clients=%d requests=%ld reconnects=%ld p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n", argv[1],
+           clients, ok, reconnects, n ? latencies[n / 2] : 0.0, n ? latencies[n * 99 / 100] : 0.0,
+           n ? latencies[n * 999 / 1000] : 0.0, n ? latencies[n - 1] : 0.0);
+    free(latencies);
+    free(benches);
+    free(tids);
+    return 0;
+}
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include "../dbclient.h"
+#include "../frame.h"
+
+#define REQUEST_TIMEOUT_MS 1000
+#define CYCLE_REQUESTS 20
+#define OBSERVER_EVERY 10
+#define MAX_WINDOW_SAMPLES 1000000
+#define MAX_CLIENTS 256
+#define MAX_SAMPLES 100000
+#define SETTLE_US 1000000
+
+typedef struct {
+    long rss_kb;
+    long fds;
+    long threads;
+    double p50_us;
+    double p99_us;
+} Sample;
+
+typedef struct {
+    const char *uri;
+    int id;
+    long cycles;
+    long failures;
+} SoakClient;
+
+static volatile int running;
+static pthread_mutex_t window_lock = PTHREAD_MUTEX_INITIALIZER;
+static double *window;
+static long window_count;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static long status_field(int pid, const char *name) {
+    char path[64], line[256];
+    long value = -1;
+    size_t len = strlen(name);
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, name, len) == 0 && line[len] == ':') {
+            value = atol(line + len + 1);
+            break;
+        }
+    }
+    fclose(file);
+    return value;
+}
+
+static long open_fds(int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return -1;
+    }
+    long count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (entry->d_name[0] != '.') {
+            ++count;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static void record_latency(double latency) {
+    pthread_mutex_lock(&window_lock);
+    if (window_count < MAX_WINDOW_SAMPLES) {
+        window[window_count++] = latency;
+    }
+    pthread_mutex_unlock(&window_lock);
+}
+
+static void observe_once(const char *uri) {
+    Channel chan;
+    char event[DB_REPLY_SIZE];
+    if (channel_connect(&chan, uri) < 0) {
+        return;
+    }
+    if (channel_send_all(&chan, "OBSERVER\n", 9) == 0) {
+        recv_frame(&chan, event, sizeof(event));
+    }
+    channel_close(&chan);
+}
+
+static void *client_loop(void *arg) {
+    SoakClient *soak = arg;
+    unsigned seed = soak->id + 1;
+    while (running) {
+        if (soak->cycles % OBSERVER_EVERY == OBSERVER_EVERY - 1) {
+            observe_once(soak->uri);
+        }
+        DbClient *client = db_client_open(soak->uri, "WRITER", 1);
+        if (!client) {
+            ++soak->failures;
+            usleep(10000);
+            continue;
+        }
+        for (int i = 0; i < CYCLE_REQUESTS && running; ++i) {
+            int index = rand_r(&seed) % 10, value;
+            double sent = now_us();
+            int status = i % 2 ? db_read(client, index, &value, REQUEST_TIMEOUT_MS)
+                               : db_write(client, index, i, &value, REQUEST_TIMEOUT_MS);
+            if (status == DB_OK) {
+                record_latency(now_us() - sent);
+            } else {
+                ++soak->failures;
+            }
+        }
+        db_client_close(client);
+        ++soak->cycles;
+    }
+    return NULL;
+}
+
+static void take_sample(int pid, Sample *sample) {
+    sample->rss_kb = status_field(pid, "VmRSS");
+    sample->threads = status_field(pid, "Threads");
+    sample->fds = open_fds(pid);
+    pthread_mutex_lock(&window_lock);
+    qsort(window, window_count, sizeof(double), compare);
+    sample->p50_us = window_count > 0 ? window[window_count / 2] : 0;
+    sample->p99_us = window_count > 0 ? window[window_count * 99 / 100] : 0;
+    window_count = 0;
+    pthread_mutex_unlock(&window_lock);
+}
+
+static double mean_p99(const Sample *samples, long from, long to) {
+    double sum = 0;
+    for (long i = from; i < to; ++i) {
+        sum += samples[i].p99_us;
+    }
+    return to > from ? sum / (to - from) : 0;
+}
+
+static void settle(const char *uri) {
+    DbClient *client = db_client_open(uri, "WRITER", 1);
+    if (client) {
+        int old_value;
+        db_write(client, 0, 0, &old_value, REQUEST_TIMEOUT_MS);
+        db_client_close(client);
+    }
+    usleep(SETTLE_US);
+}
+
+int main(int argc, char *argv[]) {
+    long max_rss_growth_kb = 10240, max_fd_growth = 0, max_thread_growth = 0, max_p99_growth = 100;
+    static struct option options[] = {
+        {"max-rss-growth", required_argument, NULL, 'r'},
+        {"max-fd-growth", required_argument, NULL, 'f'},
+        {"max-thread-growth", required_argument, NULL, 't'},
+        {"max-p99-growth", required_argument, NULL, 'p'},
+        {NULL, 0, NULL, 0}};
+    int opt_char;
+    while ((opt_char = getopt_long(argc, argv, "r:f:t:p:", options, NULL)) != -1) {
+        switch (opt_char) {
+        case 'r':
+            max_rss_growth_kb = atol(optarg);
+            break;
+        case 'f':
+            max_fd_growth = atol(optarg);
+            break;
+        case 't':
+            max_thread_growth = atol(optarg);
+            break;
+        case 'p':
+            max_p99_growth = atol(optarg);
+            break;
+        default:
+            return -1;
+        }
+    }
+    if (argc - optind != 5) {
+        fprintf(stderr,
+                "Usage: %s [--max-rss-growth <kb>] [--max-fd-growth <n>] [--max-thread-growth <n>] "
+                "[--max-p99-growth <percent>] <uri> <server_pid> <seconds> <clients> <sample_seconds>\n",
+                argv[0]);
+        return -1;
+    }
+    const char *uri = argv[optind];
+    int server_pid = atoi(argv[optind + 1]);
+    long seconds = atol(argv[optind + 2]);
+    int clients = atoi(argv[optind + 3]);
+    long interval = atol(argv[optind + 4]);
+    if (server_pid <= 0 || seconds <= 0 || clients <= 0 || clients > MAX_CLIENTS || interval <= 0 ||
+        seconds / interval < 2 || seconds / interval > MAX_SAMPLES) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+
+    window = malloc(sizeof(double) * MAX_WINDOW_SAMPLES);
+    Sample *samples = malloc(sizeof(Sample) * (seconds / interval));
+    Sample idle_before, idle_after;
+    settle(uri);
+    take_sample(server_pid, &idle_before);
+    if (idle_before.rss_kb < 0 || idle_before.fds < 0) {
+        fprintf(stderr, "Cannot read /proc/%d\n", server_pid);
+        return -1;
+    }
+
+    SoakClient soak[MAX_CLIENTS] = {{0}};
+    pthread_t tids[MAX_CLIENTS];
+    running = 1;
+    for (int i = 0; i < clients; ++i) {
+        soak[i].uri = uri;
+        soak[i].id = i;
+        pthread_create(&tids[i], NULL, client_loop, &soak[i]);
+    }
+    double started = now_us();
+    long count = seconds / interval;
+    for (long i = 0; i < count; ++i) {
+        double wake = started + (i + 1) * interval * 1e6, now = now_us();
+        if (wake > now) {
+            usleep(wake - now);
+        }
+        take_sample(server_pid, &samples[i]);
+        printf("t=%ld rss_kb=%ld fds=%ld threads=%ld p50_us=%.1f p99_us=%.1f\n", (i + 1) * interval,
+               samples[i].rss_kb, samples[i].fds, samples[i].threads, samples[i].p50_us, samples[i].p99_us);
+        fflush(stdout);
+    }
+    running = 0;
+    long cycles = 0, failures = 0;
+    for (int i = 0; i < clients; ++i) {
+        pthread_join(tids[i], NULL);
+        cycles += soak[i].cycles;
+        failures += soak[i].failures;
+    }
+    settle(uri);
+    take_sample(server_pid, &idle_after);
+
+    long third = count / 3 > 0 ? count / 3 : 1;
+    double p99_first = mean_p99(samples, 0, third);
+    double p99_last = mean_p99(samples, count - third, count);
+    long rss_growth = samples[count - 1].rss_kb - samples[0].rss_kb;
+    long fd_growth = idle_after.fds - idle_before.fds;
+    long thread_growth = idle_after.threads - idle_before.threads;
+    double p99_growth = p99_first > 0 ? (p99_last - p99_first) * 100 / p99_first : 0;
+    int failed = 0;
+    if (rss_growth > max_rss_growth_kb) {
+        fprintf(stderr, "RSS grew by %ld kB (limit %ld kB)\n", rss_growth, max_rss_growth_kb);
+        failed = 1;
+    }
+    if (fd_growth > max_fd_growth) {
+        fprintf(stderr, "Idle fd count grew by %ld (limit %ld)\n", fd_growth, max_fd_growth);
+        failed = 1;
+    }
+    if (thread_growth > max_thread_growth) {
+        fprintf(stderr, "Idle thread count grew by %ld (limit %ld)\n", thread_growth, max_thread_growth);
+        failed = 1;
+    }
+    if (p99_growth > max_p99_growth) {
+        fprintf(stderr, "p99 latency grew by %.0f%% (limit %ld%%)\n", p99_growth, max_p99_growth);
+        failed = 1;
+    }
+    printf("seconds=%ld clients=%d cycles=%ld failures=%ld rss_growth_kb=%ld fd_growth=%ld thread_growth=%ld "
+           "p99_first_us=%.1f p99_last_us=%.1f failed=%d\n",
+           seconds, clients, cycles, failures, rss_growth, fd_growth, thread_growth, p99_first, p99_last, failed);
+    free(samples);
+    free(window);
+    return failed ? 1 : 0;
+}
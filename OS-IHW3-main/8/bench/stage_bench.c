@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MAX_THREADS 64
+#define MAX_OBSERVERS 5
+#define HANDSHAKE_DELAY_US 50000
+
+typedef struct {
+    const char *ip;
+    int port;
+    int handshake;
+    int id;
+    long ops;
+    long failures;
+} StageThread;
+
+static volatile int running;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int stage_connect(const char *ip, int port, const char *handshake) {
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0 || inet_pton(AF_INET, ip, &addr.sin_addr) <= 0 ||
+        connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    if (handshake) {
+        if (send(sock, handshake, strlen(handshake), 0) < 0) {
+            close(sock);
+            return -1;
+        }
+        usleep(HANDSHAKE_DELAY_US);
+    }
+    return sock;
+}
+
+static void *client_loop(void *arg) {
+    StageThread *thread = arg;
+    int sock = stage_connect(thread->ip, thread->port, thread->handshake ? "READER" : NULL);
+    if (sock < 0) {
+        ++thread->failures;
+        return NULL;
+    }
+    char frame[64], reply[1024];
+    for (long i = 0; running; ++i) {
+        int len = i % 2 ? snprintf(frame + sizeof(int), sizeof(frame) - sizeof(int), "READ %ld", i % 10)
+                        : snprintf(frame + sizeof(int), sizeof(frame) - sizeof(int), "WRITE %ld %d", i % 10, thread->id);
+        memcpy(frame, &len, sizeof(int));
+        if (send(sock, frame, sizeof(int) + len, 0) != (ssize_t)(sizeof(int) + len) ||
+            read(sock, reply, sizeof(reply) - 1) <= 0) {
+            ++thread->failures;
+            break;
+        }
+        ++thread->ops;
+    }
+    close(sock);
+    return NULL;
+}
+
+static void *observer_loop(void *arg) {
+    int sock = *(int *)arg;
+    char buffer[4096];
+    while (recv(sock, buffer, sizeof(buffer), 0) > 0) {
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 7) {
+        fprintf(stderr, "Usage: %s <server_ip> <port> <handshake 0|1> <observers> <threads> <seconds>\n", argv[0]);
+        return -1;
+    }
+    const char *ip = argv[1];
+    int port = atoi(argv[2]);
+    int handshake = atoi(argv[3]);
+    int observers = atoi(argv[4]);
+    int threads = atoi(argv[5]);
+    int seconds = atoi(argv[6]);
+    if (threads <= 0 || threads > MAX_THREADS || observers < 0 || observers > MAX_OBSERVERS || seconds <= 0 ||
+        (observers > 0 && !handshake)) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+
+    int observer_socks[MAX_OBSERVERS];
+    pthread_t observer_tids[MAX_OBSERVERS];
+    for (int i = 0; i < observers; ++i) {
+        if ((observer_socks[i] = stage_connect(ip, port, "OBSERVER")) < 0) {
+            fprintf(stderr, "Observer connection failed\n");
+            return -1;
+        }
+        pthread_create(&observer_tids[i], NULL, observer_loop, &observer_socks[i]);
+    }
+
+    StageThread bench[MAX_THREADS] = {{0}};
+    pthread_t tids[MAX_THREADS];
+    running = 1;
+    double started = now_us();
+    for (int i = 0; i < threads; ++i) {
+        bench[i] = (StageThread){ip, port, handshake, i + 1, 0, 0};
+        pthread_create(&tids[i], NULL, client_loop, &bench[i]);
+    }
+    sleep(seconds);
+    running = 0;
+    long ops = 0, failures = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+        ops += bench[i].ops;
+        failures += bench[i].failures;
+    }
+    double elapsed = (now_us() - started) / 1e6;
+    for (int i = 0; i < observers; ++i) {
+        shutdown(observer_socks[i], SHUT_RDWR);
+        pthread_join(observer_tids[i], NULL);
+        close(observer_socks[i]);
+    }
+    printf("threads=%d observers=%d ops/s=%.0f failures=%ld\n", threads, observers, ops / elapsed, failures);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../frame.h"
+
+typedef struct {
+    const char *uri;
+    long requests;
+    double *latencies;
+} BenchThread;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void *run(void *arg) {
+    BenchThread *bench = arg;
+    Channel chan;
+    if (channel_connect(&chan, bench->uri) < 0 || channel_send_all(&chan, "READER\n", 7) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    char request[32];
+    char buffer[1024];
+    for (long i = 0; i < bench->requests; ++i) {
+        snprintf(request, sizeof(request), "READ %ld", i % 10);
+        double start = now_us();
+        if (send_frame(&chan, request) < 0 || recv_frame(&chan, buffer, sizeof(buffer)) < 0) {
+            fprintf(stderr, "Request failed\n");
+            exit(EXIT_FAILURE);
+        }
+        bench->latencies[i] = now_us() - start;
+    }
+    channel_close(&chan);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <uri> <requests_per_client> <clients>\n", argv[0]);
+        return -1;
+    }
+    long requests = atol(argv[2]);
+    int clients = atoi(argv[3]);
+    BenchThread benches[clients];
+    pthread_t tids[clients];
+    double *latencies = malloc(sizeof(double) * requests * clients);
+
+    double start = now_us();
+    for (int i = 0; i < clients; ++i) {
+        benches[i].uri = argv[1];
+        benches[i].requests = requests;
+        benches[i].latencies = latencies + i * requests;
+        pthread_create(&tids[i], NULL, run, &benches[i]);
+    }
+    for (int i = 0; i < clients; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    double elapsed = (now_us() - start) / 1e6;
+
+    long total = requests * clients;
+    qsort(latencies, total, sizeof(double), compare);
+    printf("%s clients=%d req/s=%.0f p50_us=%.1f p99_us=%.1f\n", argv[1], clients, total / elapsed,
+           latencies[total / 2], latencies[total * 99 / 100]);
+    free(latencies);
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../mvcc.h"
+#include "../txn.h"
+
+#define DB_SIZE 65536
+#define TXN_KEYS 4
+
+static int db[DB_SIZE];
+static int hot_set;
+static volatile int running;
+static long commits;
+static long aborts;
+
+static void *worker(void *arg) {
+    unsigned int seed = (unsigned long)arg;
+    long local_commits = 0;
+    long local_aborts = 0;
+    while (running) {
+        Txn txn;
+        txn_begin(&txn);
+        for (int i = 0; i < TXN_KEYS; ++i) {
+            int index = rand_r(&seed) % hot_set;
+            int value;
+            txn_read(&txn, index, &value);
+            txn_write(&txn, index, value + 1);
+        }
+        if (txn_commit(&txn) == TXN_COMMITTED) {
+            ++local_commits;
+        } else {
+            ++local_aborts;
+        }
+    }
+    __atomic_add_fetch(&commits, local_commits, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&aborts, local_aborts, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <threads> <seconds>\n", argv[0]);
+        return -1;
+    }
+    int threads = atoi(argv[1]);
+    int seconds = atoi(argv[2]);
+    if (mvcc_init(db, DB_SIZE) < 0 || txn_init(db, DB_SIZE) < 0) {
+        return -1;
+    }
+
+    int hot_sets[] = {4, 16, 256, 4096, DB_SIZE};
+    for (size_t h = 0; h < sizeof(hot_sets) / sizeof(hot_sets[0]); ++h) {
+        hot_set = hot_sets[h];
+        commits = 0;
+        aborts = 0;
+        running = 1;
+        pthread_t tids[threads];
+        for (int i = 0; i < threads; ++i) {
+            pthread_create(&tids[i], NULL, worker, (void *)(unsigned long)(i + 1));
+        }
+        sleep(seconds);
+        running = 0;
+        for (int i = 0; i < threads; ++i) {
+            pthread_join(tids[i], NULL);
+        }
+        printf("hot_set=%-6d threads=%d commits/s=%.0f abort_rate=%.2f%%\n", hot_set, threads,
+               (double)commits / seconds, 100.0 * aborts / (commits + aborts ? commits + aborts : 1));
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "../dbclient.h"
+#include "../frame.h"
+
+#define REQUEST_TIMEOUT_MS 1000
+#define PARK_TIMEOUT_US 60000000L
+#define ROUND_TIMEOUT_MS 5000
+#define EPOLL_BATCH 256
+
+typedef struct {
+    Channel chan;
+    int index;
+} BenchWatcher;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static long rss_kb(int pid) {
+    char path[64], line[256];
+    long rss = -1;
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "VmRSS: %ld", &rss) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return rss;
+}
+
+static long parked_watchers(DbClient *control) {
+    char reply[DB_REPLY_SIZE];
+    const char *field;
+    if (db_call(control, "STATS", reply, sizeof(reply), REQUEST_TIMEOUT_MS) != DB_OK ||
+        !(field = strstr(reply, "watchers="))) {
+        return -1;
+    }
+    return atol(field + strlen("watchers="));
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 6) {
+        fprintf(stderr, "Usage: %s <uri> <server_pid> <watchers> <indices> <rounds>\n", argv[0]);
+        return -1;
+    }
+    const char *uri = argv[1];
+    int server_pid = atoi(argv[2]);
+    int count = atoi(argv[3]);
+    int indices = atoi(argv[4]);
+    int rounds = atoi(argv[5]);
+    if (count <= 0 || indices <= 0 || rounds <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    DbClient *control = db_client_open(uri, "WRITER", 1);
+    if (!control) {
+        return -1;
+    }
+    long base_watchers = parked_watchers(control);
+    long rss_before = rss_kb(server_pid);
+    BenchWatcher *watchers = calloc(count, sizeof(BenchWatcher));
+    int epoll_fd = epoll_create1(0);
+    char request[64];
+    for (int i = 0; i < count; ++i) {
+        watchers[i].index = i % indices;
+        snprintf(request, sizeof(request), "WATCH %d", watchers[i].index);
+        if (channel_connect(&watchers[i].chan, uri) < 0 || channel_send_all(&watchers[i].chan, "READER\n", 7) < 0 ||
+            send_frame(&watchers[i].chan, request) < 0) {
+            fprintf(stderr, "Failed to open watcher %d\n", i);
+            return -1;
+        }
+        struct epoll_event event = {EPOLLIN, {.u32 = i}};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, watchers[i].chan.fd, &event);
+    }
+    double parked_at = now_us();
+    while (parked_watchers(control) - base_watchers < count) {
+        if (now_us() - parked_at > PARK_TIMEOUT_US) {
+            fprintf(stderr, "Watchers did not park\n");
+            return -1;
+        }
+        usleep(10000);
+    }
+    sleep(1);
+    long rss_after = rss_kb(server_pid);
+
+    double *latencies = malloc(sizeof(double) * ((long)count / indices + 1) * rounds);
+    long samples = 0;
+    double wake_all_total = 0;
+    struct epoll_event events[EPOLL_BATCH];
+    for (int round = 0; round < rounds; ++round) {
+        int index = round % indices;
+        int expected = count / indices + (index < count % indices);
+        int old_value;
+        double started = now_us();
+        if (db_write(control, index, round, &old_value, REQUEST_TIMEOUT_MS) != DB_OK) {
+            fprintf(stderr, "Write failed\n");
+            return -1;
+        }
+        double last = started;
+        for (int received = 0; received < expected;) {
+            int n = epoll_wait(epoll_fd, events, EPOLL_BATCH, ROUND_TIMEOUT_MS);
+            if (n <= 0) {
+                fprintf(stderr, "Notification timed out in round %d (%d of %d)\n", round, received, expected);
+                return -1;
+            }
+            for (int i = 0; i < n; ++i) {
+                BenchWatcher *watcher = &watchers[events[i].data.u32];
+                char reply[DB_REPLY_SIZE];
+                int value;
+                unsigned version;
+                if (recv_frame(&watcher->chan, reply, sizeof(reply)) < 0 ||
+                    sscanf(reply, "CHANGED %d %u", &value, &version) != 2) {
+                    fprintf(stderr, "Bad notification\n");
+                    return -1;
+                }
+                last = now_us();
+                latencies[samples++] = last - started;
+                ++received;
+                snprintf(request, sizeof(request), "WATCH %d %u", watcher->index, version);
+                send_frame(&watcher->chan, request);
+            }
+        }
+        wake_all_total += last - started;
+    }
+
+    qsort(latencies, samples, sizeof(double), compare);
+    printf("watchers=%d indices=%d rounds=%d rss_per_watcher_bytes=%.0f notify_p50_us=%.1f notify_p99_us=%.1f "
+           "notify_max_us=%.1f wake_all_avg_us=%.1f\n",
+           count, indices, rounds, rss_before >= 0 && rss_after >= 0 ? (rss_after - rss_before) * 1024.0 / count : -1.0,
+           latencies[samples / 2], latencies[samples * 99 / 100], latencies[samples - 1], wake_all_total / rounds);
+    for (int i = 0; i < count; ++i) {
+        channel_close(&watchers[i].chan);
+    }
+    free(watchers);
+    free(latencies);
+    close(epoll_fd);
+    db_client_close(control);
+    return 0;
+}
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC 0x31544b4342444d4fULL
+#define CHECKPOINT_HEADER_SIZE 4096
+#define WAL_MAGIC 0x4c415744u
+#define REPLAY_BATCH 8192
+#define LOG_BATCH 256
+
+typedef struct {
+    uint64_t magic;
+    uint64_t gen;
+    uint64_t size;
+} CheckpointHeader;
+
+typedef struct {
+    uint32_t index;
+    int32_t value;
+    uint32_t check;
+} WalRecord;
+
+static char data_dir[PATH_MAX];
+static unsigned long wal_gen;
+static unsigned long pending_gen;
+static int wal_fd = -1;
+
+static int data_path(char *path, const char *name, unsigned long gen) {
+    if (snprintf(path, PATH_MAX, "%s/%s.%lu", data_dir, name, gen) >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_gen(const char *name, const char *prefix, unsigned long *gen) {
+    size_t len = strlen(prefix);
+    if (strncmp(name, prefix, len) != 0 || name[len] != '.') {
+        return 0;
+    }
+    char *end;
+    errno = 0;
+    *gen = strtoul(name + len + 1, &end, 10);
+    return errno == 0 && end != name + len + 1 && *end == '\0';
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len > (1 << 24) ? (1 << 24) : len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int open_checkpoint(const char *path, CheckpointHeader *header) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (pread(fd, header, sizeof(*header), 0) != sizeof(*header) || fstat(fd, &st) < 0 ||
+        header->magic != CHECKPOINT_MAGIC ||
+        (uint64_t)st.st_size != CHECKPOINT_HEADER_SIZE + header->size * sizeof(int)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int checkpoint_load(const char *dir, int **db, size_t *size) {
+    if (snprintf(data_dir, sizeof(data_dir), "%s", dir) >= (int)sizeof(data_dir)) {
+        fprintf(stderr, "Data dir path too long\n");
+        return -1;
+    }
+    if (mkdir(data_dir, 0755) < 0 && errno != EEXIST) {
+        perror("mkdir() data dir failed");
+        return -1;
+    }
+
+    DIR *d = opendir(data_dir);
+    if (!d) {
+        perror("opendir() data dir failed");
+        return -1;
+    }
+    int found = 0;
+    unsigned long best_gen = 0;
+    struct dirent *entry;
+    char path[PATH_MAX];
+    while ((entry = readdir(d)) != NULL) {
+        unsigned long gen;
+        if (!parse_gen(entry->d_name, "checkpoint", &gen) || (found && gen <= best_gen)) {
+            continue;
+        }
+        CheckpointHeader header;
+        if (data_path(path, "checkpoint", gen) < 0) {
+            continue;
+        }
+        int fd = open_checkpoint(path, &header);
+        if (fd < 0) {
+            fprintf(stderr, "Skipping damaged checkpoint %s\n", path);
+            continue;
+        }
+        close(fd);
+        found = 1;
+        best_gen = gen;
+    }
+    closedir(d);
+
+    wal_gen = best_gen;
+    if (!found) {
+        return 0;
+    }
+
+    CheckpointHeader header;
+    int fd = data_path(path, "checkpoint", best_gen) < 0 ? -1 : open_checkpoint(path, &header);
+    if (fd < 0) {
+        perror("open() checkpoint failed");
+        return -1;
+    }
+    void *map = mmap(NULL, CHECKPOINT_HEADER_SIZE + header.size * sizeof(int), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap() checkpoint failed");
+        return -1;
+    }
+    *db = (int *)((char *)map + CHECKPOINT_HEADER_SIZE);
+    *size = header.size;
+    return 1;
+}
+
+long checkpoint_replay(int *db, size_t size) {
+    WalRecord records[REPLAY_BATCH];
+    char path[PATH_MAX];
+    long applied = 0;
+
+    for (;; ++wal_gen) {
+        int fd = data_path(path, "wal", wal_gen) < 0 ? -1 : open(path, O_RDONLY);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                break;
+            }
+            perror("open() wal failed");
+            return -1;
+        }
+        ssize_t n;
+        int torn = 0;
+        while (!torn && (n = read(fd, records, sizeof(records))) > 0) {
+            size_t count = n / sizeof(WalRecord);
+            for (size_t i = 0; i < count; ++i) {
+                if ((records[i].index ^ (uint32_t)records[i].value ^ WAL_MAGIC) != records[i].check ||
+                    records[i].index >= size) {
+                    torn = 1;
+                    break;
+                }
+                db[records[i].index] = records[i].value;
+                ++applied;
+            }
+            if (n % sizeof(WalRecord) != 0) {
+                torn = 1;
+            }
+        }
+        close(fd);
+    }
+    return applied;
+}
+
+int checkpoint_log_open(void) {
+    char path[PATH_MAX];
+    wal_fd = data_path(path, "wal", wal_gen) < 0 ? -1 : open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (wal_fd < 0) {
+        perror("open() wal failed");
+        return -1;
+    }
+    return 0;
+}
+
+int checkpoint_log(int index, int value) {
+    return checkpoint_log_batch(&index, &value, 1);
+}
+
+int checkpoint_log_batch(const int *indices, const int *values, int count) {
+    if (wal_fd < 0) {
+        return 0;
+    }
+    WalRecord records[LOG_BATCH];
+    for (int done = 0; done < count;) {
+        int n = count - done < LOG_BATCH ? count - done : LOG_BATCH;
+        for (int i = 0; i < n; ++i) {
+            records[i].index = indices[done + i];
+            records[i].value = values[done + i];
+            records[i].check = records[i].index ^ (uint32_t)records[i].value ^ WAL_MAGIC;
+        }
+        if (write_all(wal_fd, records, n * sizeof(WalRecord)) < 0) {
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+static int write_checkpoint(const char *tmp_path, const char *path, unsigned long gen, const int *db, size_t size) {
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    char header[CHECKPOINT_HEADER_SIZE] = {0};
+    CheckpointHeader *h = (CheckpointHeader *)header;
+    h->magic = CHECKPOINT_MAGIC;
+    h->gen = gen;
+    h->size = size;
+    if (write_all(fd, header, sizeof(header)) < 0 || write_all(fd, db, size * sizeof(int)) < 0 ||
+        fsync(fd) < 0) {
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+    close(fd);
+    if (rename(tmp_path, path) < 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    int dir_fd = open(data_dir, O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return 0;
+}
+
+pid_t checkpoint_fork(const int *db, size_t size) {
+    unsigned long gen = wal_gen + 1;
+    char wal_path[PATH_MAX];
+    char tmp_path[PATH_MAX];
+    char path[PATH_MAX];
+    if (data_path(wal_path, "wal", gen) < 0 || data_path(tmp_path, "checkpoint.tmp", gen) < 0 ||
+        data_path(path, "checkpoint", gen) < 0) {
+        perror("checkpoint path failed");
+        return -1;
+    }
+
+    int new_fd = open(wal_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (new_fd < 0) {
+        perror("open() wal failed");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork() failed");
+        close(new_fd);
+        unlink(wal_path);
+        return -1;
+    }
+    if (pid == 0) {
+        _exit(write_checkpoint(tmp_path, path, gen, db, size) == 0 ? 0 : 1);
+    }
+    if (wal_fd >= 0) {
+        close(wal_fd);
+    }
+    wal_fd = new_fd;
+    wal_gen = gen;
+    pending_gen = gen;
+    return pid;
+}
+
+int checkpoint_wait(pid_t pid) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            perror("waitpid() failed");
+            return -1;
+        }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Checkpoint %lu failed\n", pending_gen);
+        return -1;
+    }
+
+    DIR *d = opendir(data_dir);
+    if (!d) {
+        return 0;
+    }
+    struct dirent *entry;
+    char path[PATH_MAX];
+    while ((entry = readdir(d)) != NULL) {
+        unsigned long gen;
+        if ((parse_gen(entry->d_name, "checkpoint", &gen) || parse_gen(entry->d_name, "wal", &gen) ||
+             parse_gen(entry->d_name, "checkpoint.tmp", &gen)) && gen < pending_gen) {
+            if (snprintf(path, sizeof(path), "%s/%s", data_dir, entry->d_name) < (int)sizeof(path)) {
+                unlink(path);
+            }
+        }
+    }
+    closedir(d);
+    return 0;
+}
+
+void checkpoint_close(void) {
+    if (wal_fd >= 0) {
+        close(wal_fd);
+        wal_fd = -1;
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+int checkpoint_load(const char *dir, int **db, size_t *size);
+long checkpoint_replay(int *db, size_t size);
+int checkpoint_log_open(void);
+int checkpoint_log(int index, int value);
+int checkpoint_log_batch(const int *indices, const int *values, int count);
+pid_t checkpoint_fork(const int *db, size_t size);
+int checkpoint_wait(pid_t pid);
+void checkpoint_close(void);
+
+#endif
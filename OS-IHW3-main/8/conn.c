@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "conn.h"
+
+int frame_vappendf(FrameBuffer *buf, const char *fmt, va_list args) {
+    size_t room = sizeof(buf->data) - buf->len;
+    if (room <= sizeof(int)) {
+        return -1;
+    }
+    int n = vsnprintf(buf->data + buf->len + sizeof(int), room - sizeof(int), fmt, args);
+    if (n < 0 || (size_t)n >= room - sizeof(int)) {
+        return -1;
+    }
+    memcpy(buf->data + buf->len, &n, sizeof(int));
+    buf->len += sizeof(int) + n;
+    return 0;
+}
+
+int frame_append(FrameBuffer *buf, const void *data, size_t len) {
+    if (sizeof(buf->data) - buf->len < sizeof(int) + len) {
+        return -1;
+    }
+    int n = len;
+    memcpy(buf->data + buf->len, &n, sizeof(int));
+    memcpy(buf->data + buf->len + sizeof(int), data, len);
+    buf->len += sizeof(int) + len;
+    return 0;
+}
+
+int frame_appendf(FrameBuffer *buf, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int result = frame_vappendf(buf, fmt, args);
+    va_end(args);
+    return result;
+}
+
+int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+void conn_init(Conn *conn, const Channel *chan) {
+    conn->chan = *chan;
+    conn->in_start = 0;
+    conn->in_end = 0;
+    conn->fill_start = 0;
+    conn->arrival_us = 0;
+    conn->head_arrival_us = 0;
+    conn->fill_arrival_us = 0;
+    conn->out.len = 0;
+}
+
+ssize_t conn_fill(Conn *conn) {
+    if (conn->in_start == conn->in_end) {
+        conn->in_start = 0;
+        conn->in_end = 0;
+    } else if (conn->in_start > 0 && conn->in_end == sizeof(conn->in)) {
+        memmove(conn->in, conn->in + conn->in_start, conn->in_end - conn->in_start);
+        conn->fill_start = conn->fill_start > conn->in_start ? conn->fill_start - conn->in_start : 0;
+        conn->in_end -= conn->in_start;
+        conn->in_start = 0;
+    }
+    long arrival_us;
+    ssize_t n = channel_recv_ts(&conn->chan, conn->in + conn->in_end, sizeof(conn->in) - conn->in_end, &arrival_us);
+    if (n > 0) {
+        if (conn->in_start >= conn->fill_start) {
+            conn->head_arrival_us = conn->fill_arrival_us;
+        }
+        conn->fill_start = conn->in_end;
+        conn->fill_arrival_us = arrival_us;
+        conn->in_end += n;
+    }
+    return n;
+}
+
+int conn_handshake(Conn *conn, char *handshake, size_t cap) {
+    if (conn->in_end == 0 && conn_fill(conn) <= 0) {
+        return -1;
+    }
+    char *end = memchr(conn->in, '\n', conn->in_end);
+    size_t len = end ? (size_t)(end - conn->in) : conn->in_end;
+    if (len >= cap) {
+        return -1;
+    }
+    memcpy(handshake, conn->in, len);
+    handshake[len] = '\0';
+    conn->in_start = end ? len + 1 : conn->in_end;
+    return len;
+}
+
+int conn_next_frame(Conn *conn, char *frame, size_t cap) {
+    size_t available = conn->in_end - conn->in_start;
+    if (available < sizeof(int)) {
+        return 0;
+    }
+    int len;
+    memcpy(&len, conn->in + conn->in_start, sizeof(int));
+    if (len <= 0 || (size_t)len >= cap) {
+        return -1;
+    }
+    if (available < sizeof(int) + len) {
+        return 0;
+    }
+    memcpy(frame, conn->in + conn->in_start + sizeof(int), len);
+    frame[len] = '\0';
+    conn->arrival_us = conn->in_start < conn->fill_start ? conn->head_arrival_us : conn->fill_arrival_us;
+    conn->in_start += sizeof(int) + len;
+    return len;
+}
+
+int conn_replyf(Conn *conn, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int result = frame_vappendf(&conn->out, fmt, args);
+    va_end(args);
+    if (result < 0) {
+        if (conn_flush(conn) < 0) {
+            return -1;
+        }
+        va_start(args, fmt);
+        result = frame_vappendf(&conn->out, fmt, args);
+        va_end(args);
+    }
+    return result;
+}
+
+int conn_flush(Conn *conn) {
+    if (conn->out.len == 0) {
+        return 0;
+    }
+    int result = channel_send_all(&conn->chan, conn->out.data, conn->out.len);
+    conn->out.len = 0;
+    return result;
+}
@@ -0,0 +1,42 @@
+#ifndef CONN_H
+#define CONN_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "transport.h"
+
+#define CONN_BUF_SIZE 16384
+#define CONN_MAX_FRAME 1024
+
+typedef struct {
+    size_t len;
+    char data[CONN_BUF_SIZE];
+} FrameBuffer;
+
+typedef struct {
+    Channel chan;
+    long arrival_us;
+    long head_arrival_us;
+    long fill_arrival_us;
+    size_t fill_start;
+    size_t in_start;
+    size_t in_end;
+    char in[CONN_BUF_SIZE];
+    FrameBuffer out;
+} Conn;
+
+int frame_vappendf(FrameBuffer *buf, const char *fmt, va_list args);
+int frame_append(FrameBuffer *buf, const void *data, size_t len);
+int frame_appendf(FrameBuffer *buf, const char *fmt, ...);
+int send_all(int fd, const char *data, size_t len);
+
+void conn_init(Conn *conn, const Channel *chan);
+ssize_t conn_fill(Conn *conn);
+int conn_handshake(Conn *conn, char *handshake, size_t cap);
+int conn_next_frame(Conn *conn, char *frame, size_t cap);
+int conn_replyf(Conn *conn, const char *fmt, ...);
+int conn_flush(Conn *conn);
+
+#endif
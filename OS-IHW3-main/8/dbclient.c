@@ -0,0 +1,1060 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <zlib.h>
+
+#include "dbclient.h"
+#include "frame.h"
+#include "udpfan.h"
+#include "eventcodec.h"
+
+#define RETRY_TOKEN 1000
+#define RECONNECT_POLL_US 1000
+#define BULK_PAIR_SIZE 32
+#define UDP_FETCH_MAX 4096
+
+typedef struct {
+    char *reply;
+    int cap;
+    int len;
+    int done;
+} DbCall;
+
+typedef struct {
+    int index;
+    int value;
+    long expires_us;
+    unsigned generation;
+} DbCacheEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    DbCacheEntry entries[DB_CACHE_SLOTS];
+    unsigned epoch;
+    int live;
+    int connected;
+    int closing;
+    Channel chan;
+    pthread_t thread;
+} DbCache;
+
+typedef struct {
+    Channel chan;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_mutex_t bulk_lock;
+    DbCall *pending[DB_MAX_PIPELINE];
+    unsigned head;
+    unsigned tail;
+    int broken;
+    int reconnecting;
+    int attempts;
+    long retry_at_us;
+    int receiver_running;
+    char *out;
+    pthread_t receiver;
+    struct DbClient *client;
+} DbConn;
+
+struct DbClient {
+    DbConn *conns;
+    int count;
+    unsigned next;
+    char uri[256];
+    char handshake[64];
+    DbRetryPolicy policy;
+    long retry_tokens;
+    DbClientStats stats;
+    DbCache *cache;
+    int deadlines;
+};
+
+struct DbWatcher {
+    DbClient *client;
+};
+
+static void deadline_after(struct timespec *deadline, int timeout_ms) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += timeout_ms % 1000 * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec += 1;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static long remaining_us(const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (deadline->tv_sec - now.tv_sec) * 1000000L + (deadline->tv_nsec - now.tv_nsec) / 1000;
+}
+
+static long now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000L + now.tv_nsec / 1000;
+}
+
+static long backoff_us(const DbRetryPolicy *policy, int attempt) {
+    long cap = policy->backoff_min_ms * 1000L << (attempt < 20 ? attempt : 20);
+    if (cap > policy->backoff_max_ms * 1000L) {
+        cap = policy->backoff_max_ms * 1000L;
+    }
+    if (!policy->jitter || cap <= 0) {
+        return cap;
+    }
+    return random() % (cap + 1);
+}
+
+static int sleep_us(long delay, const struct timespec *deadline) {
+    if (deadline && remaining_us(deadline) < delay) {
+        return -1;
+    }
+    struct timespec ts = {delay / 1000000, delay % 1000000 * 1000};
+    nanosleep(&ts, NULL);
+    return 0;
+}
+
+static int take_retry_token(DbClient *client) {
+    long tokens = __atomic_load_n(&client->retry_tokens, __ATOMIC_RELAXED);
+    do {
+        if (tokens < RETRY_TOKEN) {
+            __atomic_add_fetch(&client->stats.retries_denied, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&client->retry_tokens, &tokens, tokens - RETRY_TOKEN, 0, __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+    __atomic_add_fetch(&client->stats.retries, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void earn_retry_tokens(DbClient *client, int count) {
+    long earned = (long)count * client->policy.budget_percent * RETRY_TOKEN / 100;
+    long cap = (long)client->policy.retry_budget * RETRY_TOKEN;
+    long tokens = __atomic_load_n(&client->retry_tokens, __ATOMIC_RELAXED);
+    long next;
+    do {
+        next = tokens + earned > cap ? cap : tokens + earned;
+        if (next == tokens) {
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&client->retry_tokens, &tokens, next, 0, __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+}
+
+static int is_idempotent(const char *request) {
+    return strncmp(request, "READ", 4) == 0 || strncmp(request, "LEASE", 5) == 0 || strncmp(request, "WRITE", 5) == 0 ||
+           strncmp(request, "WATCH", 5) == 0 || strcmp(request, "STATS") == 0;
+}
+
+static int wait_locked(DbConn *conn, const struct timespec *deadline) {
+    if (!deadline) {
+        return pthread_cond_wait(&conn->cond, &conn->lock);
+    }
+    return pthread_cond_timedwait(&conn->cond, &conn->lock, deadline);
+}
+
+static void *receive_replies(void *arg) {
+    DbConn *conn = arg;
+    DbClient *client = conn->client;
+    char reply[DB_REPLY_SIZE];
+    int len;
+    while ((len = recv_frame(&conn->chan, reply, sizeof(reply))) >= 0) {
+        int count = 1;
+        if (sscanf(reply, "EXPIRED %d", &count) == 1) {
+            len = strlen("EXPIRED");
+            reply[len] = '\0';
+        }
+        pthread_mutex_lock(&conn->lock);
+        if (count <= 0 || conn->tail - conn->head < (unsigned)count) {
+            pthread_mutex_unlock(&conn->lock);
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            DbCall *call = conn->pending[conn->head++ % DB_MAX_PIPELINE];
+            if (call) {
+                call->len = len < call->cap ? len : call->cap - 1;
+                memcpy(call->reply, reply, call->len);
+                call->reply[call->len] = '\0';
+                call->done = 1;
+            }
+        }
+        pthread_cond_broadcast(&conn->cond);
+        pthread_mutex_unlock(&conn->lock);
+    }
+
+    pthread_mutex_lock(&conn->lock);
+    conn->retry_at_us = now_us() + backoff_us(&client->policy, 0);
+    __atomic_store_n(&conn->broken, 1, __ATOMIC_RELEASE);
+    for (; conn->head != conn->tail; ++conn->head) {
+        DbCall *call = conn->pending[conn->head % DB_MAX_PIPELINE];
+        if (call) {
+            call->len = -1;
+            call->done = 1;
+        }
+    }
+    pthread_cond_broadcast(&conn->cond);
+    pthread_mutex_unlock(&conn->lock);
+    return NULL;
+}
+
+static int submit(DbConn *conn, const char *const *requests, DbCall *calls, int count,
+                  const struct timespec *deadline, int propagate) {
+    pthread_mutex_lock(&conn->lock);
+    while (!conn->broken && conn->tail - conn->head + count > DB_MAX_PIPELINE) {
+        if (wait_locked(conn, deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&conn->lock);
+            return DB_TIMEOUT;
+        }
+    }
+    if (conn->broken) {
+        pthread_mutex_unlock(&conn->lock);
+        return DB_ERROR;
+    }
+    size_t out_len = 0;
+    for (int i = 0; i < count; ++i) {
+        char *frame = conn->out + out_len + sizeof(int);
+        int len = strlen(requests[i]);
+        int prefix = 0;
+        if (propagate && deadline && conn->client->deadlines) {
+            long budget = remaining_us(deadline);
+            prefix = snprintf(frame, DB_REPLY_SIZE, "DEADLINE %ld ", budget > 0 ? budget : 0);
+            prefix = prefix + len < DB_REPLY_SIZE ? prefix : 0;
+        }
+        len += prefix;
+        if (len >= DB_REPLY_SIZE) {
+            pthread_mutex_unlock(&conn->lock);
+            return DB_ERROR;
+        }
+        memcpy(conn->out + out_len, &len, sizeof(int));
+        memcpy(frame + prefix, requests[i], len - prefix);
+        out_len += sizeof(int) + len;
+    }
+    for (int i = 0; i < count; ++i) {
+        calls[i].done = 0;
+        conn->pending[conn->tail++ % DB_MAX_PIPELINE] = &calls[i];
+    }
+    if (channel_send_all(&conn->chan, conn->out, out_len) < 0) {
+        channel_shutdown(&conn->chan);
+    }
+    pthread_mutex_unlock(&conn->lock);
+    return DB_OK;
+}
+
+static int await(DbConn *conn, DbCall *calls, int count, const struct timespec *deadline) {
+    int status = DB_OK;
+    pthread_mutex_lock(&conn->lock);
+    for (int i = 0; i < count; ++i) {
+        while (!calls[i].done) {
+            if (wait_locked(conn, deadline) == ETIMEDOUT && !calls[i].done) {
+                for (unsigned seq = conn->head; seq != conn->tail; ++seq) {
+                    DbCall **slot = &conn->pending[seq % DB_MAX_PIPELINE];
+                    if (*slot >= calls && *slot < calls + count) {
+                        *slot = NULL;
+                    }
+                }
+                pthread_mutex_unlock(&conn->lock);
+                return DB_TIMEOUT;
+            }
+        }
+    }
+    pthread_mutex_unlock(&conn->lock);
+    return status;
+}
+
+static int connect_conn(DbClient *client, DbConn *conn) {
+    __atomic_add_fetch(&client->stats.connect_attempts, 1, __ATOMIC_RELAXED);
+    if (channel_connect(&conn->chan, client->uri) < 0) {
+        return -1;
+    }
+    if (channel_send_all(&conn->chan, client->handshake, strlen(client->handshake)) < 0) {
+        perror("Handshake send failed");
+        channel_close(&conn->chan);
+        return -1;
+    }
+    pthread_mutex_lock(&conn->lock);
+    conn->head = 0;
+    conn->tail = 0;
+    __atomic_store_n(&conn->broken, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&conn->lock);
+    if (pthread_create(&conn->receiver, NULL, receive_replies, conn) != 0) {
+        fprintf(stderr, "Error creating receiver thread\n");
+        pthread_mutex_lock(&conn->lock);
+        __atomic_store_n(&conn->broken, 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&conn->lock);
+        channel_close(&conn->chan);
+        return -1;
+    }
+    conn->receiver_running = 1;
+    return 0;
+}
+
+static void reconnect(DbClient *client, DbConn *conn) {
+    if (conn->receiver_running) {
+        pthread_join(conn->receiver, NULL);
+        conn->receiver_running = 0;
+        channel_close(&conn->chan);
+    }
+    if (connect_conn(client, conn) == 0) {
+        conn->attempts = 0;
+        __atomic_add_fetch(&client->stats.reconnects, 1, __ATOMIC_RELAXED);
+    } else {
+        pthread_mutex_lock(&conn->lock);
+        conn->retry_at_us = now_us() + backoff_us(&client->policy, ++conn->attempts);
+        pthread_mutex_unlock(&conn->lock);
+    }
+    __atomic_store_n(&conn->reconnecting, 0, __ATOMIC_RELEASE);
+}
+
+static DbConn *pick_conn(DbClient *client, long *retry_at_us) {
+    unsigned start = __atomic_fetch_add(&client->next, 1, __ATOMIC_RELAXED);
+    long now = now_us();
+    *retry_at_us = 0;
+    for (int i = 0; i < client->count; ++i) {
+        DbConn *conn = &client->conns[(start + i) % client->count];
+        if (!__atomic_load_n(&conn->broken, __ATOMIC_ACQUIRE)) {
+            return conn;
+        }
+        pthread_mutex_lock(&conn->lock);
+        long retry_at = conn->retry_at_us;
+        pthread_mutex_unlock(&conn->lock);
+        if (retry_at <= now && !__atomic_exchange_n(&conn->reconnecting, 1, __ATOMIC_ACQUIRE)) {
+            reconnect(client, conn);
+            if (!__atomic_load_n(&conn->broken, __ATOMIC_ACQUIRE)) {
+                return conn;
+            }
+            pthread_mutex_lock(&conn->lock);
+            retry_at = conn->retry_at_us;
+            pthread_mutex_unlock(&conn->lock);
+        }
+        if (*retry_at_us == 0 || retry_at < *retry_at_us) {
+            *retry_at_us = retry_at;
+        }
+    }
+    return NULL;
+}
+
+static int run_calls(DbClient *client, const char *const *requests, char *replies, int stride, int count,
+                     int timeout_ms) {
+    if (count <= 0 || count > DB_MAX_PIPELINE) {
+        return DB_ERROR;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (strlen(requests[i]) >= DB_REPLY_SIZE) {
+            return DB_ERROR;
+        }
+    }
+    struct timespec deadline_storage;
+    const struct timespec *deadline = NULL;
+    if (timeout_ms > 0) {
+        deadline_after(&deadline_storage, timeout_ms);
+        deadline = &deadline_storage;
+    }
+
+    DbCall calls[count];
+    const char *batch[count];
+    int order[count];
+    int pending = count;
+    for (int i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    for (int attempt = 0;;) {
+        for (int i = 0; i < pending; ++i) {
+            batch[i] = requests[order[i]];
+            calls[i].reply = replies + (size_t)order[i] * stride;
+            calls[i].cap = stride;
+        }
+        long retry_at_us;
+        DbConn *conn = pick_conn(client, &retry_at_us);
+        if (!conn) {
+            long delay = retry_at_us - now_us();
+            if (sleep_us(delay > 0 ? delay : RECONNECT_POLL_US, deadline) < 0) {
+                return DB_TIMEOUT;
+            }
+            continue;
+        }
+        int status = submit(conn, batch, calls, pending, deadline, 1);
+        if (status == DB_ERROR) {
+            continue;
+        }
+        if (status == DB_OK) {
+            status = await(conn, calls, pending, deadline);
+        }
+        if (status != DB_OK) {
+            return status;
+        }
+
+        int retry = 0;
+        int lost = 0;
+        int unsafe = 0;
+        for (int i = 0; i < pending; ++i) {
+            if (calls[i].len < 0) {
+                unsafe |= !is_idempotent(batch[i]);
+                ++lost;
+                order[retry++] = order[i];
+            } else if (strcmp(calls[i].reply, "BUSY") == 0) {
+                order[retry++] = order[i];
+            }
+        }
+        earn_retry_tokens(client, pending - retry);
+        if (retry == 0) {
+            return DB_OK;
+        }
+        if (unsafe) {
+            return DB_ERROR;
+        }
+        if (attempt == client->policy.max_retries || take_retry_token(client) < 0) {
+            return lost ? DB_ERROR : DB_BUSY;
+        }
+        if (sleep_us(backoff_us(&client->policy, attempt++), deadline) < 0) {
+            return DB_TIMEOUT;
+        }
+        pending = retry;
+    }
+}
+
+DbClient *db_client_open(const char *uri, const char *role, int connections) {
+    DbClient *client = calloc(1, sizeof(DbClient));
+    if (!client) {
+        perror("malloc failed");
+        return NULL;
+    }
+    client->conns = calloc(connections, sizeof(DbConn));
+    if (!client->conns) {
+        perror("malloc failed");
+        free(client);
+        return NULL;
+    }
+    snprintf(client->uri, sizeof(client->uri), "%s", uri);
+    snprintf(client->handshake, sizeof(client->handshake), "%s\n", role);
+    client->policy = (DbRetryPolicy){DB_MAX_RETRIES, DB_BACKOFF_MIN_MS, DB_BACKOFF_MAX_MS, DB_RETRY_BUDGET,
+                                     DB_RETRY_BUDGET_PERCENT, 1};
+    client->retry_tokens = (long)client->policy.retry_budget * RETRY_TOKEN;
+    client->deadlines = 0;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    for (; client->count < connections; ++client->count) {
+        DbConn *conn = &client->conns[client->count];
+        conn->client = client;
+        conn->out = malloc(DB_MAX_PIPELINE * (sizeof(int) + DB_REPLY_SIZE));
+        if (!conn->out) {
+            perror("malloc failed");
+            break;
+        }
+        pthread_mutex_init(&conn->lock, NULL);
+        pthread_cond_init(&conn->cond, &attr);
+        pthread_mutex_init(&conn->bulk_lock, NULL);
+        if (connect_conn(client, conn) < 0) {
+            pthread_mutex_destroy(&conn->lock);
+            pthread_cond_destroy(&conn->cond);
+            pthread_mutex_destroy(&conn->bulk_lock);
+            free(conn->out);
+            break;
+        }
+    }
+    pthread_condattr_destroy(&attr);
+    if (client->count < connections) {
+        db_client_close(client);
+        return NULL;
+    }
+    return client;
+}
+
+void db_client_set_retry(DbClient *client, const DbRetryPolicy *policy) {
+    client->policy = *policy;
+    __atomic_store_n(&client->retry_tokens, (long)policy->retry_budget * RETRY_TOKEN, __ATOMIC_RELAXED);
+}
+
+void db_client_set_deadlines(DbClient *client, int enabled) {
+    client->deadlines = enabled;
+}
+
+void db_client_stats(DbClient *client, DbClientStats *stats) {
+    stats->connect_attempts = __atomic_load_n(&client->stats.connect_attempts, __ATOMIC_RELAXED);
+    stats->reconnects = __atomic_load_n(&client->stats.reconnects, __ATOMIC_RELAXED);
+    stats->retries = __atomic_load_n(&client->stats.retries, __ATOMIC_RELAXED);
+    stats->retries_denied = __atomic_load_n(&client->stats.retries_denied, __ATOMIC_RELAXED);
+    stats->cache_hits = __atomic_load_n(&client->stats.cache_hits, __ATOMIC_RELAXED);
+    stats->cache_misses = __atomic_load_n(&client->stats.cache_misses, __ATOMIC_RELAXED);
+    stats->invalidations = __atomic_load_n(&client->stats.invalidations, __ATOMIC_RELAXED);
+}
+
+static void cache_reset(DbCache *cache, int live) {
+    pthread_mutex_lock(&cache->lock);
+    ++cache->epoch;
+    cache->live = live;
+    for (int i = 0; i < DB_CACHE_SLOTS; ++i) {
+        cache->entries[i].index = -1;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static void cache_invalidate(DbCache *cache, int index) {
+    DbCacheEntry *entry = &cache->entries[(unsigned)index % DB_CACHE_SLOTS];
+    pthread_mutex_lock(&cache->lock);
+    ++entry->generation;
+    entry->index = -1;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static int cache_lookup(DbClient *client, int index, int *value, unsigned *generation, unsigned *epoch) {
+    DbCache *cache = client->cache;
+    DbCacheEntry *entry = &cache->entries[(unsigned)index % DB_CACHE_SLOTS];
+    pthread_mutex_lock(&cache->lock);
+    int hit = cache->live && entry->index == index && entry->expires_us > now_us();
+    *value = entry->value;
+    *generation = entry->generation;
+    *epoch = cache->epoch;
+    pthread_mutex_unlock(&cache->lock);
+    __atomic_add_fetch(hit ? &client->stats.cache_hits : &client->stats.cache_misses, 1, __ATOMIC_RELAXED);
+    return hit;
+}
+
+static void cache_install(DbCache *cache, int index, int value, long expires_us, unsigned generation,
+                          unsigned epoch) {
+    DbCacheEntry *entry = &cache->entries[(unsigned)index % DB_CACHE_SLOTS];
+    pthread_mutex_lock(&cache->lock);
+    if (cache->live && cache->epoch == epoch && entry->generation == generation) {
+        entry->index = index;
+        entry->value = value;
+        entry->expires_us = expires_us;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static void apply_invalidations(DbClient *client, const char *frame) {
+    if (strcmp(frame, "INVALIDATE ALL") == 0) {
+        cache_reset(client->cache, 1);
+        return;
+    }
+    if (strncmp(frame, "INVALIDATE", 10) != 0) {
+        return;
+    }
+    const char *p = frame + 10;
+    char *end;
+    for (long index = strtol(p, &end, 10); end != p; index = strtol(p, &end, 10)) {
+        cache_invalidate(client->cache, index);
+        __atomic_add_fetch(&client->stats.invalidations, 1, __ATOMIC_RELAXED);
+        p = end;
+    }
+}
+
+static int subscribe_invalidations(DbClient *client) {
+    DbCache *cache = client->cache;
+    Channel chan;
+    if (channel_connect(&chan, client->uri) < 0) {
+        return -1;
+    }
+    const char handshake[] = "OBSERVER INVALIDATIONS\n";
+    if (channel_send_all(&chan, handshake, strlen(handshake)) < 0) {
+        channel_close(&chan);
+        return -1;
+    }
+    pthread_mutex_lock(&cache->lock);
+    if (cache->closing) {
+        pthread_mutex_unlock(&cache->lock);
+        channel_close(&chan);
+        return -1;
+    }
+    cache->chan = chan;
+    cache->connected = 1;
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+static void *receive_invalidations(void *arg) {
+    DbClient *client = arg;
+    DbCache *cache = client->cache;
+    char frame[DB_EVENT_FRAME_SIZE];
+    for (int attempt = 0; !__atomic_load_n(&cache->closing, __ATOMIC_ACQUIRE);) {
+        if (subscribe_invalidations(client) == 0) {
+            attempt = 0;
+            while (recv_frame(&cache->chan, frame, sizeof(frame)) >= 0) {
+                apply_invalidations(client, frame);
+            }
+            cache_reset(cache, 0);
+            pthread_mutex_lock(&cache->lock);
+            cache->connected = 0;
+            pthread_mutex_unlock(&cache->lock);
+            channel_close(&cache->chan);
+        }
+        struct timespec deadline;
+        deadline_after(&deadline, backoff_us(&client->policy, attempt++) / 1000);
+        pthread_mutex_lock(&cache->lock);
+        while (!cache->closing && pthread_cond_timedwait(&cache->cond, &cache->lock, &deadline) != ETIMEDOUT) {
+        }
+        pthread_mutex_unlock(&cache->lock);
+    }
+    return NULL;
+}
+
+int db_client_enable_cache(DbClient *client) {
+    if (client->cache) {
+        return DB_OK;
+    }
+    DbCache *cache = calloc(1, sizeof(DbCache));
+    if (!cache) {
+        perror("malloc failed");
+        return DB_ERROR;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_cond_init(&cache->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    for (int i = 0; i < DB_CACHE_SLOTS; ++i) {
+        cache->entries[i].index = -1;
+    }
+    client->cache = cache;
+    if (pthread_create(&cache->thread, NULL, receive_invalidations, client) != 0) {
+        fprintf(stderr, "Error creating invalidation thread\n");
+        client->cache = NULL;
+        pthread_mutex_destroy(&cache->lock);
+        pthread_cond_destroy(&cache->cond);
+        free(cache);
+        return DB_ERROR;
+    }
+    return DB_OK;
+}
+
+void db_client_close(DbClient *client) {
+    DbCache *cache = client->cache;
+    if (cache) {
+        pthread_mutex_lock(&cache->lock);
+        cache->closing = 1;
+        if (cache->connected) {
+            channel_shutdown(&cache->chan);
+        }
+        pthread_cond_broadcast(&cache->cond);
+        pthread_mutex_unlock(&cache->lock);
+        pthread_join(cache->thread, NULL);
+        pthread_mutex_destroy(&cache->lock);
+        pthread_cond_destroy(&cache->cond);
+        free(cache);
+    }
+    for (int i = 0; i < client->count; ++i) {
+        DbConn *conn = &client->conns[i];
+        if (conn->receiver_running) {
+            channel_shutdown(&conn->chan);
+            pthread_join(conn->receiver, NULL);
+            channel_close(&conn->chan);
+        }
+        pthread_mutex_destroy(&conn->lock);
+        pthread_cond_destroy(&conn->cond);
+        pthread_mutex_destroy(&conn->bulk_lock);
+        free(conn->out);
+    }
+    free(client->conns);
+    free(client);
+}
+
+int db_call(DbClient *client, const char *request, char *reply, int cap, int timeout_ms) {
+    return run_calls(client, &request, reply, cap, 1, timeout_ms);
+}
+
+int db_batch(DbClient *client, const char *const *requests, char (*replies)[DB_REPLY_SIZE], int count,
+             int timeout_ms) {
+    return run_calls(client, requests, replies[0], DB_REPLY_SIZE, count, timeout_ms);
+}
+
+static int reply_status(const char *reply) {
+    if (strcmp(reply, "EXPIRED") == 0) {
+        return DB_TIMEOUT;
+    }
+    return strncmp(reply, "ERROR", 5) == 0 ? DB_REJECTED : DB_ERROR;
+}
+
+int db_read(DbClient *client, int index, int *value, int timeout_ms) {
+    char request[64];
+    char reply[DB_REPLY_SIZE];
+    unsigned generation = 0, epoch = 0;
+    if (client->cache && cache_lookup(client, index, value, &generation, &epoch)) {
+        return DB_OK;
+    }
+    long sent_us = now_us();
+    snprintf(request, sizeof(request), client->cache ? "LEASE %d" : "READ %d", index);
+    int status = db_call(client, request, reply, sizeof(reply), timeout_ms);
+    if (status != DB_OK) {
+        return status;
+    }
+    int lease_ms;
+    if (client->cache && sscanf(reply, "LEASED %d %d", value, &lease_ms) == 2) {
+        cache_install(client->cache, index, *value, sent_us + lease_ms * 1000L, generation, epoch);
+        return DB_OK;
+    }
+    return sscanf(reply, "VALUE %d", value) == 1 ? DB_OK : reply_status(reply);
+}
+
+int db_write(DbClient *client, int index, int value, int *old_value, int timeout_ms) {
+    char request[64];
+    char reply[DB_REPLY_SIZE];
+    int new_value;
+    snprintf(request, sizeof(request), "WRITE %d %d", index, value);
+    int status = db_call(client, request, reply, sizeof(reply), timeout_ms);
+    if (client->cache) {
+        cache_invalidate(client->cache, index);
+    }
+    if (status != DB_OK) {
+        return status;
+    }
+    return sscanf(reply, "UPDATED FROM %d TO %d", old_value, &new_value) == 2 ? DB_OK : reply_status(reply);
+}
+
+int db_cas(DbClient *client, int index, int expected, int value, int *actual, int timeout_ms) {
+    char request[64];
+    char reply[DB_REPLY_SIZE];
+    int new_value;
+    snprintf(request, sizeof(request), "CAS %d %d %d", index, expected, value);
+    int status = db_call(client, request, reply, sizeof(reply), timeout_ms);
+    if (client->cache) {
+        cache_invalidate(client->cache, index);
+    }
+    if (status != DB_OK) {
+        return status;
+    }
+    if (sscanf(reply, "UPDATED FROM %d TO %d", actual, &new_value) == 2) {
+        return DB_OK;
+    }
+    return sscanf(reply, "MISMATCH %d", actual) == 1 ? DB_MISMATCH : reply_status(reply);
+}
+
+static int send_bulk(DbConn *conn, const int *indices, const int *values, int count, int *written,
+                     const struct timespec *deadline) {
+    char (*frames)[DB_REPLY_SIZE] = malloc(sizeof(*frames) * DB_MAX_PIPELINE);
+    if (!frames) {
+        return DB_ERROR;
+    }
+    const char *requests[DB_MAX_PIPELINE];
+    DbCall calls[DB_MAX_PIPELINE];
+    int status = DB_OK;
+    int next = 0;
+    int frame_count = 1;
+    int last = 0;
+    snprintf(frames[0], DB_REPLY_SIZE, "BULKWRITE %d", count);
+    while (status == DB_OK && next < count) {
+        for (; next < count && frame_count < DB_MAX_PIPELINE; ++frame_count) {
+            int len = snprintf(frames[frame_count], DB_REPLY_SIZE, "BULKDATA");
+            for (; next < count && len < DB_REPLY_SIZE - BULK_PAIR_SIZE; ++next) {
+                len += snprintf(frames[frame_count] + len, DB_REPLY_SIZE - len, " %d %d", indices[next],
+                                values[next]);
+            }
+        }
+        for (int i = 0; i < frame_count; ++i) {
+            requests[i] = frames[i];
+            calls[i].reply = frames[i];
+            calls[i].cap = DB_REPLY_SIZE;
+        }
+        status = submit(conn, requests, calls, frame_count, deadline, 0);
+        if (status == DB_OK) {
+            status = await(conn, calls, frame_count, deadline);
+        }
+        for (int i = 0; status == DB_OK && i < frame_count; ++i) {
+            if (calls[i].len < 0) {
+                status = DB_ERROR;
+            } else if (strncmp(calls[i].reply, "ERROR", 5) == 0) {
+                status = DB_REJECTED;
+            }
+        }
+        last = frame_count - 1;
+        frame_count = 0;
+    }
+    if (status == DB_OK && sscanf(frames[last], "BULKWRITTEN %d", written) != 1) {
+        status = DB_ERROR;
+    }
+    free(frames);
+    return status;
+}
+
+int db_bulk_write(DbClient *client, const int *indices, const int *values, int count, int *written,
+                  int timeout_ms) {
+    if (count <= 0) {
+        return DB_ERROR;
+    }
+    struct timespec deadline_storage;
+    const struct timespec *deadline = NULL;
+    if (timeout_ms > 0) {
+        deadline_after(&deadline_storage, timeout_ms);
+        deadline = &deadline_storage;
+    }
+    long retry_at_us;
+    DbConn *conn;
+    while (!(conn = pick_conn(client, &retry_at_us))) {
+        long delay = retry_at_us - now_us();
+        if (sleep_us(delay > 0 ? delay : RECONNECT_POLL_US, deadline) < 0) {
+            return DB_TIMEOUT;
+        }
+    }
+    pthread_mutex_lock(&conn->bulk_lock);
+    int status = send_bulk(conn, indices, values, count, written, deadline);
+    pthread_mutex_unlock(&conn->bulk_lock);
+    if (client->cache) {
+        for (int i = 0; i < count; ++i) {
+            cache_invalidate(client->cache, indices[i]);
+        }
+    }
+    return status;
+}
+
+DbWatcher *db_watcher_open(DbClient *client) {
+    char role[sizeof(client->handshake)];
+    snprintf(role, sizeof(role), "%.*s", (int)strcspn(client->handshake, "\n"), client->handshake);
+    DbWatcher *watcher = malloc(sizeof(DbWatcher));
+    if (!watcher) {
+        perror("malloc failed");
+        return NULL;
+    }
+    watcher->client = db_client_open(client->uri, role, 1);
+    if (!watcher->client) {
+        free(watcher);
+        return NULL;
+    }
+    db_client_set_retry(watcher->client, &client->policy);
+    return watcher;
+}
+
+void db_watcher_close(DbWatcher *watcher) {
+    db_client_close(watcher->client);
+    free(watcher);
+}
+
+int db_watch(DbWatcher *watcher, int index, unsigned *version, int *value, int timeout_ms) {
+    char request[64];
+    char reply[DB_REPLY_SIZE];
+    snprintf(request, sizeof(request), "WATCH %d %u", index, *version);
+    int status = db_call(watcher->client, request, reply, sizeof(reply), timeout_ms);
+    if (status != DB_OK) {
+        return status;
+    }
+    return sscanf(reply, "CHANGED %d %u", value, version) == 2 ? DB_OK : reply_status(reply);
+}
+
+static void deliver_frame(const char *event, unsigned long *from_seq,
+                          void (*on_event)(unsigned long seq, const char *event, void *arg), void *arg) {
+    unsigned long seq, last;
+    int offset;
+    if (sscanf(event, "GAP %lu %lu", &seq, &last) == 2) {
+        on_event(0, event, arg);
+        if (last + 1 > *from_seq) {
+            *from_seq = last + 1;
+        }
+    } else if (sscanf(event, "%lu %n", &seq, &offset) == 1) {
+        on_event(seq, event + offset, arg);
+        if (seq + 1 > *from_seq) {
+            *from_seq = seq + 1;
+        }
+    }
+}
+
+static int deliver_binary(const uint8_t *frame, size_t len, unsigned long *from_seq,
+                          void (*on_event)(unsigned long seq, const char *event, void *arg), void *arg) {
+    uint8_t inflated[DB_EVENT_FRAME_SIZE];
+    char text[DB_REPLY_SIZE];
+    uint64_t first, count;
+    size_t pos = 1, used;
+    if (len == 0) {
+        return -1;
+    }
+    if (frame[0] == 'G') {
+        if (!(used = varint_get(frame + pos, len - pos, &first)) ||
+            !varint_get(frame + pos + used, len - pos - used, &count)) {
+            return -1;
+        }
+        snprintf(text, sizeof(text), "GAP %lu %lu", (unsigned long)first, (unsigned long)count);
+        deliver_frame(text, from_seq, on_event, arg);
+        return 0;
+    }
+    if (frame[0] == 'Z') {
+        uint64_t raw_len;
+        if (!(used = varint_get(frame + pos, len - pos, &raw_len)) || raw_len > sizeof(inflated)) {
+            return -1;
+        }
+        uLongf inflated_len = raw_len;
+        if (uncompress(inflated, &inflated_len, frame + pos + used, len - pos - used) != Z_OK) {
+            return -1;
+        }
+        frame = inflated;
+        len = inflated_len;
+        pos = 0;
+    } else if (frame[0] != 'B') {
+        return -1;
+    }
+    if (!(used = varint_get(frame + pos, len - pos, &first))) {
+        return -1;
+    }
+    pos += used;
+    if (!(used = varint_get(frame + pos, len - pos, &count))) {
+        return -1;
+    }
+    pos += used;
+    Event prev = {0};
+    for (uint64_t i = 0; i < count; ++i) {
+        Event event;
+        if (!(used = event_decode(frame + pos, len - pos, &prev, &event))) {
+            return -1;
+        }
+        pos += used;
+        prev = event;
+        event_format(&event, text, sizeof(text));
+        on_event(first + i, text, arg);
+        *from_seq = first + i + 1;
+    }
+    return 0;
+}
+
+int db_subscribe(const char *uri, unsigned long *from_seq, int encoding,
+                 void (*on_event)(unsigned long seq, const char *event, void *arg), void *arg) {
+    Channel chan;
+    if (channel_connect(&chan, uri) < 0) {
+        return DB_ERROR;
+    }
+    char handshake[64];
+    snprintf(handshake, sizeof(handshake), "OBSERVER FROM %lu%s\n", *from_seq,
+             encoding == DB_EVENTS_ZLIB ? " ZLIB" : encoding == DB_EVENTS_BINARY ? " BINARY" : "");
+    if (channel_send_all(&chan, handshake, strlen(handshake)) < 0) {
+        perror("Handshake send failed");
+        channel_close(&chan);
+        return DB_ERROR;
+    }
+    char frame[DB_EVENT_FRAME_SIZE];
+    int len;
+    while ((len = recv_frame(&chan, frame, sizeof(frame))) >= 0) {
+        if (encoding == DB_EVENTS_TEXT) {
+            deliver_frame(frame, from_seq, on_event, arg);
+        } else if (deliver_binary((const uint8_t *)frame, len, from_seq, on_event, arg) < 0) {
+            fprintf(stderr, "Malformed event frame\n");
+            break;
+        }
+    }
+    channel_close(&chan);
+    return DB_OK;
+}
+
+static int fetch_missing(Channel *chan, unsigned long from, unsigned long seen, unsigned long *fetching) {
+    char request[64];
+    unsigned long to = seen - from > UDP_FETCH_MAX ? from + UDP_FETCH_MAX - 1 : seen - 1;
+    snprintf(request, sizeof(request), "FETCH %lu %lu", from, to);
+    *fetching = to;
+    return send_frame(chan, request);
+}
+
+int db_subscribe_udp(const char *uri, int udp_port, unsigned long *from_seq,
+                     void (*on_event)(unsigned long seq, const char *event, void *arg), void *arg) {
+    int udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {0};
+    socklen_t addr_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(udp_port);
+    int buffer_size = 4 << 20;
+    if (udp_fd < 0 || setsockopt(udp_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size)) < 0 ||
+        bind(udp_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(udp_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        perror("UDP socket setup failed");
+        if (udp_fd >= 0) {
+            close(udp_fd);
+        }
+        return DB_ERROR;
+    }
+    Channel chan;
+    if (channel_connect(&chan, uri) < 0) {
+        close(udp_fd);
+        return DB_ERROR;
+    }
+    char handshake[64];
+    snprintf(handshake, sizeof(handshake), "OBSERVER UDP %d\n", ntohs(addr.sin_port));
+    if (chan.shm || channel_send_all(&chan, handshake, strlen(handshake)) < 0) {
+        fprintf(stderr, "UDP subscription needs a socket side channel\n");
+        channel_close(&chan);
+        close(udp_fd);
+        return DB_ERROR;
+    }
+
+    struct sockaddr_in server = {0};
+    socklen_t server_len = sizeof(server);
+    if (getpeername(chan.fd, (struct sockaddr *)&server, &server_len) < 0 || server.sin_family != AF_INET) {
+        server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    struct pollfd fds[2] = {{udp_fd, POLLIN, 0}, {chan.fd, POLLIN, 0}};
+    union {
+        UdpEventHeader header;
+        char bytes[UDP_PAYLOAD_SIZE];
+    } datagram;
+    char event[DB_REPLY_SIZE];
+    unsigned long seen = *from_seq;
+    unsigned long fetching = 0;
+    while (poll(fds, 2, -1) >= 0) {
+        if (fds[1].revents) {
+            if (recv_frame(&chan, event, sizeof(event)) < 0) {
+                break;
+            }
+            deliver_frame(event, from_seq, on_event, arg);
+            if (fetching && *from_seq > fetching) {
+                fetching = 0;
+                if (seen > *from_seq && fetch_missing(&chan, *from_seq, seen, &fetching) < 0) {
+                    break;
+                }
+            }
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+        struct sockaddr_in source;
+        socklen_t source_len = sizeof(source);
+        ssize_t n = recvfrom(udp_fd, datagram.bytes, sizeof(datagram.bytes), 0, (struct sockaddr *)&source,
+                             &source_len);
+        if (n < (ssize_t)sizeof(UdpEventHeader) || source.sin_addr.s_addr != server.sin_addr.s_addr) {
+            continue;
+        }
+        unsigned long seq = datagram.header.first_seq;
+        uint32_t count = datagram.header.count;
+        if (count > (n - sizeof(UdpEventHeader)) / sizeof(int)) {
+            continue;
+        }
+        if (*from_seq == 0) {
+            *from_seq = seq;
+        }
+        if (seq + count > seen) {
+            seen = seq + count;
+        }
+        // Events after a gap come back over TCP in order; datagrams seen meanwhile only extend the range.
+        if (fetching) {
+            continue;
+        }
+        if (seq > *from_seq) {
+            if (fetch_missing(&chan, *from_seq, seen, &fetching) < 0) {
+                break;
+            }
+            continue;
+        }
+        size_t pos = sizeof(UdpEventHeader);
+        for (uint32_t i = 0; i < count && pos + sizeof(int) <= (size_t)n; ++i, ++seq) {
+            int len;
+            memcpy(&len, datagram.bytes + pos, sizeof(int));
+            if (len < 0 || len >= (int)sizeof(event) || pos + sizeof(int) + len > (size_t)n) {
+                break;
+            }
+            memcpy(event, datagram.bytes + pos + sizeof(int), len);
+            event[len] = '\0';
+            pos += sizeof(int) + len;
+            if (seq >= *from_seq) {
+                on_event(seq, event, arg);
+                *from_seq = seq + 1;
+            }
+        }
+    }
+    channel_close(&chan);
+    close(udp_fd);
+    return DB_OK;
+}
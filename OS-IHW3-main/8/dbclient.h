@@ -0,0 +1,73 @@
+#ifndef DBCLIENT_H
+#define DBCLIENT_H
+
+#define DB_REPLY_SIZE 1024
+#define DB_MAX_PIPELINE 256
+#define DB_EVENT_FRAME_SIZE 16384
+#define DB_MAX_RETRIES 8
+#define DB_BACKOFF_MIN_MS 10
+#define DB_BACKOFF_MAX_MS 2000
+#define DB_RETRY_BUDGET 100
+#define DB_RETRY_BUDGET_PERCENT 10
+#define DB_CACHE_SLOTS 4096
+
+enum {
+    DB_OK = 0,
+    DB_MISMATCH = 1,
+    DB_ERROR = -1,
+    DB_TIMEOUT = -2,
+    DB_BUSY = -3,
+    DB_REJECTED = -4
+};
+
+enum {
+    DB_EVENTS_TEXT,
+    DB_EVENTS_BINARY,
+    DB_EVENTS_ZLIB
+};
+
+typedef struct {
+    int max_retries;
+    int backoff_min_ms;
+    int backoff_max_ms;
+    int retry_budget;
+    int budget_percent;
+    int jitter;
+} DbRetryPolicy;
+
+typedef struct {
+    long connect_attempts;
+    long reconnects;
+    long retries;
+    long retries_denied;
+    long cache_hits;
+    long cache_misses;
+    long invalidations;
+} DbClientStats;
+
+typedef struct DbClient DbClient;
+typedef struct DbWatcher DbWatcher;
+
+DbClient *db_client_open(const char *uri, const char *role, int connections);
+void db_client_set_retry(DbClient *client, const DbRetryPolicy *policy);
+void db_client_set_deadlines(DbClient *client, int enabled);
+void db_client_stats(DbClient *client, DbClientStats *stats);
+int db_client_enable_cache(DbClient *client);
+void db_client_close(DbClient *client);
+int db_call(DbClient *client, const char *request, char *reply, int cap, int timeout_ms);
+int db_batch(DbClient *client, const char *const *requests, char (*replies)[DB_REPLY_SIZE], int count,
+             int timeout_ms);
+int db_read(DbClient *client, int index, int *value, int timeout_ms);
+int db_write(DbClient *client, int index, int value, int *old_value, int timeout_ms);
+int db_cas(DbClient *client, int index, int expected, int value, int *actual, int timeout_ms);
+int db_bulk_write(DbClient *client, const int *indices, const int *values, int count, int *written,
+                  int timeout_ms);
+DbWatcher *db_watcher_open(DbClient *client);
+void db_watcher_close(DbWatcher *watcher);
+int db_watch(DbWatcher *watcher, int index, unsigned *version, int *value, int timeout_ms);
+int db_subscribe(const char *uri, unsigned long *from_seq, int encoding,
+                 void (*on_event)(unsigned long seq, const char *event, void *arg), void *arg);
+int db_subscribe_udp(const char *uri, int udp_port, unsigned long *from_seq,
+                     void (*on_event)(unsigned long seq, const char *event, void *arg), void *arg);
+
+#endif
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "eventcodec.h"
+
+static const Event zero_event;
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static int has_value(const Event *event) {
+    return event->type == EVENT_READ || event->type == EVENT_UPDATE;
+}
+
+long event_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+size_t varint_put(uint8_t *out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+size_t varint_get(const uint8_t *in, size_t len, uint64_t *value) {
+    uint64_t result = 0;
+    for (size_t n = 0; n < len && n < 10; ++n) {
+        result |= (uint64_t)(in[n] & 0x7f) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+size_t event_encode(const Event *event, const Event *prev, uint8_t *out) {
+    if (!prev) {
+        prev = &zero_event;
+    }
+    size_t n = 0;
+    out[n++] = event->type;
+    n += varint_put(out + n, zigzag(event->ts_us - prev->ts_us));
+    if (has_value(event)) {
+        int base_index = has_value(prev) ? prev->index : 0;
+        int base_value = has_value(prev) ? prev->value : 0;
+        n += varint_put(out + n, zigzag((int64_t)event->index - base_index));
+        n += varint_put(out + n, zigzag((int64_t)event->value - base_value));
+    }
+    if (event->type == EVENT_UPDATE) {
+        n += varint_put(out + n, zigzag((int64_t)event->old_value - event->value));
+    }
+    return n;
+}
+
+size_t event_decode(const uint8_t *in, size_t len, const Event *prev, Event *event) {
+    if (!prev) {
+        prev = &zero_event;
+    }
+    if (len == 0 || in[0] < EVENT_READ || in[0] > EVENT_DISCONNECT) {
+        return 0;
+    }
+    *event = (Event){in[0]};
+    size_t n = 1;
+    uint64_t field;
+    size_t used = varint_get(in + n, len - n, &field);
+    if (!used) {
+        return 0;
+    }
+    event->ts_us = prev->ts_us + unzigzag(field);
+    n += used;
+    if (has_value(event)) {
+        if (!(used = varint_get(in + n, len - n, &field))) {
+            return 0;
+        }
+        event->index = (has_value(prev) ? prev->index : 0) + unzigzag(field);
+        n += used;
+        if (!(used = varint_get(in + n, len - n, &field))) {
+            return 0;
+        }
+        event->value = (has_value(prev) ? prev->value : 0) + unzigzag(field);
+        n += used;
+    }
+    if (event->type == EVENT_UPDATE) {
+        if (!(used = varint_get(in + n, len - n, &field))) {
+            return 0;
+        }
+        event->old_value = event->value + unzigzag(field);
+        n += used;
+    }
+    return n;
+}
+
+int event_format(const Event *event, char *text, size_t cap) {
+    switch (event->type) {
+        case EVENT_READ:
+            return snprintf(text, cap, "read value %d from index  %d", event->value, event->index);
+        case EVENT_UPDATE:
+            return snprintf(text, cap, "DB[%d] updated to %d (old value %d)", event->index, event->value,
+                            event->old_value);
+        case EVENT_CONNECT:
+            return snprintf(text, cap, "Client connected");
+        case EVENT_DISCONNECT:
+            return snprintf(text, cap, "Client disconnected");
+    }
+    return snprintf(text, cap, "unknown event");
+}
@@ -0,0 +1,31 @@
+#ifndef EVENTCODEC_H
+#define EVENTCODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EVENT_MAX_ENCODED 32
+
+typedef enum {
+    EVENT_READ = 1,
+    EVENT_UPDATE = 2,
+    EVENT_CONNECT = 3,
+    EVENT_DISCONNECT = 4
+} EventType;
+
+typedef struct {
+    EventType type;
+    long ts_us;
+    int index;
+    int value;
+    int old_value;
+} Event;
+
+long event_now_us(void);
+size_t varint_put(uint8_t *out, uint64_t value);
+size_t varint_get(const uint8_t *in, size_t len, uint64_t *value);
+size_t event_encode(const Event *event, const Event *prev, uint8_t *out);
+size_t event_decode(const uint8_t *in, size_t len, const Event *prev, Event *event);
+int event_format(const Event *event, char *text, size_t cap);
+
+#endif
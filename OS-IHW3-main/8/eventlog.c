@@ -0,0 +1,321 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <zlib.h>
+
+#include "eventlog.h"
+#include "eventcodec.h"
+
+#define EVENTLOG_MAGIC 0x32474f4c544e5645ULL
+#define EVENT_PAD UINT32_MAX
+#define EVENT_AVERAGE_SIZE 16
+#define EVENT_BATCH_SIZE 12288
+
+typedef struct {
+    uint64_t magic;
+    uint64_t max_events;
+    uint64_t capacity;
+    uint64_t first_seq;
+    uint64_t next_seq;
+    uint64_t head;
+    uint64_t tail;
+} EventLogHeader;
+
+static EventLogHeader *header;
+static uint64_t *offsets;
+static char *data;
+static size_t map_size;
+static int log_fd = -1;
+static int interrupted;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+
+static int map_log(int fd, size_t capacity) {
+    uint64_t max_events = capacity / EVENT_AVERAGE_SIZE + 1;
+    map_size = sizeof(EventLogHeader) + max_events * sizeof(uint64_t) + capacity;
+    if (ftruncate(fd, map_size) < 0) {
+        perror("ftruncate() event log failed");
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap() event log failed");
+        close(fd);
+        return -1;
+    }
+    log_fd = fd;
+    header = map;
+    offsets = (uint64_t *)(header + 1);
+    data = (char *)(offsets + max_events);
+    if (header->magic != EVENTLOG_MAGIC || header->max_events != max_events || header->capacity != capacity ||
+        header->first_seq > header->next_seq || header->head > header->tail ||
+        header->tail - header->head > capacity) {
+        header->magic = EVENTLOG_MAGIC;
+        header->max_events = max_events;
+        header->capacity = capacity;
+        header->first_seq = 1;
+        header->next_seq = 1;
+        header->head = 0;
+        header->tail = 0;
+    }
+    return 0;
+}
+
+int eventlog_open(const char *path, size_t capacity) {
+    int fd = path ? open(path, O_RDWR | O_CREAT, 0644) : memfd_create("eventlog", 0);
+    if (fd < 0) {
+        perror("open() event log failed");
+        return -1;
+    }
+    return map_log(fd, capacity);
+}
+
+int eventlog_adopt(int fd, size_t capacity) {
+    return map_log(fd, capacity);
+}
+
+int eventlog_fd(void) {
+    return log_fd;
+}
+
+size_t eventlog_capacity(void) {
+    return header->capacity;
+}
+
+void eventlog_interrupt(void) {
+    pthread_mutex_lock(&log_lock);
+    interrupted = 1;
+    pthread_cond_broadcast(&log_cond);
+    pthread_mutex_unlock(&log_lock);
+}
+
+static void evict_oldest(void) {
+    ++header->first_seq;
+    header->head = header->first_seq < header->next_seq ? offsets[header->first_seq % header->max_events]
+                                                        : header->tail;
+}
+
+static unsigned long append_locked(const void *record, size_t len) {
+    uint64_t need = sizeof(uint32_t) + len;
+    if (need > header->capacity / 2) {
+        return 0;
+    }
+    uint64_t pos = header->tail % header->capacity;
+    uint64_t pad = header->capacity - pos < need ? header->capacity - pos : 0;
+    while (header->first_seq < header->next_seq &&
+           (header->tail + pad + need - header->head > header->capacity ||
+            header->next_seq - header->first_seq >= header->max_events)) {
+        evict_oldest();
+    }
+    if (header->first_seq == header->next_seq) {
+        header->head = header->tail;
+    }
+    if (pad) {
+        if (pad >= sizeof(uint32_t)) {
+            uint32_t marker = EVENT_PAD;
+            memcpy(data + pos, &marker, sizeof(marker));
+        }
+        header->tail += pad;
+        pos = 0;
+    }
+    uint32_t record_len = len;
+    memcpy(data + pos, &record_len, sizeof(record_len));
+    memcpy(data + pos + sizeof(record_len), record, len);
+    unsigned long seq = header->next_seq++;
+    offsets[seq % header->max_events] = header->tail;
+    header->tail += need;
+    return seq;
+}
+
+unsigned long eventlog_append(const void *record, size_t len) {
+    pthread_mutex_lock(&log_lock);
+    unsigned long seq = append_locked(record, len);
+    pthread_cond_broadcast(&log_cond);
+    pthread_mutex_unlock(&log_lock);
+    return seq;
+}
+
+void eventlog_append_frames(const char *frames, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    pthread_mutex_lock(&log_lock);
+    for (size_t pos = 0; pos + sizeof(int) <= len;) {
+        int frame_len;
+        memcpy(&frame_len, frames + pos, sizeof(int));
+        append_locked(frames + pos + sizeof(int), frame_len);
+        pos += sizeof(int) + frame_len;
+    }
+    pthread_cond_broadcast(&log_cond);
+    pthread_mutex_unlock(&log_lock);
+}
+
+static void record_event(unsigned long seq, Event *event) {
+    const char *record = data + offsets[seq % header->max_events] % header->capacity;
+    uint32_t len;
+    memcpy(&len, record, sizeof(len));
+    if (!event_decode((const uint8_t *)record + sizeof(len), len, NULL, event)) {
+        *event = (Event){EVENT_READ};
+    }
+}
+
+static int copy_text_locked(unsigned long *cursor, unsigned long last, FrameBuffer *out, int with_seq) {
+    int count = 0;
+    if (*cursor < header->first_seq) {
+        if (with_seq && frame_appendf(out, "GAP %lu %lu", *cursor, (unsigned long)header->first_seq - 1) < 0) {
+            return 0;
+        }
+        *cursor = header->first_seq;
+    }
+    for (; *cursor < header->next_seq && *cursor <= last; ++*cursor, ++count) {
+        Event event;
+        char text[CONN_MAX_FRAME];
+        record_event(*cursor, &event);
+        event_format(&event, text, sizeof(text));
+        int result = with_seq ? frame_appendf(out, "%lu %s", *cursor, text) : frame_appendf(out, "%s", text);
+        if (result < 0) {
+            break;
+        }
+    }
+    return count;
+}
+
+static int copy_invalidations_locked(unsigned long *cursor, FrameBuffer *out) {
+    if (*cursor < header->first_seq) {
+        frame_appendf(out, "INVALIDATE ALL");
+        *cursor = header->first_seq;
+    }
+    char text[CONN_MAX_FRAME] = "INVALIDATE";
+    size_t len = strlen(text);
+    int count = 0;
+    for (; *cursor < header->next_seq && len + 16 < sizeof(text) && count < EVENT_BATCH_SIZE; ++*cursor, ++count) {
+        Event event;
+        record_event(*cursor, &event);
+        if (event.type == EVENT_UPDATE) {
+            len += snprintf(text + len, sizeof(text) - len, " %d", event.index);
+        }
+    }
+    if (len > strlen("INVALIDATE")) {
+        frame_append(out, text, len);
+    }
+    return count;
+}
+
+static int append_binary(FrameBuffer *out, uint8_t *events, size_t events_len, unsigned long first, int count,
+                         int compress) {
+    uint8_t header_bytes[2 * 10];
+    size_t header_len = varint_put(header_bytes, first);
+    header_len += varint_put(header_bytes + header_len, count);
+    uint8_t *raw = events - header_len;
+    memcpy(raw, header_bytes, header_len);
+    size_t raw_len = header_len + events_len;
+    if (!compress) {
+        *--raw = 'B';
+        return frame_append(out, raw, raw_len + 1);
+    }
+    uint8_t packed[EVENT_BATCH_SIZE + 64];
+    size_t packed_len = 1 + varint_put(packed + 1, raw_len);
+    uLongf deflated_len = sizeof(packed) - packed_len;
+    packed[0] = 'Z';
+    if (compress2(packed + packed_len, &deflated_len, raw, raw_len, Z_BEST_SPEED) != Z_OK) {
+        *--raw = 'B';
+        return frame_append(out, raw, raw_len + 1);
+    }
+    return frame_append(out, packed, packed_len + deflated_len);
+}
+
+int eventlog_read(unsigned long *cursor, FrameBuffer *out, EventFormat format) {
+    pthread_mutex_lock(&log_lock);
+    while (*cursor >= header->next_seq) {
+        if (interrupted) {
+            pthread_mutex_unlock(&log_lock);
+            return -1;
+        }
+        pthread_cond_wait(&log_cond, &log_lock);
+    }
+    if (format == EVENTS_TEXT || format == EVENTS_TEXT_SEQ) {
+        int count = copy_text_locked(cursor, ULONG_MAX, out, format == EVENTS_TEXT_SEQ);
+        pthread_mutex_unlock(&log_lock);
+        return count;
+    }
+    if (format == EVENTS_INVALIDATIONS) {
+        int count = copy_invalidations_locked(cursor, out);
+        pthread_mutex_unlock(&log_lock);
+        return count;
+    }
+
+    uint8_t buffer[1 + 2 * 10 + EVENT_BATCH_SIZE];
+    uint8_t *events = buffer + 1 + 2 * 10;
+    unsigned long gap_from = *cursor;
+    if (*cursor < header->first_seq) {
+        *cursor = header->first_seq;
+    }
+    unsigned long first = *cursor;
+    size_t len = 0;
+    int count = 0;
+    Event prev = {0};
+    for (; *cursor < header->next_seq && len + EVENT_MAX_ENCODED <= EVENT_BATCH_SIZE; ++*cursor, ++count) {
+        Event event;
+        record_event(*cursor, &event);
+        len += event_encode(&event, &prev, events + len);
+        prev = event;
+    }
+    pthread_mutex_unlock(&log_lock);
+
+    if (gap_from < first) {
+        uint8_t gap[1 + 2 * 10];
+        size_t gap_len = 1 + varint_put(gap + 1, gap_from);
+        gap_len += varint_put(gap + gap_len, first - 1);
+        gap[0] = 'G';
+        frame_append(out, gap, gap_len);
+    }
+    if (count > 0) {
+        append_binary(out, events, len, first, count, format == EVENTS_BINARY_ZLIB);
+    }
+    return count;
+}
+
+int eventlog_fetch(unsigned long *cursor, unsigned long last, FrameBuffer *out) {
+    pthread_mutex_lock(&log_lock);
+    int count = copy_text_locked(cursor, last, out, 1);
+    pthread_mutex_unlock(&log_lock);
+    return count;
+}
+
+unsigned long eventlog_first(void) {
+    pthread_mutex_lock(&log_lock);
+    unsigned long seq = header->first_seq;
+    pthread_mutex_unlock(&log_lock);
+    return seq;
+}
+
+unsigned long eventlog_next(void) {
+    pthread_mutex_lock(&log_lock);
+    unsigned long seq = header->next_seq;
+    pthread_mutex_unlock(&log_lock);
+    return seq;
+}
+
+size_t eventlog_used(void) {
+    pthread_mutex_lock(&log_lock);
+    size_t used = header->tail - header->head;
+    pthread_mutex_unlock(&log_lock);
+    return used;
+}
+
+void eventlog_close(void) {
+    if (header) {
+        munmap(header, map_size);
+        header = NULL;
+        close(log_fd);
+        log_fd = -1;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stddef.h>
+
+#include "conn.h"
+
+typedef enum {
+    EVENTS_TEXT,
+    EVENTS_TEXT_SEQ,
+    EVENTS_BINARY,
+    EVENTS_BINARY_ZLIB,
+    EVENTS_INVALIDATIONS
+} EventFormat;
+
+int eventlog_open(const char *path, size_t capacity);
+int eventlog_adopt(int fd, size_t capacity);
+int eventlog_fd(void);
+size_t eventlog_capacity(void);
+void eventlog_interrupt(void);
+unsigned long eventlog_append(const void *record, size_t len);
+void eventlog_append_frames(const char *frames, size_t len);
+int eventlog_read(unsigned long *cursor, FrameBuffer *out, EventFormat format);
+int eventlog_fetch(unsigned long *cursor, unsigned long last, FrameBuffer *out);
+unsigned long eventlog_first(void);
+unsigned long eventlog_next(void);
+size_t eventlog_used(void);
+void eventlog_close(void);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <string.h>
+
+#include "transport.h"
+
+static inline int recv_exact(Channel *chan, void *data, int len) {
+    char *p = data;
+    while (len > 0) {
+        int n = channel_recv(chan, p, len);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static inline int send_frame(Channel *chan, const char *message) {
+    char frame[1024 + sizeof(int)];
+    int len = strlen(message);
+    if (len >= 1024) {
+        return -1;
+    }
+    memcpy(frame, &len, sizeof(int));
+    memcpy(frame + sizeof(int), message, len);
+    return channel_send_all(chan, frame, sizeof(int) + len);
+}
+
+static inline int recv_frame(Channel *chan, char *buffer, int cap) {
+    int len;
+    if (recv_exact(chan, &len, sizeof(len)) < 0 || len < 0 || len >= cap) {
+        return -1;
+    }
+    if (recv_exact(chan, buffer, len) < 0) {
+        return -1;
+    }
+    buffer[len] = '\0';
+    return len;
+}
+
+#endif
@@ -0,0 +1,160 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "handoff.h"
+
+static int unix_addr(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Handoff path is too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+static int same_user(int fd) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        perror("SO_PEERCRED failed");
+        return 0;
+    }
+    if (cred.uid != geteuid()) {
+        fprintf(stderr, "Handoff peer runs as uid %d, not %d\n", (int)cred.uid, (int)geteuid());
+        return 0;
+    }
+    return 1;
+}
+
+int handoff_listen(const char *path) {
+    struct sockaddr_un addr;
+    if (unix_addr(path, &addr) < 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket() failed");
+        return -1;
+    }
+    unlink(path);
+    mode_t mask = umask(0077);
+    int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (bound < 0 || listen(fd, 1) < 0) {
+        perror("handoff listen failed");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int handoff_accept(int listener) {
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) {
+        perror("accept() failed");
+        return -1;
+    }
+    if (!same_user(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int handoff_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (unix_addr(path, &addr) < 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket() failed");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || !same_user(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int handoff_send(int sock, const void *data, size_t len, const int *fds, int fd_count) {
+    const char *p = data;
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    while (len > 0) {
+        struct iovec iov = {(void *)p, len};
+        struct msghdr msg = {0};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (fd_count > 0) {
+            memset(control, 0, sizeof(control));
+            msg.msg_control = control;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+            memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fd_count);
+        }
+        ssize_t n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("handoff send failed");
+            return -1;
+        }
+        fd_count = 0;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int handoff_recv(int sock, void *data, size_t len, int *fds, int max_fds) {
+    char *p = data;
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    int fd_count = 0;
+    while (len > 0) {
+        struct iovec iov = {p, len};
+        struct msghdr msg = {0};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+            int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (int i = 0; i < count; ++i) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (fd_count < max_fds) {
+                    fds[fd_count++] = fd;
+                } else {
+                    close(fd);
+                }
+            }
+        }
+        p += n;
+        len -= n;
+    }
+    return fd_count;
+}
@@ -0,0 +1,14 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <stddef.h>
+
+#define HANDOFF_MAX_FDS 16
+
+int handoff_listen(const char *path);
+int handoff_accept(int listener);
+int handoff_connect(const char *path);
+int handoff_send(int sock, const void *data, size_t len, const int *fds, int fd_count);
+int handoff_recv(int sock, void *data, size_t len, int *fds, int max_fds);
+
+#endif
@@ -0,0 +1,667 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "log.h"
+
+#define LOG_RING_SIZE 16384
+#define LOG_MAX_ARGS 512
+#define LOG_MAX_STRING 255
+#define LOG_LINE_SIZE 1024
+#define LOG_OUT_SIZE 65536
+#define LOG_FLUSH_MS 10
+#define LOG_MAX_FORMATS 4096
+#define LOG_SHUTDOWN_TRIES 100
+
+typedef struct {
+    uint32_t size;
+    uint8_t level;
+    uint8_t reserved;
+    uint16_t args_len;
+    uint64_t ts_ns;
+    const char *format;
+} LogRecord;
+
+typedef struct LogRing {
+    struct LogRing *next;
+    size_t head;
+    int closed;
+    _Alignas(64) size_t tail;
+    _Alignas(64) uint8_t data[LOG_RING_SIZE];
+} LogRing;
+
+typedef struct {
+    int fd;
+    size_t len;
+    char data[LOG_OUT_SIZE];
+} LogOut;
+
+typedef struct {
+    int stars;
+    char length;
+    char conv;
+    size_t len;
+} LogSpec;
+
+typedef struct {
+    const char *format;
+    uint32_t id;
+} LogFormatSlot;
+
+enum {
+    ARG_NONE,
+    ARG_INT,
+    ARG_WIDE,
+    ARG_DOUBLE,
+    ARG_POINTER,
+    ARG_STRING
+};
+
+static const char *mode_names[] = {"sync", "async", "binary"};
+static const char *level_names[] = {"debug", "info", "warn", "error"};
+
+static LogMode log_mode = LOG_SYNC;
+static LogLevel log_level = LOG_INFO;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static __thread LogRing *thread_ring;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static LogRing *rings;
+static LogRing *free_rings;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t drained_cond = PTHREAD_COND_INITIALIZER;
+static int wake_pending;
+static int stopping;
+static int flusher_running;
+static pthread_t flusher;
+static LogOut out_stdout = {STDOUT_FILENO};
+static LogOut out_stderr = {STDERR_FILENO};
+static LogFormatSlot format_slots[LOG_MAX_FORMATS];
+static uint32_t format_count;
+static uint32_t next_format_id;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int parse_spec(const char *p, LogSpec *spec) {
+    const char *q = p + 1;
+    spec->stars = 0;
+    q += strspn(q, "-+ #0'");
+    if (*q == '*') {
+        ++spec->stars;
+        ++q;
+    } else {
+        q += strspn(q, "0123456789");
+    }
+    if (*q == '.') {
+        ++q;
+        if (*q == '*') {
+            ++spec->stars;
+            ++q;
+        } else {
+            q += strspn(q, "0123456789");
+        }
+    }
+    spec->length = 0;
+    if (q[0] == 'h' && q[1] == 'h') {
+        spec->length = 'H';
+        q += 2;
+    } else if (q[0] == 'l' && q[1] == 'l') {
+        spec->length = 'q';
+        q += 2;
+    } else if (*q && strchr("hlzjtL", *q)) {
+        spec->length = *q++;
+    }
+    if (!*q) {
+        return -1;
+    }
+    spec->conv = *q;
+    spec->len = q + 1 - p;
+    return 0;
+}
+
+static int spec_kind(const LogSpec *spec) {
+    if (strchr("diouxXc", spec->conv)) {
+        return spec->length && spec->length != 'h' && spec->length != 'H' ? ARG_WIDE : ARG_INT;
+    }
+    if (strchr("fFeEgGaA", spec->conv)) {
+        return ARG_DOUBLE;
+    }
+    if (spec->conv == 's') {
+        return ARG_STRING;
+    }
+    if (spec->conv == 'p' || spec->conv == 'n') {
+        return ARG_POINTER;
+    }
+    return ARG_NONE;
+}
+
+static int put(uint8_t *args, size_t *len, const void *value, size_t size) {
+    if (*len + size > LOG_MAX_ARGS) {
+        return -1;
+    }
+    memcpy(args + *len, value, size);
+    *len += size;
+    return 0;
+}
+
+static size_t capture(uint8_t *args, const char *format, va_list ap) {
+    size_t len = 0;
+    for (const char *p = strchr(format, '%'); p; p = strchr(p, '%')) {
+        LogSpec spec;
+        if (parse_spec(p, &spec) < 0) {
+            break;
+        }
+        p += spec.len;
+        int64_t value;
+        double real;
+        for (int i = 0; i < spec.stars; ++i) {
+            value = va_arg(ap, int);
+            put(args, &len, &value, sizeof(value));
+        }
+        switch (spec_kind(&spec)) {
+        case ARG_INT:
+            value = va_arg(ap, int);
+            put(args, &len, &value, sizeof(value));
+            break;
+        case ARG_WIDE:
+            value = va_arg(ap, long long);
+            put(args, &len, &value, sizeof(value));
+            break;
+        case ARG_DOUBLE:
+            real = spec.length == 'L' ? (double)va_arg(ap, long double) : va_arg(ap, double);
+            put(args, &len, &real, sizeof(real));
+            break;
+        case ARG_POINTER:
+            value = (intptr_t)va_arg(ap, void *);
+            put(args, &len, &value, sizeof(value));
+            break;
+        case ARG_STRING: {
+            const char *text = va_arg(ap, const char *);
+            if (!text) {
+                text = "(null)";
+            }
+            if (len + sizeof(uint16_t) > LOG_MAX_ARGS) {
+                break;
+            }
+            uint16_t text_len = strnlen(text, LOG_MAX_STRING);
+            if (len + sizeof(uint16_t) + text_len > LOG_MAX_ARGS) {
+                text_len = LOG_MAX_ARGS - len - sizeof(uint16_t);
+            }
+            put(args, &len, &text_len, sizeof(text_len));
+            put(args, &len, text, text_len);
+            break;
+        }
+        }
+    }
+    return len;
+}
+
+static int take(const uint8_t *args, size_t args_len, size_t *pos, void *value, size_t size) {
+    if (*pos + size > args_len) {
+        return -1;
+    }
+    memcpy(value, args + *pos, size);
+    *pos += size;
+    return 0;
+}
+
+static size_t format_decimal(char *out, size_t room, int64_t value, int is_unsigned) {
+    char digits[24];
+    size_t n = 0;
+    uint64_t magnitude = is_unsigned || value >= 0 ? (uint64_t)value : -(uint64_t)value;
+    do {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (!is_unsigned && value < 0) {
+        digits[n++] = '-';
+    }
+    if (n >= room) {
+        return 0;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = digits[n - 1 - i];
+    }
+    return n;
+}
+
+#define LOG_EMIT(arg)                                                                                                \
+    (spec.stars == 0   ? snprintf(out + used, size - used, conv, arg)                                               \
+     : spec.stars == 1 ? snprintf(out + used, size - used, conv, stars[0], arg)                                     \
+                       : snprintf(out + used, size - used, conv, stars[0], stars[1], arg))
+
+size_t log_render(char *out, size_t size, const char *format, const uint8_t *args, size_t args_len) {
+    size_t used = 0, pos = 0;
+    if (size == 0) {
+        return 0;
+    }
+    const char *p = format;
+    while (*p && used + 1 < size) {
+        const char *next = strchr(p, '%');
+        size_t literal = next ? (size_t)(next - p) : strlen(p);
+        if (literal > size - used - 1) {
+            literal = size - used - 1;
+        }
+        memcpy(out + used, p, literal);
+        used += literal;
+        LogSpec spec;
+        if (!next || used + 1 >= size || parse_spec(next, &spec) < 0) {
+            break;
+        }
+        p = next + spec.len;
+        if (spec.conv == '%') {
+            out[used++] = '%';
+            continue;
+        }
+        int stars[2] = {0, 0};
+        int64_t value;
+        for (int i = 0; i < spec.stars; ++i) {
+            if (take(args, args_len, &pos, &value, sizeof(value)) < 0) {
+                break;
+            }
+            stars[i] = value;
+        }
+        int kind = spec_kind(&spec);
+        if (spec.stars == 0 && spec.len == 2u + (spec.length != 0) && strchr("diu", spec.conv) &&
+            (kind == ARG_WIDE || spec.length == 0)) {
+            if (take(args, args_len, &pos, &value, sizeof(value)) < 0) {
+                break;
+            }
+            if (spec.conv == 'u' && kind == ARG_INT) {
+                value = (unsigned)value;
+            }
+            used += format_decimal(out + used, size - used, value, spec.conv == 'u');
+            continue;
+        }
+        char conv[32];
+        if (spec.len >= sizeof(conv)) {
+            break;
+        }
+        memcpy(conv, next, spec.len);
+        conv[spec.len] = '\0';
+        if (spec.length == 'L') {
+            memmove(conv + spec.len - 2, conv + spec.len - 1, 2);
+        }
+        int written = 0;
+        double real;
+        uint16_t text_len;
+        char text[LOG_MAX_STRING + 1];
+        switch (kind) {
+        case ARG_INT:
+            if (take(args, args_len, &pos, &value, sizeof(value)) == 0) {
+                written = LOG_EMIT((int)value);
+            }
+            break;
+        case ARG_WIDE:
+            if (take(args, args_len, &pos, &value, sizeof(value)) == 0) {
+                written = LOG_EMIT((long long)value);
+            }
+            break;
+        case ARG_DOUBLE:
+            if (take(args, args_len, &pos, &real, sizeof(real)) == 0) {
+                written = LOG_EMIT(real);
+            }
+            break;
+        case ARG_POINTER:
+            if (take(args, args_len, &pos, &value, sizeof(value)) == 0 && spec.conv == 'p') {
+                written = LOG_EMIT((void *)(intptr_t)value);
+            }
+            break;
+        case ARG_STRING:
+            if (take(args, args_len, &pos, &text_len, sizeof(text_len)) == 0 && text_len <= LOG_MAX_STRING &&
+                take(args, args_len, &pos, text, text_len) == 0) {
+                text[text_len] = '\0';
+                written = LOG_EMIT(text);
+            }
+            break;
+        default:
+            written = snprintf(out + used, size - used, "%s", conv);
+        }
+        if (written > 0) {
+            used += (size_t)written < size - used ? (size_t)written : size - used - 1;
+        }
+    }
+    out[used] = '\0';
+    return used;
+}
+
+static void out_write(LogOut *out) {
+    size_t done = 0;
+    while (done < out->len) {
+        ssize_t n = write(out->fd, out->data + done, out->len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    out->len = 0;
+}
+
+static void out_append(LogOut *out, const void *data, size_t len) {
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+static uint32_t format_id(const char *format, int *added) {
+    if (format_count >= LOG_MAX_FORMATS / 2) {
+        memset(format_slots, 0, sizeof(format_slots));
+        format_count = 0;
+    }
+    size_t slot = ((uintptr_t)format >> 3) * 2654435761u & (LOG_MAX_FORMATS - 1);
+    while (format_slots[slot].format && format_slots[slot].format != format) {
+        slot = (slot + 1) & (LOG_MAX_FORMATS - 1);
+    }
+    *added = !format_slots[slot].format;
+    if (*added) {
+        format_slots[slot].format = format;
+        format_slots[slot].id = ++next_format_id;
+        ++format_count;
+    }
+    return format_slots[slot].id;
+}
+
+static void emit_binary(const LogRecord *record, const uint8_t *args) {
+    int added;
+    uint32_t id = format_id(record->format, &added);
+    size_t format_len = strnlen(record->format, LOG_LINE_SIZE);
+    if (out_stdout.len + 7 + format_len + 16 + record->args_len > LOG_OUT_SIZE) {
+        out_write(&out_stdout);
+    }
+    if (added) {
+        uint8_t type = LOG_RECORD_FORMAT;
+        uint16_t len = format_len;
+        out_append(&out_stdout, &type, sizeof(type));
+        out_append(&out_stdout, &id, sizeof(id));
+        out_append(&out_stdout, &len, sizeof(len));
+        out_append(&out_stdout, record->format, len);
+    }
+    uint8_t header[2] = {LOG_RECORD_MESSAGE, record->level};
+    out_append(&out_stdout, header, sizeof(header));
+    out_append(&out_stdout, &id, sizeof(id));
+    out_append(&out_stdout, &record->ts_ns, sizeof(record->ts_ns));
+    out_append(&out_stdout, &record->args_len, sizeof(record->args_len));
+    out_append(&out_stdout, args, record->args_len);
+}
+
+static void emit(const LogRecord *record) {
+    const uint8_t *args = (const uint8_t *)(record + 1);
+    if (log_mode == LOG_BINARY) {
+        emit_binary(record, args);
+        return;
+    }
+    LogOut *out = record->level >= LOG_WARN ? &out_stderr : &out_stdout;
+    if (out->len + LOG_LINE_SIZE > LOG_OUT_SIZE) {
+        out_write(out);
+    }
+    out->len += log_render(out->data + out->len, LOG_LINE_SIZE, record->format, args, record->args_len);
+}
+
+static const LogRecord *ring_peek(LogRing *ring) {
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t tail = ring->tail;
+    while (tail < head) {
+        size_t offset = tail % LOG_RING_SIZE;
+        if (LOG_RING_SIZE - offset < sizeof(LogRecord)) {
+            tail += LOG_RING_SIZE - offset;
+            continue;
+        }
+        const LogRecord *record = (const LogRecord *)(ring->data + offset);
+        if (record->format) {
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+            return record;
+        }
+        tail += record->size;
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void drain_rings(void) {
+    while (1) {
+        LogRing *oldest = NULL;
+        const LogRecord *oldest_record = NULL;
+        for (LogRing **link = &rings; *link;) {
+            LogRing *ring = *link;
+            const LogRecord *record = ring_peek(ring);
+            if (!record && __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE) && !(record = ring_peek(ring))) {
+                *link = ring->next;
+                ring->next = free_rings;
+                free_rings = ring;
+                continue;
+            }
+            if (record && (!oldest_record || record->ts_ns < oldest_record->ts_ns)) {
+                oldest = ring;
+                oldest_record = record;
+            }
+            link = &ring->next;
+        }
+        if (!oldest) {
+            return;
+        }
+        emit(oldest_record);
+        __atomic_store_n(&oldest->tail, oldest->tail + oldest_record->size, __ATOMIC_RELEASE);
+    }
+}
+
+void log_flush(void) {
+    if (!__atomic_load_n(&flusher_running, __ATOMIC_ACQUIRE) && __atomic_load_n(&log_mode, __ATOMIC_ACQUIRE) == LOG_SYNC) {
+        fflush(stdout);
+        return;
+    }
+    int locked = 0;
+    for (int i = 0; i < LOG_SHUTDOWN_TRIES && !(locked = pthread_mutex_trylock(&rings_lock) == 0); ++i) {
+        usleep(1000);
+    }
+    if (!locked) {
+        return;
+    }
+    drain_rings();
+    out_write(&out_stdout);
+    out_write(&out_stderr);
+    pthread_mutex_unlock(&rings_lock);
+    fflush(stdout);
+}
+
+static void wake_flusher(void) {
+    if (__atomic_exchange_n(&wake_pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        pthread_mutex_lock(&wake_lock);
+        pthread_cond_signal(&wake_cond);
+        pthread_mutex_unlock(&wake_lock);
+    }
+}
+
+static struct timespec flush_deadline(void) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += LOG_FLUSH_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+static void *flush_loop(void *arg) {
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&rings_lock);
+        drain_rings();
+        out_write(&out_stdout);
+        out_write(&out_stderr);
+        pthread_mutex_unlock(&rings_lock);
+
+        pthread_mutex_lock(&wake_lock);
+        pthread_cond_broadcast(&drained_cond);
+        if (!__atomic_exchange_n(&wake_pending, 0, __ATOMIC_ACQ_REL) && !stopping) {
+            struct timespec deadline = flush_deadline();
+            pthread_cond_timedwait(&wake_cond, &wake_lock, &deadline);
+            __atomic_store_n(&wake_pending, 0, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&wake_lock);
+    }
+    return NULL;
+}
+
+static void release_ring(void *arg) {
+    __atomic_store_n(&((LogRing *)arg)->closed, 1, __ATOMIC_RELEASE);
+}
+
+static void log_setup(void) {
+    pthread_key_create(&ring_key, release_ring);
+    atexit(log_shutdown);
+}
+
+static LogRing *acquire_ring(void) {
+    if (thread_ring) {
+        return thread_ring;
+    }
+    pthread_mutex_lock(&rings_lock);
+    LogRing *ring = free_rings;
+    if (ring) {
+        free_rings = ring->next;
+    } else {
+        ring = malloc(sizeof(LogRing));
+    }
+    if (ring) {
+        ring->head = ring->tail = 0;
+        ring->closed = 0;
+        ring->next = rings;
+        rings = ring;
+    }
+    pthread_mutex_unlock(&rings_lock);
+    if (ring) {
+        pthread_setspecific(ring_key, ring);
+        thread_ring = ring;
+    }
+    return ring;
+}
+
+static uint8_t *reserve(LogRing *ring, size_t size) {
+    while (1) {
+        size_t head = ring->head;
+        size_t offset = head % LOG_RING_SIZE;
+        size_t pad = LOG_RING_SIZE - offset < size ? LOG_RING_SIZE - offset : 0;
+        if (head + pad + size - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) <= LOG_RING_SIZE) {
+            if (pad >= sizeof(LogRecord)) {
+                LogRecord filler = {pad};
+                memcpy(ring->data + offset, &filler, sizeof(filler));
+            }
+            if (pad > 0) {
+                __atomic_store_n(&ring->head, head + pad, __ATOMIC_RELEASE);
+            }
+            return ring->data + (head + pad) % LOG_RING_SIZE;
+        }
+        if (!__atomic_load_n(&flusher_running, __ATOMIC_ACQUIRE)) {
+            log_flush();
+        } else {
+            struct timespec deadline = flush_deadline();
+            pthread_mutex_lock(&wake_lock);
+            __atomic_store_n(&wake_pending, 1, __ATOMIC_RELEASE);
+            pthread_cond_signal(&wake_cond);
+            pthread_cond_timedwait(&drained_cond, &wake_lock, &deadline);
+            pthread_mutex_unlock(&wake_lock);
+        }
+    }
+}
+
+void log_write(LogLevel level, const char *format, ...) {
+    if (level < log_level) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, format);
+    LogRing *ring = __atomic_load_n(&log_mode, __ATOMIC_ACQUIRE) != LOG_SYNC ? acquire_ring() : NULL;
+    if (!ring) {
+        vfprintf(level >= LOG_WARN ? stderr : stdout, format, ap);
+        va_end(ap);
+        return;
+    }
+    uint8_t args[LOG_MAX_ARGS];
+    size_t args_len = capture(args, format, ap);
+    va_end(ap);
+    size_t size = (sizeof(LogRecord) + args_len + 7) & ~(size_t)7;
+    LogRecord record = {size, level, 0, args_len, now_ns(), format};
+    uint8_t *slot = reserve(ring, size);
+    memcpy(slot, &record, sizeof(record));
+    memcpy(slot + sizeof(record), args, args_len);
+    size_t head = ring->head + size;
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) > LOG_RING_SIZE / 2) {
+        wake_flusher();
+    }
+}
+
+int log_init(LogMode mode, LogLevel level) {
+    log_shutdown();
+    log_level = level;
+    if (mode == LOG_SYNC) {
+        return 0;
+    }
+    pthread_once(&log_once, log_setup);
+    fflush(stdout);
+    if (mode == LOG_BINARY) {
+        out_append(&out_stdout, LOG_BINARY_MAGIC, sizeof(LOG_BINARY_MAGIC) - 1);
+        memset(format_slots, 0, sizeof(format_slots));
+        format_count = 0;
+    }
+    __atomic_store_n(&stopping, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&log_mode, mode, __ATOMIC_RELEASE);
+    if (pthread_create(&flusher, NULL, flush_loop, NULL) != 0) {
+        perror("log flusher create failed");
+        __atomic_store_n(&log_mode, LOG_SYNC, __ATOMIC_RELEASE);
+        return -1;
+    }
+    __atomic_store_n(&flusher_running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void log_shutdown(void) {
+    if (!__atomic_load_n(&flusher_running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&wake_lock);
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+    if (!pthread_equal(pthread_self(), flusher)) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        pthread_timedjoin_np(flusher, NULL, &deadline);
+    }
+    __atomic_store_n(&flusher_running, 0, __ATOMIC_RELEASE);
+    log_flush();
+    __atomic_store_n(&log_mode, LOG_SYNC, __ATOMIC_RELEASE);
+}
+
+int log_parse_mode(const char *name) {
+    for (int mode = LOG_SYNC; mode <= LOG_BINARY; ++mode) {
+        if (strcasecmp(name, mode_names[mode]) == 0) {
+            return mode;
+        }
+    }
+    return -1;
+}
+
+int log_parse_level(const char *name) {
+    for (int level = LOG_DEBUG; level <= LOG_ERROR; ++level) {
+        if (strcasecmp(name, level_names[level]) == 0) {
+            return level;
+        }
+    }
+    return -1;
+}
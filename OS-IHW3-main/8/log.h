@@ -0,0 +1,35 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR
+} LogLevel;
+
+typedef enum {
+    LOG_SYNC,
+    LOG_ASYNC,
+    LOG_BINARY
+} LogMode;
+
+#define LOG_BINARY_MAGIC "DBLOG\1\0\0"
+
+enum {
+    LOG_RECORD_FORMAT = 1,
+    LOG_RECORD_MESSAGE = 2
+};
+
+int log_init(LogMode mode, LogLevel level);
+int log_parse_mode(const char *name);
+int log_parse_level(const char *name);
+void log_write(LogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void log_flush(void);
+void log_shutdown(void);
+size_t log_render(char *out, size_t size, const char *format, const uint8_t *args, size_t args_len);
+
+#endif
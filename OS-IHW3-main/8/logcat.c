@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+
+#define LINE_SIZE 1024
+
+static const char *level_names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+static int read_all(FILE *file, void *data, size_t size) {
+    return fread(data, 1, size, file) == size ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [binary_log]\n", argv[0]);
+        return -1;
+    }
+    FILE *file = argc == 2 ? fopen(argv[1], "rb") : stdin;
+    if (!file) {
+        perror("fopen() failed");
+        return -1;
+    }
+    char magic[sizeof(LOG_BINARY_MAGIC) - 1];
+    if (read_all(file, magic, sizeof(magic)) < 0 || memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)) != 0) {
+        fprintf(stderr, "Not a binary log\n");
+        return -1;
+    }
+    char **formats = NULL;
+    uint32_t format_capacity = 0;
+    uint8_t type;
+    while (read_all(file, &type, sizeof(type)) == 0) {
+        uint32_t id;
+        uint16_t len;
+        if (type == LOG_RECORD_FORMAT) {
+            if (read_all(file, &id, sizeof(id)) < 0 || read_all(file, &len, sizeof(len)) < 0) {
+                break;
+            }
+            if (id >= format_capacity) {
+                uint32_t capacity = id * 2 + 16;
+                char **grown = realloc(formats, sizeof(char *) * capacity);
+                if (!grown) {
+                    perror("realloc failed");
+                    return -1;
+                }
+                memset(grown + format_capacity, 0, sizeof(char *) * (capacity - format_capacity));
+                formats = grown;
+                format_capacity = capacity;
+            }
+            free(formats[id]);
+            formats[id] = malloc(len + 1);
+            if (!formats[id] || read_all(file, formats[id], len) < 0) {
+                break;
+            }
+            formats[id][len] = '\0';
+        } else if (type == LOG_RECORD_MESSAGE) {
+            uint8_t level, args[UINT16_MAX];
+            uint64_t ts_ns;
+            if (read_all(file, &level, sizeof(level)) < 0 || read_all(file, &id, sizeof(id)) < 0 ||
+                read_all(file, &ts_ns, sizeof(ts_ns)) < 0 || read_all(file, &len, sizeof(len)) < 0 ||
+                read_all(file, args, len) < 0) {
+                break;
+            }
+            if (id >= format_capacity || !formats[id]) {
+                fprintf(stderr, "Unknown format %u\n", id);
+                continue;
+            }
+            char line[LINE_SIZE], stamp[32];
+            time_t seconds = ts_ns / 1000000000ULL;
+            struct tm tm;
+            localtime_r(&seconds, &tm);
+            strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+            log_render(line, sizeof(line), formats[id], args, len);
+            printf("%s.%06lu %-5s %s", stamp, (unsigned long)(ts_ns % 1000000000ULL / 1000),
+                   level < 4 ? level_names[level] : "?", line);
+            if (line[0] == '\0' || line[strlen(line) - 1] != '\n') {
+                putchar('\n');
+            }
+        } else {
+            fprintf(stderr, "Corrupted log record\n");
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "mvcc.h"
+
+#define COMMIT_WINDOW 4096
+#define VERSION_CACHE 256
+
+struct Version {
+    int value;
+    unsigned long end;
+    struct Version *next;
+};
+
+typedef struct {
+    Version *head;
+    int count;
+    int registered;
+} VersionCache;
+
+static int *store;
+static Version **chains;
+static unsigned char *chain_busy;
+static unsigned char *pending_map;
+static size_t *pending;
+static size_t pending_len;
+static size_t pending_cap;
+static unsigned long committed_ts;
+static unsigned long finished_ts;
+static unsigned long next_ts;
+static unsigned long completed[COMMIT_WINDOW];
+static size_t retained;
+static int active_snapshots;
+static Snapshot *oldest;
+static Snapshot *newest;
+static pthread_mutex_t snap_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t gc_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread VersionCache version_cache;
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+static void drain_cache(void *arg) {
+    VersionCache *cache = arg;
+    while (cache->head) {
+        Version *next = cache->head->next;
+        free(cache->head);
+        cache->head = next;
+    }
+    cache->count = 0;
+}
+
+static void create_cache_key(void) {
+    pthread_key_create(&cache_key, drain_cache);
+}
+
+static Version *version_alloc(void) {
+    VersionCache *cache = &version_cache;
+    Version *v = cache->head;
+    if (!v) {
+        return malloc(sizeof(Version));
+    }
+    cache->head = v->next;
+    --cache->count;
+    return v;
+}
+
+static void version_free(Version *v) {
+    VersionCache *cache = &version_cache;
+    if (cache->count >= VERSION_CACHE) {
+        free(v);
+        return;
+    }
+    if (!cache->registered) {
+        pthread_once(&cache_once, create_cache_key);
+        pthread_setspecific(cache_key, cache);
+        cache->registered = 1;
+    }
+    v->next = cache->head;
+    cache->head = v;
+    ++cache->count;
+}
+
+int mvcc_init(int *db, size_t size) {
+    store = db;
+    chains = calloc(size, sizeof(Version *));
+    chain_busy = calloc(size, 1);
+    pending_map = calloc(size / 8 + 1, 1);
+    if (!chains || !chain_busy || !pending_map) {
+        perror("mvcc_init calloc failed");
+        free(chains);
+        free(chain_busy);
+        free(pending_map);
+        return -1;
+    }
+    return 0;
+}
+
+void mvcc_begin(Snapshot *snap) {
+    unsigned long finished = __atomic_load_n(&finished_ts, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&committed_ts, __ATOMIC_SEQ_CST) < finished) {
+        sched_yield();
+    }
+    pthread_mutex_lock(&snap_lock);
+    __atomic_add_fetch(&active_snapshots, 1, __ATOMIC_SEQ_CST);
+    snap->ts = __atomic_load_n(&committed_ts, __ATOMIC_SEQ_CST);
+    snap->next = NULL;
+    snap->prev = newest;
+    if (newest) {
+        newest->next = snap;
+    } else {
+        oldest = snap;
+    }
+    newest = snap;
+    pthread_mutex_unlock(&snap_lock);
+}
+
+static unsigned long min_active(void) {
+    unsigned long committed = __atomic_load_n(&committed_ts, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&active_snapshots, __ATOMIC_SEQ_CST) == 0) {
+        return committed;
+    }
+    pthread_mutex_lock(&snap_lock);
+    unsigned long ts = oldest ? oldest->ts : __atomic_load_n(&committed_ts, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&snap_lock);
+    return ts;
+}
+
+static int prune(size_t index, unsigned long min_ts) {
+    Version *v = __atomic_load_n(&chains[index], __ATOMIC_ACQUIRE);
+    while (v && v->end > min_ts) {
+        v = v->next;
+    }
+    if (!v) {
+        return chains[index] != NULL && chains[index]->next != NULL;
+    }
+    Version *dead = v->next;
+    __atomic_store_n(&v->next, NULL, __ATOMIC_RELEASE);
+    while (dead) {
+        Version *next = dead->next;
+        version_free(dead);
+        __atomic_sub_fetch(&retained, 1, __ATOMIC_RELAXED);
+        dead = next;
+    }
+    return chains[index]->next != NULL;
+}
+
+static void chain_lock(size_t index) {
+    while (__atomic_test_and_set(&chain_busy[index], __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+}
+
+static void chain_unlock(size_t index) {
+    __atomic_clear(&chain_busy[index], __ATOMIC_RELEASE);
+}
+
+static int prune_locked(size_t index, unsigned long min_ts) {
+    chain_lock(index);
+    int kept = prune(index, min_ts);
+    chain_unlock(index);
+    return kept;
+}
+
+void mvcc_collect(size_t index) {
+    if (!prune_locked(index, min_active()) ||
+        (__atomic_load_n(&pending_map[index / 8], __ATOMIC_RELAXED) & (1 << (index % 8)))) {
+        return;
+    }
+    pthread_mutex_lock(&gc_lock);
+    if (!(pending_map[index / 8] & (1 << (index % 8)))) {
+        if (pending_len == pending_cap) {
+            size_t cap = pending_cap ? pending_cap * 2 : 64;
+            size_t *grown = realloc(pending, cap * sizeof(size_t));
+            if (!grown) {
+                pthread_mutex_unlock(&gc_lock);
+                return;
+            }
+            pending = grown;
+            pending_cap = cap;
+        }
+        pending[pending_len++] = index;
+        __atomic_or_fetch(&pending_map[index / 8], 1 << (index % 8), __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&gc_lock);
+}
+
+void mvcc_end(Snapshot *snap) {
+    pthread_mutex_lock(&snap_lock);
+    int was_oldest = snap == oldest;
+    if (snap->prev) {
+        snap->prev->next = snap->next;
+    } else {
+        oldest = snap->next;
+    }
+    if (snap->next) {
+        snap->next->prev = snap->prev;
+    } else {
+        newest = snap->prev;
+    }
+    __atomic_sub_fetch(&active_snapshots, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&snap_lock);
+    if (!was_oldest) {
+        return;
+    }
+
+    pthread_mutex_lock(&gc_lock);
+    unsigned long min_ts = min_active();
+    size_t kept = 0;
+    for (size_t i = 0; i < pending_len; ++i) {
+        size_t index = pending[i];
+        if (prune_locked(index, min_ts)) {
+            pending[kept++] = index;
+        } else {
+            __atomic_and_fetch(&pending_map[index / 8], ~(1 << (index % 8)), __ATOMIC_RELAXED);
+        }
+    }
+    pending_len = kept;
+    pthread_mutex_unlock(&gc_lock);
+}
+
+int mvcc_read(const Snapshot *snap, size_t index) {
+    int value = __atomic_load_n(&store[index], __ATOMIC_SEQ_CST);
+    Version *v = __atomic_load_n(&chains[index], __ATOMIC_SEQ_CST);
+    while (v && v->end > snap->ts) {
+        value = v->value;
+        v = __atomic_load_n(&v->next, __ATOMIC_ACQUIRE);
+    }
+    return value;
+}
+
+Version *mvcc_reserve(int count) {
+    Version *head = NULL;
+    for (int i = 0; i < count; ++i) {
+        Version *v = version_alloc();
+        if (!v) {
+            mvcc_release(head);
+            return NULL;
+        }
+        v->next = head;
+        head = v;
+    }
+    return head;
+}
+
+void mvcc_release(Version *reserved) {
+    while (reserved) {
+        Version *next = reserved->next;
+        version_free(reserved);
+        reserved = next;
+    }
+}
+
+unsigned long mvcc_commit_begin(void) {
+    unsigned long ts = __atomic_add_fetch(&next_ts, 1, __ATOMIC_SEQ_CST);
+    while (ts - __atomic_load_n(&committed_ts, __ATOMIC_ACQUIRE) > COMMIT_WINDOW) {
+        sched_yield();
+    }
+    return ts;
+}
+
+void mvcc_install(Version **reserved, size_t index, int value, unsigned long ts) {
+    Version *v = *reserved;
+    *reserved = v->next;
+    v->value = store[index];
+    v->end = ts;
+    v->next = chains[index];
+    __atomic_store_n(&chains[index], v, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&retained, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&store[index], value, __ATOMIC_SEQ_CST);
+}
+
+void mvcc_commit_end(unsigned long ts) {
+    __atomic_store_n(&completed[ts % COMMIT_WINDOW], ts, __ATOMIC_SEQ_CST);
+    unsigned long visible = __atomic_load_n(&committed_ts, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&completed[(visible + 1) % COMMIT_WINDOW], __ATOMIC_SEQ_CST) == visible + 1) {
+        if (__atomic_compare_exchange_n(&committed_ts, &visible, visible + 1, 0, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_SEQ_CST)) {
+            ++visible;
+        }
+    }
+    unsigned long finished = __atomic_load_n(&finished_ts, __ATOMIC_RELAXED);
+    while (finished < ts && !__atomic_compare_exchange_n(&finished_ts, &finished, ts, 0, __ATOMIC_SEQ_CST,
+                                                         __ATOMIC_RELAXED)) {
+    }
+}
+
+unsigned long mvcc_version(void) {
+    return __atomic_load_n(&committed_ts, __ATOMIC_SEQ_CST);
+}
+
+size_t mvcc_retained(void) {
+    return __atomic_load_n(&retained, __ATOMIC_RELAXED);
+}
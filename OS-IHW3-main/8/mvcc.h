@@ -0,0 +1,27 @@
+#ifndef MVCC_H
+#define MVCC_H
+
+#include <stddef.h>
+
+typedef struct Version Version;
+
+typedef struct Snapshot {
+    unsigned long ts;
+    struct Snapshot *prev;
+    struct Snapshot *next;
+} Snapshot;
+
+int mvcc_init(int *db, size_t size);
+void mvcc_begin(Snapshot *snap);
+void mvcc_end(Snapshot *snap);
+int mvcc_read(const Snapshot *snap, size_t index);
+Version *mvcc_reserve(int count);
+void mvcc_release(Version *reserved);
+unsigned long mvcc_commit_begin(void);
+void mvcc_install(Version **reserved, size_t index, int value, unsigned long ts);
+void mvcc_commit_end(unsigned long ts);
+void mvcc_collect(size_t index);
+unsigned long mvcc_version(void);
+size_t mvcc_retained(void);
+
+#endif
@@ -2,67 +2,76 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <signal.h>
+#include <getopt.h>
 
-#define BUFF_SIZE 1024
+#include "dbclient.h"
 
-int client_socket;
+#define RECONNECT_DELAY 1
 
 void signal_handler(int signal) {
     printf("Terminating observer...\n");
-    close(client_socket);
     exit(0);
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <ip-address> <port>\n", argv[0]);
-        return -1;
-    }
-    const char *server_ip = argv[1];
-    int port = atoi(argv[2]);
-    client_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (client_socket == -1) {
-        perror("Socket creation failed");
-        return -1;
+void print_event(unsigned long seq, const char *event, void *arg) {
+    if (seq == 0) {
+        printf("From server: events lost (%s)\n", event);
+    } else {
+        printf("From server [%lu]: %s\n", seq, event);
     }
-    struct sockaddr_in server_address;
-    server_address.sin_family = AF_INET;
-    server_address.sin_port = htons(port);
-    if (inet_pton(AF_INET, server_ip, &server_address.sin_addr) <= 0) {
-        perror("Invalid address");
-        close(client_socket);
-        return -1;
+}
+
+int main(int argc, char *argv[]) {
+    int udp_port = -1;
+    int encoding = DB_EVENTS_BINARY;
+    static struct option options[] = {
+        {"udp", required_argument, NULL, 'u'},
+        {"text", no_argument, NULL, 't'},
+        {"zlib", no_argument, NULL, 'z'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt_char;
+    while ((opt_char = getopt_long(argc, argv, "u:tz", options, NULL)) != -1) {
+        switch (opt_char) {
+            case 'u':
+                udp_port = atoi(optarg);
+                break;
+            case 't':
+                encoding = DB_EVENTS_TEXT;
+                break;
+            case 'z':
+                encoding = DB_EVENTS_ZLIB;
+                break;
+            default:
+                break;
+        }
     }
-    if (connect(client_socket, (struct sockaddr *)&server_address, sizeof(server_address)) == -1) {
-        perror("Connection failed");
-        close(client_socket);
+    int positional = argc - optind;
+    int uri_args = positional > 0 && strstr(argv[optind], "://") ? 1 : 2;
+    if (positional < uri_args || positional > uri_args + 1) {
+        fprintf(stderr,
+                "Usage: %s <ip-address> <port> [from_seq] [--udp <port>] [--text|--zlib]\n"
+                "       %s <uri> [from_seq] [--udp <port>] [--text|--zlib]\n",
+                argv[0], argv[0]);
         return -1;
     }
-    printf("Connected to server.\n");
-    const char *handshake_message = "OBSERVER";
-    if (send(client_socket, handshake_message, strlen(handshake_message), 0) == -1) {
-        perror("Handshake message send failed");
-        close(client_socket);
-        return -1;
+    char uri[256];
+    if (uri_args == 2) {
+        snprintf(uri, sizeof(uri), "tcp://%s:%s", argv[optind], argv[optind + 1]);
+    } else {
+        snprintf(uri, sizeof(uri), "%s", argv[optind]);
     }
+    unsigned long from_seq = positional > uri_args ? strtoul(argv[optind + uri_args], NULL, 10) : 0;
     signal(SIGINT, signal_handler);
-
-    char buffer[BUFF_SIZE];
-    int bytes_received;
-    while ((bytes_received = recv(client_socket, buffer, BUFF_SIZE - 1, 0)) > 0) {
-        buffer[bytes_received] = '\0';
-        printf("From server: %s\n", buffer);
-    }
-    if (bytes_received == -1) {
-        perror("Receive failed");
+    while (1) {
+        int status = udp_port >= 0 ? db_subscribe_udp(uri, udp_port, &from_seq, print_event, NULL)
+                                   : db_subscribe(uri, &from_seq, encoding, print_event, NULL);
+        if (status == DB_OK) {
+            printf("Connection closed, resuming from seq %lu.\n", from_seq);
+        }
+        sleep(RECONNECT_DELAY);
     }
 
-    close(client_socket);
-    printf("Connection closed.\n");
-
     return 0;
 }
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "qos.h"
+
+#define QOS_BURST_MS 100
+#define QOS_VTIME_SCALE 1024
+
+static const char *class_names[QOS_CLASSES] = {"HIGH", "NORMAL", "LOW"};
+static const int class_weights[QOS_CLASSES] = {16, 4, 1};
+
+static QosConfig config;
+static QosStats stats;
+static pthread_mutex_t qos_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t qos_conds[QOS_CLASSES] = {PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                                                PTHREAD_COND_INITIALIZER};
+static int free_slots;
+static int waiting[QOS_CLASSES];
+static int granted[QOS_CLASSES];
+static long vtime[QOS_CLASSES];
+static long system_vtime;
+static double tokens[QOS_CLASSES];
+static long refilled_us[QOS_CLASSES];
+
+static long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static double burst(QosClass qos) {
+    double size = config.rate[qos] * QOS_BURST_MS / 1000.0;
+    return size < 1 ? 1 : size;
+}
+
+void qos_init(const QosConfig *qos_config) {
+    config = *qos_config;
+    free_slots = config.slots;
+    for (int qos = 0; qos < QOS_CLASSES; ++qos) {
+        tokens[qos] = burst(qos);
+        refilled_us[qos] = now_us();
+    }
+}
+
+int qos_parse_class(const char *name) {
+    for (int qos = 0; qos < QOS_CLASSES; ++qos) {
+        if (strcasecmp(name, class_names[qos]) == 0) {
+            return qos;
+        }
+    }
+    return -1;
+}
+
+int qos_parse_rate(const char *text, QosConfig *qos_config) {
+    char name[16];
+    long rate;
+    int qos;
+    if (sscanf(text, "%15[^=]=%ld", name, &rate) != 2 || rate < 0 || (qos = qos_parse_class(name)) < 0) {
+        return -1;
+    }
+    qos_config->rate[qos] = rate;
+    return 0;
+}
+
+QosClass qos_handshake_class(const char *handshake) {
+    const char *field = strstr(handshake, " QOS ");
+    int qos = field ? qos_parse_class(field + 5) : -1;
+    return qos < 0 ? QOS_NORMAL : qos;
+}
+
+int qos_admit(QosClass qos) {
+    if (config.rate[qos] <= 0) {
+        return 0;
+    }
+    pthread_mutex_lock(&qos_lock);
+    long now = now_us();
+    tokens[qos] += (now - refilled_us[qos]) * config.rate[qos] / 1e6;
+    refilled_us[qos] = now;
+    if (tokens[qos] > burst(qos)) {
+        tokens[qos] = burst(qos);
+    }
+    int admitted = tokens[qos] >= 1;
+    if (admitted) {
+        tokens[qos] -= 1;
+    } else {
+        ++stats.limited[qos];
+    }
+    pthread_mutex_unlock(&qos_lock);
+    return admitted ? 0 : -1;
+}
+
+void qos_refund(QosClass qos) {
+    if (config.rate[qos] <= 0) {
+        return;
+    }
+    pthread_mutex_lock(&qos_lock);
+    if (++tokens[qos] > burst(qos)) {
+        tokens[qos] = burst(qos);
+    }
+    pthread_mutex_unlock(&qos_lock);
+}
+
+static void charge(int qos) {
+    system_vtime = vtime[qos];
+    vtime[qos] += QOS_VTIME_SCALE / class_weights[qos];
+}
+
+static int next_class(void) {
+    int next = -1;
+    for (int qos = 0; qos < QOS_CLASSES; ++qos) {
+        if (waiting[qos] == 0) {
+            continue;
+        }
+        if (config.policy == QOS_STRICT) {
+            return qos;
+        }
+        if (next < 0 || vtime[qos] < vtime[next]) {
+            next = qos;
+        }
+    }
+    return next;
+}
+
+void qos_enter(QosClass qos) {
+    __atomic_add_fetch(&stats.admitted[qos], 1, __ATOMIC_RELAXED);
+    if (config.slots <= 0) {
+        return;
+    }
+    pthread_mutex_lock(&qos_lock);
+    if (free_slots > 0) {
+        --free_slots;
+        charge(qos);
+    } else {
+        ++stats.queued[qos];
+        if (waiting[qos]++ == 0 && vtime[qos] < system_vtime) {
+            vtime[qos] = system_vtime;
+        }
+        while (granted[qos] == 0) {
+            pthread_cond_wait(&qos_conds[qos], &qos_lock);
+        }
+        --granted[qos];
+    }
+    pthread_mutex_unlock(&qos_lock);
+}
+
+void qos_exit(void) {
+    if (config.slots <= 0) {
+        return;
+    }
+    pthread_mutex_lock(&qos_lock);
+    int next = next_class();
+    if (next < 0) {
+        ++free_slots;
+    } else {
+        --waiting[next];
+        ++granted[next];
+        charge(next);
+        pthread_cond_signal(&qos_conds[next]);
+    }
+    pthread_mutex_unlock(&qos_lock);
+}
+
+void qos_stats(QosStats *out) {
+    pthread_mutex_lock(&qos_lock);
+    for (int qos = 0; qos < QOS_CLASSES; ++qos) {
+        out->admitted[qos] = __atomic_load_n(&stats.admitted[qos], __ATOMIC_RELAXED);
+        out->queued[qos] = stats.queued[qos];
+        out->limited[qos] = stats.limited[qos];
+    }
+    pthread_mutex_unlock(&qos_lock);
+}
@@ -0,0 +1,38 @@
+#ifndef QOS_H
+#define QOS_H
+
+typedef enum {
+    QOS_HIGH,
+    QOS_NORMAL,
+    QOS_LOW,
+    QOS_CLASSES
+} QosClass;
+
+typedef enum {
+    QOS_STRICT,
+    QOS_WEIGHTED
+} QosPolicy;
+
+typedef struct {
+    int slots;
+    QosPolicy policy;
+    long rate[QOS_CLASSES];
+} QosConfig;
+
+typedef struct {
+    long admitted[QOS_CLASSES];
+    long queued[QOS_CLASSES];
+    long limited[QOS_CLASSES];
+} QosStats;
+
+void qos_init(const QosConfig *config);
+int qos_parse_class(const char *name);
+int qos_parse_rate(const char *text, QosConfig *config);
+QosClass qos_handshake_class(const char *handshake);
+int qos_admit(QosClass qos);
+void qos_refund(QosClass qos);
+void qos_enter(QosClass qos);
+void qos_exit(void);
+void qos_stats(QosStats *stats);
+
+#endif
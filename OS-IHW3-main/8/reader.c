@@ -1,21 +1,26 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <getopt.h>
+
+#include "dbclient.h"
+#include "log.h"
+#include "affinity.h"
 
 #define ARRAY_SIZE 10
 
+#define READERS_PER_CONNECTION 4
+#define REQUEST_TIMEOUT_MS 5000
+
 typedef struct {
     int id;
-    const char* server_ip;
-    int port;
+    DbClient *client;
 } ReaderData;
 
 sem_t rand_sem;
@@ -34,46 +39,9 @@ int fib(int n) {
     return curr;
 }
 
-void signal_handler(int signal) {
-    printf("Terminating reader clients...\n");
-    sem_destroy(&rand_sem);
-    exit(0);
-}
-
 void *read_process(void *arg) {
     ReaderData *reader_data = (ReaderData *)arg;
     int id = reader_data->id;
-    const char* server_ip = reader_data->server_ip;
-    int port = reader_data->port;
-
-    int sock = 0;
-    struct sockaddr_in serv_addr;
-    char buffer[1024] = {0};
-
-    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        fprintf(stderr, "Socket creation error\n");
-        return NULL;
-    }
-
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
-    if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0) {
-        fprintf(stderr, "Invalid address\n");
-        close(sock);
-        return NULL;
-    }
-    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        fprintf(stderr, "Connection failed\n");
-        close(sock);
-        return NULL;
-    }
-
-    const char *handshake_message = "READER";
-    if (send(sock, handshake_message, strlen(handshake_message), 0) == -1) {
-        perror("send() failed");
-        close(sock);
-        return NULL;
-    }
 
     while (1) {
         sleep(1 + rand() % 5);
@@ -81,84 +49,171 @@ void *read_process(void *arg) {
         int index = rand() % ARRAY_SIZE;
         sem_post(&rand_sem);
 
-        char request[1024];
-        sprintf(request, "READ %d", index);
-        int msg_len = strlen(request);
-        if (send(sock, &msg_len, sizeof(msg_len), 0) != sizeof(msg_len)) {
-            fprintf(stderr, "Reader %d failed to send message length\n", id);
-            break;
+        int value;
+        int status = db_read(reader_data->client, index, &value, REQUEST_TIMEOUT_MS);
+        if (status == DB_OK) {
+            int fib_value = fib(value);
+            log_write(LOG_INFO, "Reader[%d]: DB[%d] = %d, Fibonacci = %d\n", id, index, value, fib_value);
+        } else if (status == DB_BUSY || status == DB_TIMEOUT) {
+            log_write(LOG_INFO, "Reader[%d]: server busy, skipping request\n", id);
+        } else {
+            log_write(LOG_WARN, "Reader[%d]: request failed, will retry\n", id);
         }
+    }
+    return NULL;
+}
 
-        if (send(sock, request, msg_len, 0) != msg_len) {
-            fprintf(stderr, "Reader %d failed to send message\n", id);
-            break;
-        }
+void *watch_process(void *arg) {
+    ReaderData *reader_data = (ReaderData *)arg;
+    int id = reader_data->id;
+    DbWatcher *watcher = db_watcher_open(reader_data->client);
+    if (!watcher) {
+        return NULL;
+    }
+    sem_wait(&rand_sem);
+    int index = rand() % ARRAY_SIZE;
+    sem_post(&rand_sem);
 
-        memset(buffer, 0, sizeof(buffer));
-        int bytes_received = read(sock, buffer, sizeof(buffer) - 1);
-
-        if (bytes_received > 0) {
-            buffer[bytes_received] = '\0';
-            if (strstr(buffer, "VALUE") == buffer) {
-                int value = atoi(buffer + 6);
-                int fib_value = fib(value);
-                printf("Reader[%d]: DB[%d] = %d, Fibonacci = %d\n", id, index, value, fib_value);
-            } else {
-                printf("Reader[%d] received: %s\n", id, buffer);
-            }
+    unsigned version = 0;
+    while (1) {
+        int value;
+        int status = db_watch(watcher, index, &version, &value, 0);
+        if (status == DB_OK) {
+            int fib_value = fib(value);
+            log_write(LOG_INFO, "Reader[%d]: DB[%d] = %d, Fibonacci = %d\n", id, index, value, fib_value);
         } else {
-            fprintf(stderr, "Reader[%d] error\n", id);
-            break;
+            log_write(LOG_WARN, "Reader[%d]: watch failed, will retry\n", id);
+            sleep(1);
         }
     }
-
-    close(sock);
+    db_watcher_close(watcher);
     return NULL;
 }
 
 int main(int argc, char const *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <server_ip> <port> <num_readers>\n", argv[0]);
+    DbRetryPolicy retry = {DB_MAX_RETRIES, DB_BACKOFF_MIN_MS, DB_BACKOFF_MAX_MS, DB_RETRY_BUDGET,
+                           DB_RETRY_BUDGET_PERCENT, 1};
+    int cache = 0;
+    int watch = 0;
+    char role[64] = "READER";
+    int log_mode = LOG_ASYNC;
+    int log_level = LOG_INFO;
+    static struct option options[] = {
+        {"cpus", required_argument, NULL, 'c'},
+        {"retries", required_argument, NULL, 'r'},
+        {"retry-budget", required_argument, NULL, 'b'},
+        {"cache", no_argument, NULL, 'C'},
+        {"watch", no_argument, NULL, 'w'},
+        {"qos", required_argument, NULL, 'q'},
+        {"log", required_argument, NULL, 'o'},
+        {"log-level", required_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt_char;
+    while ((opt_char = getopt_long(argc, (char *const *)argv, "c:r:b:Cwq:o:v:", options, NULL)) != -1) {
+        cpu_set_t cpus;
+        switch (opt_char) {
+            case 'c':
+                if (cpuset_parse(optarg, &cpus) < 0 || affinity_pin_process(&cpus) < 0) {
+                    argc = 0;
+                }
+                break;
+            case 'r':
+                retry.max_retries = atoi(optarg);
+                break;
+            case 'b':
+                retry.retry_budget = atoi(optarg);
+                break;
+            case 'C':
+                cache = 1;
+                break;
+            case 'w':
+                watch = 1;
+                break;
+            case 'q':
+                snprintf(role, sizeof(role), "READER QOS %s", optarg);
+                break;
+            case 'o':
+                if ((log_mode = log_parse_mode(optarg)) < 0) {
+                    argc = 0;
+                }
+                break;
+            case 'v':
+                if ((log_level = log_parse_level(optarg)) < 0) {
+                    argc = 0;
+                }
+                break;
+            default:
+                argc = 0;
+        }
+    }
+    int positional = argc - optind;
+    if (positional != 2 && positional != 3) {
+        fprintf(stderr,
+                "Usage: %s <server_ip> <port> <num_readers> [--cpus <list>] [--retries <n>] [--retry-budget <n>] "
+                "[--cache] [--watch] [--qos <class>] [--log sync|async|binary] [--log-level <level>]\n"
+                "       %s <uri> <num_readers> [--cpus <list>] [--retries <n>] [--retry-budget <n>] [--cache] "
+                "[--watch] [--qos <class>] [--log sync|async|binary] [--log-level <level>]\n",
+                argv[0], argv[0]);
         return -1;
     }
 
-    const char* server_ip = argv[1];
-    int port = atoi(argv[2]);
-    int N = atoi(argv[3]);
+    char uri[256];
+    if (positional == 3) {
+        snprintf(uri, sizeof(uri), "tcp://%s:%s", argv[optind], argv[optind + 1]);
+    } else {
+        snprintf(uri, sizeof(uri), "%s", argv[optind]);
+    }
+    int N = atoi(argv[argc - 1]);
 
     srand(time(NULL));
 
-    signal(SIGINT, signal_handler);
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    log_init(log_mode, log_level);
 
     if (sem_init(&rand_sem, 0, 1) != 0) {
         perror("sem_init() failed");
         return -1;
     }
 
+    DbClient *client = db_client_open(uri, role, (N + READERS_PER_CONNECTION - 1) / READERS_PER_CONNECTION);
+    if (!client) {
+        sem_destroy(&rand_sem);
+        return -1;
+    }
+    db_client_set_retry(client, &retry);
+    if (cache && db_client_enable_cache(client) != DB_OK) {
+        db_client_close(client);
+        sem_destroy(&rand_sem);
+        return -1;
+    }
+
     pthread_t readers[N];
     ReaderData *reader_data = malloc(sizeof(ReaderData) * N);
     if (reader_data == NULL) {
         fprintf(stderr, "Memory allocation error\n");
+        db_client_close(client);
         sem_destroy(&rand_sem);
         return -1;
     }
 
     for (int i = 0; i < N; ++i) {
         reader_data[i].id = i + 1;
-        reader_data[i].server_ip = server_ip;
-        reader_data[i].port = port;
-        if (pthread_create(&readers[i], NULL, read_process, &reader_data[i]) != 0) {
+        reader_data[i].client = client;
+        if (pthread_create(&readers[i], NULL, watch ? watch_process : read_process, &reader_data[i]) != 0) {
             fprintf(stderr, "Error creating reader thread\n");
             free(reader_data);
+            db_client_close(client);
             sem_destroy(&rand_sem);
             return -1;
         }
     }
 
-    for (int i = 0; i < N; ++i) {
-        pthread_join(readers[i], NULL);
-    }
-    free(reader_data);
-    sem_destroy(&rand_sem);
-    return 0;
+    int caught;
+    sigwait(&stop_signals, &caught);
+    log_write(LOG_INFO, "Terminating reader clients...\n");
+    exit(0);
 }
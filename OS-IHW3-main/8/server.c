@@ -1,161 +1,1298 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <signal.h>
 #include <semaphore.h>
+#include <getopt.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "checkpoint.h"
+#include "mvcc.h"
+#include "txn.h"
+#include "conn.h"
+#include "transport.h"
+#include "shm_ring.h"
+#include "admission.h"
+#include "eventlog.h"
+#include "udpfan.h"
+#include "eventcodec.h"
+#include "affinity.h"
+#include "handoff.h"
+#include "watch.h"
+#include "qos.h"
+#include "log.h"
 
 #define ARRAY_SIZE 10
-#define MAX_CLIENTS 5
+#define CHECKPOINT_INTERVAL 60
+#define HANDSHAKE_SIZE 50
+#define MAX_LISTENERS 8
+#define LISTEN_BACKLOG 128
+#define MAX_CONNECTIONS 1024
+#define MAX_INFLIGHT 256
+#define CODEL_TARGET_MS 5
+#define CODEL_INTERVAL_MS 100
+#define EVENT_LOG_SIZE (1 << 20)
+#define HANDOFF_MAGIC 0x46464f444e414844ULL
+#define HANDOFF_TIMEOUT_MS 2000
+#define HANDOFF_POLL_MS 10
+#define LEASE_MS 100
+#define BULK_MAX_UPDATES (1 << 20)
+
+typedef enum {
+    CLIENT_NEW,
+    CLIENT_DB,
+    CLIENT_OBSERVER,
+    CLIENT_UDP_OBSERVER
+} ClientKind;
+
+typedef struct Client {
+    Conn conn;
+    FrameBuffer events;
+    Snapshot snapshot;
+    int in_snapshot;
+    Txn txn;
+    int in_txn;
+    TxnEntry *bulk;
+    char *bulk_records;
+    int bulk_size;
+    int bulk_count;
+    const char *bulk_error;
+    QosClass qos;
+    long deadline_us;
+    ClientKind kind;
+    EventFormat format;
+    unsigned long cursor;
+    int udp_port;
+    pthread_t thread;
+    int parked;
+    int dropped;
+    struct Client *next;
+} Client;
+
+typedef struct {
+    uint64_t magic;
+    uint64_t db_size;
+    uint64_t event_log_capacity;
+    uint32_t listen_count;
+    uint32_t reserved;
+} HandoffHeader;
+
+typedef struct {
+    int32_t kind;
+    int32_t format;
+    int32_t udp_port;
+    uint32_t pending;
+    uint64_t cursor;
+    int32_t qos;
+    uint32_t reserved;
+} HandoffClient;
 
-int db[ARRAY_SIZE];
+int *db;
+size_t db_size = ARRAY_SIZE;
 sem_t db_sem;
 sem_t writer_sem;
-int server_fd;
-int observer_clients[MAX_CLIENTS] = {-1};
-sem_t observer_sem;
+int slot_locks;
+int lease_ms = LEASE_MS;
+long *lease_until;
+cpu_set_t worker_cpus;
+int pin_workers;
+int listen_fds[MAX_LISTENERS];
+int listen_count;
+ShmServer *shm_server;
+int handing_off;
+volatile sig_atomic_t stop_signal;
+int stop_pipe[2] = {-1, -1};
+Client *clients;
+pthread_mutex_t clients_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t clients_cond = PTHREAD_COND_INITIALIZER;
+
+void notify_observers_batch(const FrameBuffer *events) {
+    eventlog_append_frames(events->data, events->len);
+}
+
+void notify_observers(EventType type) {
+    Event event = {type, event_now_us()};
+    uint8_t record[EVENT_MAX_ENCODED];
+    eventlog_append(record, event_encode(&event, NULL, record));
+}
+
+void client_event(Client *client, EventType type, int index, int value, int old_value) {
+    Event event = {type, event_now_us(), index, value, old_value};
+    uint8_t record[EVENT_MAX_ENCODED];
+    size_t len = event_encode(&event, NULL, record);
+    if (frame_append(&client->events, record, len) < 0) {
+        notify_observers_batch(&client->events);
+        client->events.len = 0;
+        frame_append(&client->events, record, len);
+    }
+    if (type == EVENT_UPDATE && __atomic_load_n(&lease_until[index], __ATOMIC_SEQ_CST) > event.ts_us) {
+        notify_observers_batch(&client->events);
+        client->events.len = 0;
+    }
+    if (type == EVENT_UPDATE) {
+        watch_written(index);
+    }
+}
+
+void lock_writes(void) {
+    if (!slot_locks) {
+        sem_wait(&writer_sem);
+        sem_wait(&db_sem);
+    }
+}
+
+void unlock_writes(void) {
+    if (!slot_locks) {
+        sem_post(&db_sem);
+        sem_post(&writer_sem);
+    }
+}
 
-void notify_observers(const char *message) {
-    sem_wait(&observer_sem);
-    for (int i = 0; i < MAX_CLIENTS; ++i) {
-        if (observer_clients[i] != -1) {
-            send(observer_clients[i], message, strlen(message), 0);
+void end_bulk(Client *client) {
+    free(client->bulk);
+    free(client->bulk_records);
+    client->bulk = NULL;
+    client->bulk_records = NULL;
+}
+
+int commit_bulk(Client *client) {
+    Conn *conn = &client->conn;
+    TxnEntry *writes = client->bulk;
+    int count = client->bulk_count;
+    lock_writes();
+    int written = txn_bulk_write(writes, count);
+    unlock_writes();
+    if (written < 0) {
+        end_bulk(client);
+        return conn_replyf(conn, "ERROR out of memory");
+    }
+
+    notify_observers_batch(&client->events);
+    client->events.len = 0;
+    char *records = client->bulk_records;
+    size_t len = 0;
+    long now = event_now_us();
+    for (int i = 0; i < written; ++i) {
+        Event event = {EVENT_UPDATE, now, writes[i].index, writes[i].value, writes[i].old_value};
+        int record_len = event_encode(&event, NULL, (uint8_t *)records + len + sizeof(int));
+        memcpy(records + len, &record_len, sizeof(int));
+        len += sizeof(int) + record_len;
+    }
+    eventlog_append_frames(records, len);
+    for (int i = 0; i < written; ++i) {
+        watch_written(writes[i].index);
+    }
+    end_bulk(client);
+    return conn_replyf(conn, "BULKWRITTEN %d", written);
+}
+
+int bulk_data(Client *client, const char *pairs) {
+    Conn *conn = &client->conn;
+    if (!client->bulk) {
+        return conn_replyf(conn, "ERROR no bulk write");
+    }
+    while (1) {
+        char *end, *next;
+        long index = strtol(pairs, &end, 10);
+        if (end == pairs) {
+            break;
+        }
+        long value = strtol(end, &next, 10);
+        if (next == end) {
+            client->bulk_error = "ERROR invalid index";
+            break;
+        }
+        if (client->bulk_count == client->bulk_size) {
+            end_bulk(client);
+            return conn_replyf(conn, "ERROR too many updates");
+        }
+        if (index < 0 || (size_t)index >= db_size) {
+            client->bulk_error = "ERROR invalid index";
+        } else if (value < INT_MIN || value > INT_MAX) {
+            client->bulk_error = client->bulk_error ? client->bulk_error : "ERROR invalid value";
         }
+        client->bulk[client->bulk_count++] = (TxnEntry){index, value};
+        pairs = next;
     }
-    sem_post(&observer_sem);
+    if (client->bulk_count < client->bulk_size) {
+        return conn_replyf(conn, "QUEUED %d", client->bulk_count);
+    }
+    if (client->bulk_error) {
+        const char *error = client->bulk_error;
+        end_bulk(client);
+        return conn_replyf(conn, "%s", error);
+    }
+    return commit_bulk(client);
 }
 
 void init_db() {
-    for (int i = 1; i < ARRAY_SIZE + 1; ++i) {
+    for (size_t i = 1; i < db_size + 1; ++i) {
         db[i - 1] = i;
     }
 }
 
-void *handle_client(void *arg) {
-    int client_socket = *(int *)arg;
-    free(arg);
-
-    char buffer[1024] = {0};
+void *checkpoint_thread(void *arg) {
+    int interval = *(int *)arg;
     while (1) {
-        int msg_len;
-        int len_read = read(client_socket, &msg_len, sizeof(msg_len));
-        if (len_read <= 0) {
-            break;
+        sleep(interval);
+        txn_quiesce();
+        pid_t pid = checkpoint_fork(db, db_size);
+        txn_resume();
+        if (pid > 0 && checkpoint_wait(pid) == 0) {
+            log_write(LOG_INFO, "Checkpoint written.\n");
         }
-        if (msg_len > 0 && msg_len < sizeof(buffer)) {
-            int result = 0;
-            while (result < msg_len) {
-                int part = read(client_socket, buffer + result, msg_len - result);
-                if (part <= 0) {
-                    break;
-                }
-                result += part;
+    }
+    return NULL;
+}
+
+int expired(Client *client) {
+    if (client->deadline_us == 0 || admission_now_us() < client->deadline_us) {
+        return 0;
+    }
+    admission_expired();
+    return 1;
+}
+
+int parse_index(const char *text, int *index) {
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (end == text || value < 0 || (size_t)value >= db_size) {
+        return -1;
+    }
+    *index = value;
+    return 0;
+}
+
+int handle_request(Client *client, const char *request) {
+    Conn *conn = &client->conn;
+    if (strcmp(request, "BEGIN") == 0) {
+        if (client->in_snapshot || client->in_txn) {
+            return conn_replyf(conn, "ERROR transaction already open");
+        }
+        txn_begin(&client->txn);
+        client->in_txn = 1;
+        return conn_replyf(conn, "OK");
+    } else if (strcmp(request, "COMMIT") == 0 || strcmp(request, "ABORT") == 0) {
+        if (!client->in_txn) {
+            return conn_replyf(conn, "ERROR no transaction");
+        }
+        client->in_txn = 0;
+        if (strcmp(request, "ABORT") == 0) {
+            return conn_replyf(conn, "OK");
+        }
+        Txn *txn = &client->txn;
+        lock_writes();
+        int result = txn_commit(txn);
+        unlock_writes();
+        if (result == TXN_ABORTED) {
+            return conn_replyf(conn, "ABORTED");
+        } else if (result != TXN_COMMITTED) {
+            return conn_replyf(conn, "ERROR out of memory");
+        }
+        for (int i = 0; i < txn->write_count; ++i) {
+            client_event(client, EVENT_UPDATE, txn->writes[i].index, txn->writes[i].value, txn->writes[i].old_value);
+        }
+        return conn_replyf(conn, "COMMITTED %d", txn->write_count);
+    } else if (strcmp(request, "BEGIN_RO") == 0) {
+        if (client->in_snapshot || client->in_txn) {
+            return conn_replyf(conn, "ERROR transaction already open");
+        }
+        mvcc_begin(&client->snapshot);
+        client->in_snapshot = 1;
+        return conn_replyf(conn, "SNAPSHOT %lu", client->snapshot.ts);
+    } else if (strcmp(request, "END") == 0) {
+        if (!client->in_snapshot) {
+            return conn_replyf(conn, "ERROR no transaction");
+        }
+        mvcc_end(&client->snapshot);
+        client->in_snapshot = 0;
+        return conn_replyf(conn, "OK");
+    } else if (strncmp(request, "READ", 4) == 0 || strncmp(request, "LEASE", 5) == 0) {
+        int index;
+        int value;
+        int leased = request[0] == 'L';
+        if (parse_index(request + (leased ? 5 : 4), &index) < 0) {
+            return conn_replyf(conn, "ERROR invalid index");
+        }
+        leased = leased && lease_ms > 0 && !client->in_snapshot && !client->in_txn;
+        if (leased) {
+            __atomic_store_n(&lease_until[index], event_now_us() + lease_ms * 1000L, __ATOMIC_SEQ_CST);
+        }
+
+        if (client->in_snapshot) {
+            value = mvcc_read(&client->snapshot, index);
+        } else if (client->in_txn) {
+            if (txn_read(&client->txn, index, &value) < 0) {
+                return conn_replyf(conn, "ERROR transaction too large");
             }
-            buffer[msg_len] = '\0';
+        } else if (slot_locks) {
+            unsigned version;
+            txn_read_one(index, &value, &version);
+        } else {
+            sem_wait(&db_sem);
+            value = db[index];
+            sem_post(&db_sem);
+        }
 
-            char *request = strdup(buffer);
-            if (strncmp(request, "READ", 4) == 0) {
-                int index = atoi(request + 5);
-                int value;
+        client_event(client, EVENT_READ, index, value, 0);
+        if (leased) {
+            return conn_replyf(conn, "LEASED %d %d", value, lease_ms);
+        }
+        return conn_replyf(conn, "VALUE %d", value);
+    } else if (strncmp(request, "WRITE", 5) == 0) {
+        int index;
+        long parsed;
+        if (sscanf(request + 5, "%d %ld", &index, &parsed) != 2 || index < 0 || (size_t)index >= db_size) {
+            return conn_replyf(conn, "ERROR invalid index");
+        }
+        if (parsed < INT_MIN || parsed > INT_MAX) {
+            return conn_replyf(conn, "ERROR invalid value");
+        }
+        int new_value = parsed;
 
-                sem_wait(&db_sem);
-                value = db[index];
-                sem_post(&db_sem);
+        if (client->in_txn) {
+            if (txn_write(&client->txn, index, new_value) < 0) {
+                return conn_replyf(conn, "ERROR transaction too large");
+            }
+            return conn_replyf(conn, "QUEUED");
+        }
 
-                char response[1024];
-                snprintf(response, sizeof(response), "VALUE %d", value);
-                send(client_socket, response, strlen(response), 0);
+        lock_writes();
+        if (expired(client)) {
+            unlock_writes();
+            return conn_replyf(conn, "EXPIRED");
+        }
+        int old_value;
+        int written = txn_write_one(index, new_value, &old_value) == TXN_COMMITTED;
+        unlock_writes();
+        if (!written) {
+            return conn_replyf(conn, "ERROR out of memory");
+        }
 
-                snprintf(response, sizeof(response), "read value %d from index  %d", value, index);
-                notify_observers(response);
-            } else if (strncmp(request, "WRITE", 5) == 0) {
-                int index, new_value;
-                sscanf(request + 6, "%d %d", &index, &new_value);
+        client_event(client, EVENT_UPDATE, index, new_value, old_value);
+        return conn_replyf(conn, "UPDATED FROM %d TO %d", old_value, new_value);
+    } else if (strncmp(request, "BULKWRITE", 9) == 0) {
+        int count;
+        if (sscanf(request + 9, "%d", &count) != 1 || count <= 0 || count > BULK_MAX_UPDATES) {
+            return conn_replyf(conn, "ERROR invalid count");
+        }
+        if (client->in_txn || client->in_snapshot || client->bulk) {
+            return conn_replyf(conn, "ERROR transaction already open");
+        }
+        client->bulk = malloc(sizeof(TxnEntry) * count);
+        client->bulk_records = malloc((sizeof(int) + EVENT_MAX_ENCODED) * count);
+        if (!client->bulk || !client->bulk_records) {
+            end_bulk(client);
+            return conn_replyf(conn, "ERROR out of memory");
+        }
+        client->bulk_size = count;
+        client->bulk_count = 0;
+        client->bulk_error = NULL;
+        return conn_replyf(conn, "OK");
+    } else if (strncmp(request, "BULKDATA", 8) == 0) {
+        return bulk_data(client, request + 8);
+    } else if (strncmp(request, "CAS", 3) == 0) {
+        int index, expected, new_value;
+        if (sscanf(request + 3, "%d %d %d", &index, &expected, &new_value) != 3 || index < 0 ||
+            (size_t)index >= db_size) {
+            return conn_replyf(conn, "ERROR invalid index");
+        }
+        if (client->in_txn || client->in_snapshot) {
+            return conn_replyf(conn, "ERROR transaction already open");
+        }
 
-                sem_wait(&writer_sem);
-                sem_wait(&db_sem);
-                int old_value = db[index];
-                db[index] = new_value;
-                sem_post(&db_sem);
-                sem_post(&writer_sem);
+        lock_writes();
+        if (expired(client)) {
+            unlock_writes();
+            return conn_replyf(conn, "EXPIRED");
+        }
+        int old_value;
+        int result = txn_cas_one(index, expected, new_value, &old_value);
+        unlock_writes();
+        if (result == TXN_ABORTED) {
+            return conn_replyf(conn, "MISMATCH %d", old_value);
+        } else if (result != TXN_COMMITTED) {
+            return conn_replyf(conn, "ERROR out of memory");
+        }
 
-                char response[1024];
-                snprintf(response, sizeof(response), "UPDATED FROM %d TO %d", old_value, new_value);
-                send(client_socket, response, strlen(response), 0);
+        client_event(client, EVENT_UPDATE, index, new_value, old_value);
+        return conn_replyf(conn, "UPDATED FROM %d TO %d", old_value, new_value);
+    } else if (strcmp(request, "STATS") == 0) {
+        AdmissionStats stats;
+        QosStats qos;
+        admission_stats(&stats);
+        qos_stats(&qos);
+        return conn_replyf(conn,
+                           "STATS connections=%ld inflight=%ld admitted=%ld shed_inflight=%ld shed_codel=%ld "
+                           "rejected_connections=%ld overloaded=%d expired=%ld watchers=%ld qos_queued=%ld/%ld/%ld "
+                           "qos_limited=%ld/%ld/%ld",
+                           stats.connections, stats.inflight, stats.admitted, stats.shed_inflight, stats.shed_codel,
+                           stats.rejected_connections, stats.overloaded, stats.expired, watch_count(), qos.queued[QOS_HIGH],
+                           qos.queued[QOS_NORMAL], qos.queued[QOS_LOW], qos.limited[QOS_HIGH],
+                           qos.limited[QOS_NORMAL], qos.limited[QOS_LOW]);
+    }
+    return conn_replyf(conn, "ERROR unknown request");
+}
+
+int is_sheddable(const char *request) {
+    return strncmp(request, "READ", 4) == 0 || strncmp(request, "WRITE", 5) == 0 || strncmp(request, "BEGIN", 5) == 0 ||
+           strncmp(request, "CAS", 3) == 0 || strncmp(request, "LEASE", 5) == 0;
+}
+
+int client_parking(Client *client) {
+    if (!__atomic_load_n(&handing_off, __ATOMIC_ACQUIRE) || client->conn.chan.shm) {
+        return 0;
+    }
+    pthread_mutex_lock(&clients_lock);
+    int parking = !client->dropped;
+    pthread_mutex_unlock(&clients_lock);
+    return parking;
+}
+
+ssize_t client_fill(Client *client) {
+    if (client_parking(client)) {
+        return -1;
+    }
+    return conn_fill(&client->conn);
+}
+
+void register_client(Client *client) {
+    pthread_mutex_lock(&clients_lock);
+    client->thread = pthread_self();
+    client->next = clients;
+    clients = client;
+    pthread_mutex_unlock(&clients_lock);
+}
+
+void unregister_client(Client *client) {
+    pthread_mutex_lock(&clients_lock);
+    for (Client **p = &clients; *p; p = &(*p)->next) {
+        if (*p == client) {
+            *p = client->next;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&clients_cond);
+    pthread_mutex_unlock(&clients_lock);
+}
+
+int park_client(Client *client) {
+    if (!client_parking(client)) {
+        return 0;
+    }
+    client->in_txn = 0;
+    end_bulk(client);
+    if (client->in_snapshot) {
+        mvcc_end(&client->snapshot);
+        client->in_snapshot = 0;
+    }
+    pthread_mutex_lock(&clients_lock);
+    client->parked = 1;
+    pthread_cond_broadcast(&clients_cond);
+    pthread_mutex_unlock(&clients_lock);
+    return 1;
+}
+
+void serve_udp_observer(Client *client) {
+    Conn *conn = &client->conn;
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    if (conn->chan.shm || getpeername(conn->chan.fd, (struct sockaddr *)&addr, &addr_len) < 0 ||
+        addr.sin_family != AF_INET) {
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+    addr.sin_port = htons(client->udp_port);
+    if (udpfan_register(&addr) < 0) {
+        fprintf(stderr, "UDP fan-out is not available\n");
+        return;
+    }
+    log_write(LOG_INFO, "UDP observer registered on port %d.\n", client->udp_port);
 
-                char response_log[1024];
-                snprintf(response_log, sizeof(response_log), "DB[%d] updated to %d (old value %d)", index, new_value, old_value);
-                notify_observers(response_log);
+    char request[CONN_MAX_FRAME];
+    int status;
+    do {
+        while ((status = conn_next_frame(conn, request, sizeof(request))) > 0) {
+            unsigned long cursor, last;
+            if (sscanf(request, "FETCH %lu %lu", &cursor, &last) != 2) {
+                continue;
             }
-            free(request);
-        } else {
+            unsigned long before;
+            int flushed;
+            do {
+                before = cursor;
+                eventlog_fetch(&cursor, last, &conn->out);
+            } while ((flushed = conn_flush(conn)) == 0 && cursor <= last && cursor != before);
+            if (flushed < 0) {
+                status = -1;
+                break;
+            }
+        }
+    } while (status == 0 && client_fill(client) > 0);
+    udpfan_unregister(&addr);
+}
+
+void parse_observer(Client *client, const char *handshake) {
+    if (sscanf(handshake, "OBSERVER UDP %d", &client->udp_port) == 1) {
+        client->kind = CLIENT_UDP_OBSERVER;
+        return;
+    }
+    client->kind = CLIENT_OBSERVER;
+    client->cursor = eventlog_next();
+    if (strcmp(handshake, "OBSERVER INVALIDATIONS") == 0) {
+        client->format = EVENTS_INVALIDATIONS;
+        return;
+    }
+    char encoding[16] = "";
+    client->format = EVENTS_TEXT;
+    if (sscanf(handshake, "OBSERVER FROM %lu %15s", &client->cursor, encoding) >= 1) {
+        client->format = strcmp(encoding, "ZLIB") == 0     ? EVENTS_BINARY_ZLIB
+                         : strcmp(encoding, "BINARY") == 0 ? EVENTS_BINARY
+                                                           : EVENTS_TEXT_SEQ;
+    }
+    if (client->cursor == 0) {
+        client->cursor = eventlog_next();
+    }
+}
+
+void serve_observer(Client *client) {
+    Conn *conn = &client->conn;
+    log_write(LOG_INFO, "Observer subscribed from seq %lu.\n", client->cursor);
+    if (client->format == EVENTS_INVALIDATIONS) {
+        frame_appendf(&conn->out, "INVALIDATE ALL");
+    }
+    while (eventlog_read(&client->cursor, &conn->out, client->format) >= 0 && conn_flush(conn) == 0) {
+    }
+}
+
+int watch_request(Client *client, const char *request) {
+    Conn *conn = &client->conn;
+    int index, value;
+    unsigned version, current;
+    int mode = watch_parse(request, &index, &version);
+    if (mode < 0) {
+        return conn_replyf(conn, "ERROR invalid index");
+    }
+    if (client->in_txn || client->in_snapshot || client->bulk) {
+        return conn_replyf(conn, "ERROR transaction already open");
+    }
+    txn_read_one(index, &value, &current);
+    if (mode == WATCH_SINCE && version != current) {
+        return conn_replyf(conn, "CHANGED %d %u", value, current);
+    }
+    if (conn_flush(conn) < 0) {
+        return -1;
+    }
+    notify_observers_batch(&client->events);
+    client->events.len = 0;
+    if (watch_park(&conn->chan, client->qos, index, mode == WATCH_SINCE ? version : current, conn->in + conn->in_start,
+                   conn->in_end - conn->in_start) < 0) {
+        return conn_replyf(conn, "ERROR out of memory");
+    }
+    unregister_client(client);
+    free(client);
+    return 1;
+}
+
+int schedule_request(Client *client, const char *request, int charged) {
+    qos_enter(client->qos);
+    int result;
+    if (expired(client)) {
+        if (charged) {
+            qos_refund(client->qos);
+        }
+        result = conn_replyf(&client->conn, "EXPIRED");
+    } else {
+        result = handle_request(client, request);
+    }
+    qos_exit();
+    return result;
+}
+
+int reply_expired(Conn *conn, int *count) {
+    int result = *count == 1 ? conn_replyf(conn, "EXPIRED") : conn_replyf(conn, "EXPIRED %d", *count);
+    *count = 0;
+    return result;
+}
+
+int serve_client(Client *client) {
+    Conn *conn = &client->conn;
+    char frame[CONN_MAX_FRAME];
+    int expired_run = 0;
+    while (1) {
+        int status;
+        while ((status = conn_next_frame(conn, frame, sizeof(frame))) > 0) {
+            char *request = frame;
+            client->deadline_us = 0;
+            char *end;
+            long budget_us;
+            if (strncmp(frame, "DEADLINE ", 9) == 0 && (budget_us = strtol(frame + 9, &end, 10), end != frame + 9)) {
+                for (request = end; *request == ' '; ++request) {
+                }
+                if (is_sheddable(request)) {
+                    client->deadline_us = conn->arrival_us + budget_us;
+                }
+            }
+            if (expired(client)) {
+                ++expired_run;
+                continue;
+            }
+            int result = expired_run > 0 ? reply_expired(conn, &expired_run) : 0;
+            if (result < 0) {
+                status = -2;
+                break;
+            }
+            if (strncmp(request, "WATCH", 5) == 0) {
+                if ((result = watch_request(client, request)) > 0) {
+                    return 1;
+                }
+            } else if (!is_sheddable(request)) {
+                result = schedule_request(client, request, 0);
+            } else if (qos_admit(client->qos) < 0) {
+                result = conn_replyf(conn, "BUSY");
+            } else if (admission_enter(conn->arrival_us) < 0) {
+                qos_refund(client->qos);
+                result = conn_replyf(conn, "BUSY");
+            } else {
+                result = schedule_request(client, request, 1);
+                admission_exit();
+            }
+            if (result < 0) {
+                status = -2;
+                break;
+            }
+        }
+        if (status == -1) {
             fprintf(stderr, "Invalid message length\n");
             break;
         }
+        if (status != -2 && expired_run > 0 && reply_expired(conn, &expired_run) < 0) {
+            status = -2;
+        }
+        if (status == -2 || conn_flush(conn) < 0) {
+            break;
+        }
+        notify_observers_batch(&client->events);
+        client->events.len = 0;
+        if (client_fill(client) <= 0) {
+            break;
+        }
     }
-    close(client_socket);
-    printf("Client disconnected.\n");
-    char notification[1024];
-    snprintf(notification, sizeof(notification), "Client disconnected");
-    notify_observers(notification);
+    return 0;
+}
+
+void finish_client(Client *client) {
+    unregister_client(client);
+    Conn *conn = &client->conn;
+    if (client->kind == CLIENT_DB) {
+        notify_observers_batch(&client->events);
+    }
+    if (client->in_snapshot) {
+        mvcc_end(&client->snapshot);
+    }
+    end_bulk(client);
+    channel_close(&conn->chan);
+    ClientKind kind = client->kind;
+    free(client);
+    admission_disconnect();
+    if (kind == CLIENT_DB) {
+        log_write(LOG_INFO, "Client disconnected.\n");
+        notify_observers(EVENT_DISCONNECT);
+    } else if (kind != CLIENT_NEW) {
+        log_write(LOG_INFO, "Observer disconnected.\n");
+    }
+}
+
+void *handle_client(void *arg) {
+    Client *client = (Client *)arg;
+    Conn *conn = &client->conn;
+    register_client(client);
 
+    if (client->kind == CLIENT_NEW) {
+        char handshake_message[HANDSHAKE_SIZE];
+        if (conn_handshake(conn, handshake_message, sizeof(handshake_message)) < 0) {
+            if (!park_client(client)) {
+                perror("Error receiving handshake message");
+                finish_client(client);
+            }
+            return NULL;
+        }
+        if (strncmp(handshake_message, "OBSERVER", 8) == 0) {
+            parse_observer(client, handshake_message);
+        } else {
+            client->kind = CLIENT_DB;
+        }
+        client->qos = qos_handshake_class(handshake_message);
+    }
+    if (client->kind == CLIENT_UDP_OBSERVER) {
+        serve_udp_observer(client);
+    } else if (client->kind == CLIENT_OBSERVER) {
+        serve_observer(client);
+    } else if (serve_client(client)) {
+        return NULL;
+    }
+    if (!park_client(client)) {
+        finish_client(client);
+    }
     return NULL;
 }
 
-void signal_handler(int signal) {
-    printf("Caught signal %d, terminating server...\n", signal);
-    close(server_fd);
-    sem_destroy(&db_sem);
-    sem_destroy(&writer_sem);
-    sem_destroy(&observer_sem);
+int spawn_client(Client *client) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pin_workers && affinity_attr(&attr, &worker_cpus) < 0) {
+        pthread_attr_destroy(&attr);
+        free(client);
+        return -1;
+    }
+    pthread_t client_thread;
+    int err = pthread_create(&client_thread, &attr, handle_client, client);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        perror("thread create failed");
+        free(client);
+        return -1;
+    }
+    return 0;
+}
+
+void resume_watcher(const Channel *chan, int tag, const char *pending, size_t len) {
+    Client *client = (Client *)calloc(1, sizeof(Client));
+    if (!client) {
+        perror("malloc failed");
+        Channel failed = *chan;
+        channel_close(&failed);
+        admission_disconnect();
+        return;
+    }
+    conn_init(&client->conn, chan);
+    memcpy(client->conn.in, pending, len);
+    client->conn.in_end = len;
+    client->conn.fill_arrival_us = admission_now_us();
+    client->kind = CLIENT_DB;
+    client->qos = tag;
+    if (spawn_client(client) < 0) {
+        Channel failed = *chan;
+        channel_close(&failed);
+        admission_disconnect();
+    }
+}
+
+void drop_watcher(Channel *chan) {
+    channel_close(chan);
+    admission_disconnect();
+    log_write(LOG_INFO, "Client disconnected.\n");
+    notify_observers(EVENT_DISCONNECT);
+}
+
+int start_client(const Channel *chan) {
+    if (admission_connect() < 0) {
+        Channel rejected = *chan;
+        const char busy[] = {4, 0, 0, 0, 'B', 'U', 'S', 'Y'};
+        channel_send_all(&rejected, busy, sizeof(busy));
+        channel_close(&rejected);
+        return 0;
+    }
+    if (chan->fd >= 0) {
+        int opt = 1;
+        setsockopt(chan->fd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt));
+    }
+    log_write(LOG_INFO, "Client connected.\n");
+    notify_observers(EVENT_CONNECT);
+
+    Client *client = (Client *)calloc(1, sizeof(Client));
+    if (!client) {
+        perror("malloc failed");
+        Channel failed = *chan;
+        channel_close(&failed);
+        admission_disconnect();
+        return 0;
+    }
+    conn_init(&client->conn, chan);
+    return spawn_client(client);
+}
+
+void *shm_accept_thread(void *arg) {
+    while (1) {
+        Channel chan;
+        if (shm_accept(shm_server, &chan) == 0 && start_client(&chan) < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    return NULL;
+}
+
+void interrupt_handler(int signal) {
+}
+
+void park_all_clients(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    long deadline_ms = now.tv_sec * 1000L + now.tv_nsec / 1000000 + HANDOFF_TIMEOUT_MS;
+    pthread_mutex_lock(&clients_lock);
+    while (1) {
+        clock_gettime(CLOCK_REALTIME, &now);
+        int expired = now.tv_sec * 1000L + now.tv_nsec / 1000000 >= deadline_ms;
+        int pending = 0;
+        for (Client *client = clients; client; client = client->next) {
+            if (client->parked) {
+                continue;
+            }
+            ++pending;
+            if (client->conn.chan.shm || expired) {
+                if (!client->dropped) {
+                    client->dropped = 1;
+                    channel_shutdown(&client->conn.chan);
+                }
+            } else {
+                pthread_kill(client->thread, SIGUSR1);
+            }
+        }
+        if (pending == 0) {
+            break;
+        }
+        now.tv_nsec += HANDOFF_POLL_MS * 1000000L;
+        if (now.tv_nsec >= 1000000000L) {
+            now.tv_sec += 1;
+            now.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&clients_cond, &clients_lock, &now);
+    }
+    pthread_mutex_unlock(&clients_lock);
+}
+
+int hand_off_watcher(Channel *chan, int tag, const char *request, const char *pending, size_t len, void *arg) {
+    int sock = *(int *)arg;
+    char data[CONN_BUF_SIZE];
+    int request_len = strlen(request);
+    size_t used = request_len > 0 ? sizeof(int) + request_len : 0;
+    if (chan->shm || used + len > sizeof(data)) {
+        channel_shutdown(chan);
+        return 0;
+    }
+    if (request_len > 0) {
+        memcpy(data, &request_len, sizeof(int));
+        memcpy(data + sizeof(int), request, request_len);
+    }
+    memcpy(data + used, pending, len);
+    used += len;
+    HandoffClient record = {CLIENT_DB, 0, 0, used, 0, tag};
+    if (handoff_send(sock, &record, sizeof(record), &chan->fd, 1) < 0 || handoff_send(sock, data, used, NULL, 0) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void hand_off(int listener) {
+    int sock = handoff_accept(listener);
+    if (sock < 0) {
+        return;
+    }
+    close(listener);
+    log_write(LOG_INFO, "Handing off to a new server process...\n");
+    __atomic_store_n(&handing_off, 1, __ATOMIC_RELEASE);
+    channel_interrupt();
+    eventlog_interrupt();
+    if (shm_server) {
+        shm_unlink_segment(shm_server);
+    }
+    watch_stop();
+    park_all_clients();
+    checkpoint_close();
+
+    HandoffHeader header = {HANDOFF_MAGIC, db_size, eventlog_capacity(), listen_count};
+    int fds[HANDOFF_MAX_FDS];
+    memcpy(fds, listen_fds, sizeof(int) * listen_count);
+    fds[listen_count] = eventlog_fd();
+    int result = handoff_send(sock, &header, sizeof(header), fds, listen_count + 1);
+    if (result == 0) {
+        result = handoff_send(sock, db, db_size * sizeof(int), NULL, 0);
+    }
+    unsigned *versions = result == 0 ? malloc(db_size * sizeof(unsigned)) : NULL;
+    if (versions) {
+        txn_save_versions(versions);
+        result = handoff_send(sock, versions, db_size * sizeof(unsigned), NULL, 0);
+        free(versions);
+    } else {
+        result = -1;
+    }
+    int handed = 0;
+    for (Client *client = clients; client && result == 0; client = client->next, ++handed) {
+        Conn *conn = &client->conn;
+        HandoffClient record = {client->kind, client->format, client->udp_port, conn->in_end - conn->in_start,
+                                client->cursor, client->qos};
+        result = handoff_send(sock, &record, sizeof(record), &conn->chan.fd, 1);
+        if (result == 0) {
+            result = handoff_send(sock, conn->in + conn->in_start, record.pending, NULL, 0);
+        }
+    }
+    int watched = result == 0 ? watch_drain(hand_off_watcher, &sock) : -1;
+    HandoffClient end = {-1};
+    if (result < 0 || watched < 0 || handoff_send(sock, &end, sizeof(end), NULL, 0) < 0) {
+        fprintf(stderr, "Hot restart failed\n");
+        exit(EXIT_FAILURE);
+    }
+    log_write(LOG_INFO, "Handed off %d connections and %d watchers, exiting.\n", handed, watched);
     exit(0);
 }
 
+int take_over(int sock, HandoffHeader *header, int *fds, int **handed_db, unsigned **handed_versions) {
+    int fd_count = handoff_recv(sock, header, sizeof(*header), fds, HANDOFF_MAX_FDS);
+    if (fd_count < 0 || header->magic != HANDOFF_MAGIC || header->listen_count >= MAX_LISTENERS ||
+        fd_count != (int)header->listen_count + 1) {
+        fprintf(stderr, "Invalid hot restart state\n");
+        return -1;
+    }
+    *handed_db = malloc(header->db_size * sizeof(int));
+    if (!*handed_db) {
+        perror("malloc failed");
+        return -1;
+    }
+    *handed_versions = malloc(header->db_size * sizeof(unsigned));
+    if (!*handed_versions) {
+        perror("malloc failed");
+        return -1;
+    }
+    if (handoff_recv(sock, *handed_db, header->db_size * sizeof(int), NULL, 0) < 0 ||
+        handoff_recv(sock, *handed_versions, header->db_size * sizeof(unsigned), NULL, 0) < 0) {
+        fprintf(stderr, "Failed to receive the database\n");
+        return -1;
+    }
+    return 0;
+}
+
+int adopt_clients(int sock) {
+    int adopted = 0;
+    while (1) {
+        HandoffClient record;
+        int fd;
+        int fd_count = handoff_recv(sock, &record, sizeof(record), &fd, 1);
+        if (fd_count < 0) {
+            return -1;
+        }
+        if (record.kind < 0) {
+            return adopted;
+        }
+        if (fd_count != 1 || record.pending > CONN_BUF_SIZE) {
+            return -1;
+        }
+        Channel chan;
+        channel_init(&chan, fd);
+        Client *client = (Client *)calloc(1, sizeof(Client));
+        if (!client) {
+            perror("malloc failed");
+            return -1;
+        }
+        conn_init(&client->conn, &chan);
+        if (handoff_recv(sock, client->conn.in, record.pending, NULL, 0) < 0) {
+            free(client);
+            return -1;
+        }
+        client->conn.in_end = record.pending;
+        client->conn.fill_arrival_us = admission_now_us();
+        client->kind = record.kind;
+        client->format = record.format;
+        client->udp_port = record.udp_port;
+        client->cursor = record.cursor;
+        client->qos = record.qos >= 0 && record.qos < QOS_CLASSES ? record.qos : QOS_NORMAL;
+        if (admission_connect() < 0) {
+            channel_close(&client->conn.chan);
+            free(client);
+            continue;
+        }
+        if (spawn_client(client) < 0) {
+            return -1;
+        }
+        ++adopted;
+    }
+}
+
+void signal_handler(int signal) {
+    int saved_errno = errno;
+    stop_signal = signal;
+    if (write(stop_pipe[1], "", 1) < 0) {
+    }
+    errno = saved_errno;
+}
+
 int main(int argc, char const *argv[]) {
-    for(int i = 0; i < MAX_CLIENTS; ++i) {
-        observer_clients[i] = -1;
+    const char *data_dir = NULL;
+    int checkpoint_interval = CHECKPOINT_INTERVAL;
+    const char *listen_uris[MAX_LISTENERS];
+    int listen_uri_count = 0;
+    int backlog = LISTEN_BACKLOG;
+    size_t event_log_size = EVENT_LOG_SIZE;
+    const char *event_log_file = NULL;
+    int udp_fanout = 0;
+    const char *hot_restart_path = NULL;
+    cpu_set_t accept_cpus;
+    int pin_accept = 0;
+    AdmissionConfig admission = {MAX_CONNECTIONS, MAX_INFLIGHT, CODEL_TARGET_MS * 1000L, CODEL_INTERVAL_MS * 1000L};
+    QosConfig qos = {0, QOS_STRICT, {0}};
+    int log_mode = LOG_ASYNC;
+    int log_level = LOG_INFO;
+    static struct option options[] = {
+        {"backlog", required_argument, NULL, 'b'},
+        {"max-connections", required_argument, NULL, 'm'},
+        {"max-inflight", required_argument, NULL, 'f'},
+        {"codel-target", required_argument, NULL, 't'},
+        {"codel-interval", required_argument, NULL, 'i'},
+        {"listen", required_argument, NULL, 'l'},
+        {"data-dir", required_argument, NULL, 'd'},
+        {"checkpoint-interval", required_argument, NULL, 'c'},
+        {"size", required_argument, NULL, 's'},
+        {"event-log-size", required_argument, NULL, 'e'},
+        {"event-log-file", required_argument, NULL, 'E'},
+        {"udp-fanout", no_argument, NULL, 'u'},
+        {"slot-locks", no_argument, NULL, 'S'},
+        {"accept-cpus", required_argument, NULL, 'A'},
+        {"worker-cpus", required_argument, NULL, 'W'},
+        {"hot-restart", required_argument, NULL, 'H'},
+        {"lease-ms", required_argument, NULL, 'L'},
+        {"qos-slots", required_argument, NULL, 'q'},
+        {"qos-policy", required_argument, NULL, 'P'},
+        {"qos-rate", required_argument, NULL, 'R'},
+        {"log", required_argument, NULL, 'o'},
+        {"log-level", required_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt_char;
+    while ((opt_char = getopt_long(argc, (char *const *)argv, "l:d:c:s:b:m:f:t:i:e:E:uSA:W:H:L:q:P:R:o:v:", options, NULL)) != -1) {
+        switch (opt_char) {
+            case 'b':
+                backlog = atoi(optarg);
+                break;
+            case 'm':
+                admission.max_connections = atoi(optarg);
+                break;
+            case 'f':
+                admission.max_inflight = atoi(optarg);
+                break;
+            case 't':
+                admission.codel_target_us = atof(optarg) * 1000;
+                break;
+            case 'i':
+                admission.codel_interval_us = atof(optarg) * 1000;
+                break;
+            case 'l':
+                if (listen_uri_count == MAX_LISTENERS - 1) {
+                    argc = 0;
+                    break;
+                }
+                listen_uris[listen_uri_count++] = optarg;
+                break;
+            case 'd':
+                data_dir = optarg;
+                break;
+            case 'c':
+                checkpoint_interval = atoi(optarg);
+                break;
+            case 's':
+                db_size = strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                event_log_size = strtoul(optarg, NULL, 10);
+                break;
+            case 'E':
+                event_log_file = optarg;
+                break;
+            case 'u':
+                udp_fanout = 1;
+                break;
+            case 'S':
+                slot_locks = 1;
+                break;
+            case 'A':
+                if (cpuset_parse(optarg, &accept_cpus) < 0) {
+                    argc = 0;
+                }
+                pin_accept = 1;
+                break;
+            case 'W':
+                if (cpuset_parse(optarg, &worker_cpus) < 0) {
+                    argc = 0;
+                }
+                pin_workers = 1;
+                break;
+            case 'H':
+                hot_restart_path = optarg;
+                break;
+            case 'L':
+                lease_ms = atoi(optarg);
+                break;
+            case 'q':
+                qos.slots = atoi(optarg);
+                break;
+            case 'P':
+                if (strcmp(optarg, "strict") == 0) {
+                    qos.policy = QOS_STRICT;
+                } else if (strcmp(optarg, "weighted") == 0) {
+                    qos.policy = QOS_WEIGHTED;
+                } else {
+                    argc = 0;
+                }
+                break;
+            case 'R':
+                if (qos_parse_rate(optarg, &qos) < 0) {
+                    argc = 0;
+                }
+                break;
+            case 'o':
+                if ((log_mode = log_parse_mode(optarg)) < 0) {
+                    argc = 0;
+                }
+                break;
+            case 'v':
+                if ((log_level = log_parse_level(optarg)) < 0) {
+                    argc = 0;
+                }
+                break;
+            default:
+                argc = 0;
+        }
     }
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <ip_address> <port>\n", argv[0]);
+    if (argc - optind != 2 || db_size == 0 || checkpoint_interval <= 0 || lease_ms < 0 ||
+        qos.slots < 0) {
+        fprintf(stderr,
+                "Usage: %s <ip_address> <port> [--listen unix://<path>|shm://<name>] [--data-dir <dir>] "
+                "[--checkpoint-interval <sec>] [--size <n>] [--backlog <n>] [--max-connections <n>] "
+                "[--max-inflight <n>] [--codel-target <ms>] [--codel-interval <ms>] [--event-log-size <bytes>] "
+                "[--event-log-file <path>] [--udp-fanout] [--slot-locks] [--accept-cpus <list>] "
+                "[--worker-cpus <list>] [--hot-restart <path>] [--lease-ms <ms>] [--qos-slots <n>] "
+                "[--qos-policy strict|weighted] [--qos-rate <class>=<req/s>] [--log sync|async|binary] "
+                "[--log-level debug|info|warn|error]\n",
+                argv[0]);
         return -1;
     }
 
-    const char *server_ip = argv[1];
-    int port = atoi(argv[2]);
+    const char *server_ip = argv[optind];
+    int port = atoi(argv[optind + 1]);
+    log_init(log_mode, log_level);
 
-    init_db();
+    if (pin_accept && affinity_pin_self(&accept_cpus) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (pin_workers) {
+        int node = cpuset_node(&worker_cpus);
+        if (node >= 0 && affinity_prefer_node(node) < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    struct sockaddr_in address;
-    int opt = 1;
-    int addrlen = sizeof(address);
+    int takeover = hot_restart_path ? handoff_connect(hot_restart_path) : -1;
+    HandoffHeader handoff_header;
+    int handed_fds[HANDOFF_MAX_FDS];
+    int *handed_db = NULL;
+    unsigned *handed_versions = NULL;
+    if (takeover >= 0) {
+        log_write(LOG_INFO, "Taking over from the running server via %s\n", hot_restart_path);
+        if (take_over(takeover, &handoff_header, handed_fds, &handed_db, &handed_versions) < 0) {
+            exit(EXIT_FAILURE);
+        }
+        event_log_size = handoff_header.event_log_capacity;
+    }
 
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        perror("socket() failed");
+    int loaded = 0;
+    if (data_dir) {
+        loaded = checkpoint_load(data_dir, &db, &db_size);
+        if (loaded < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (!loaded && handed_db) {
+        db = handed_db;
+        db_size = handoff_header.db_size;
+    } else if (!loaded) {
+        db = malloc(db_size * sizeof(int));
+        if (!db) {
+            perror("malloc failed");
+            exit(EXIT_FAILURE);
+        }
+        init_db();
+    }
+    if (data_dir) {
+        long replayed = checkpoint_replay(db, db_size);
+        if (replayed < 0 || checkpoint_log_open() < 0) {
+            exit(EXIT_FAILURE);
+        }
+        log_write(LOG_INFO, "Restored %zu records from %s, replayed %ld log entries\n", db_size, data_dir, replayed);
+    }
+    if (loaded && handed_db) {
+        if (db_size != handoff_header.db_size) {
+            fprintf(stderr, "Database size differs from the running server\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(db, handed_db, db_size * sizeof(int));
+        free(handed_db);
+    }
+    lease_until = calloc(db_size, sizeof(long));
+    if (!lease_until) {
+        perror("malloc failed");
         exit(EXIT_FAILURE);
     }
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
-        perror("setsockopt() failed");
+    if (mvcc_init(db, db_size) < 0 || txn_init(db, db_size) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (handed_versions) {
+        txn_load_versions(handed_versions);
+        free(handed_versions);
+    }
+    WatchHooks watch_hooks = {resume_watcher, drop_watcher};
+    if (watch_init(db_size, &watch_hooks) < 0) {
         exit(EXIT_FAILURE);
     }
 
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = inet_addr(server_ip);
-    address.sin_port = htons(port);
-
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-        perror("bind failed");
+    int log_opened = takeover >= 0 ? eventlog_adopt(handed_fds[handoff_header.listen_count], event_log_size)
+                                   : eventlog_open(event_log_file, event_log_size);
+    if (log_opened < 0 || (udp_fanout && udpfan_start() < 0)) {
         exit(EXIT_FAILURE);
     }
+    admission_init(&admission);
+    qos_init(&qos);
 
-    if (listen(server_fd, 3) < 0) {
-        perror("listen failed");
+    TransportAddr tcp_addr = {TRANSPORT_TCP};
+    snprintf(tcp_addr.host, sizeof(tcp_addr.host), "%s", server_ip);
+    tcp_addr.port = port;
+    if (takeover >= 0) {
+        listen_count = handoff_header.listen_count;
+        memcpy(listen_fds, handed_fds, sizeof(int) * listen_count);
+    } else if ((listen_fds[listen_count++] = transport_listen(&tcp_addr, backlog)) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < listen_uri_count; ++i) {
+        TransportAddr addr;
+        if (transport_parse(listen_uris[i], &addr) < 0) {
+            fprintf(stderr, "Invalid listen address %s\n", listen_uris[i]);
+            exit(EXIT_FAILURE);
+        }
+        if (addr.kind == TRANSPORT_SHM) {
+            if (shm_server || !(shm_server = shm_listen(addr.path))) {
+                exit(EXIT_FAILURE);
+            }
+        } else if (takeover < 0 && (listen_fds[listen_count++] = transport_listen(&addr, backlog)) < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (pipe2(stop_pipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+        perror("pipe() failed");
         exit(EXIT_FAILURE);
     }
     signal(SIGINT, signal_handler);
+    struct sigaction interrupt_action = {0};
+    interrupt_action.sa_handler = interrupt_handler;
+    sigaction(SIGUSR1, &interrupt_action, NULL);
 
     if (sem_init(&db_sem, 0, 1) != 0) {
         perror("sem_init db_sem failed");
@@ -168,73 +1305,86 @@ int main(int argc, char const *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    if (sem_init(&observer_sem, 0, 1) != 0) {
-        perror("sem_init observer_sem failed");
-        sem_destroy(&db_sem);
-        sem_destroy(&writer_sem);
-        exit(EXIT_FAILURE);
+    if (data_dir) {
+        pthread_t checkpoint_tid;
+        if (pthread_create(&checkpoint_tid, NULL, checkpoint_thread, &checkpoint_interval) != 0) {
+            perror("thread create failed");
+            exit(EXIT_FAILURE);
+        }
+        pthread_detach(checkpoint_tid);
     }
 
-    printf("Server listening on <ip:port> %s:%d\n", server_ip, port);
-
-    while (1) {
-        int *client_socket_ptr = (int *)malloc(sizeof(int));
-        if (!client_socket_ptr) {
-            perror("malloc failed");
-            sem_destroy(&db_sem);
-            sem_destroy(&writer_sem);
-            sem_destroy(&observer_sem);
+    if (shm_server) {
+        pthread_t shm_tid;
+        if (pthread_create(&shm_tid, NULL, shm_accept_thread, NULL) != 0) {
+            perror("thread create failed");
             exit(EXIT_FAILURE);
         }
+        pthread_detach(shm_tid);
+    }
 
-        if ((*client_socket_ptr = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0) {
-            perror("accept() failed");
-            free(client_socket_ptr);
-            sem_destroy(&db_sem);
-            sem_destroy(&writer_sem);
-            sem_destroy(&observer_sem);
+    if (takeover >= 0) {
+        int adopted = adopt_clients(takeover);
+        close(takeover);
+        if (adopted < 0) {
+            fprintf(stderr, "Hot restart failed\n");
             exit(EXIT_FAILURE);
         }
-        printf("Client connected.\n");
-        char notification[1024];
-        snprintf(notification, sizeof(notification), "Client connected");
-        notify_observers(notification);
-
-        char handshake_message[50];
-        int bytes_received = recv(*client_socket_ptr, handshake_message, sizeof(handshake_message), 0);
-        if (bytes_received > 0) {
-            handshake_message[bytes_received] = '\0';
-            if (strcmp(handshake_message, "OBSERVER") == 0) {
-                sem_wait(&observer_sem);
-                for (int i = 0; i < MAX_CLIENTS; ++i) {
-                    if (observer_clients[i] == -1) {
-                        observer_clients[i] = *client_socket_ptr;
-                        break;
-                    }
-                }
-                sem_post(&observer_sem);
-            } else {
-                pthread_t client_thread;
-                if (pthread_create(&client_thread, NULL, handle_client, client_socket_ptr) != 0) {
-                    perror("thread create failed");
-                    free(client_socket_ptr);
-                    sem_destroy(&db_sem);
-                    sem_destroy(&writer_sem);
-                    sem_destroy(&observer_sem);
-                    exit(EXIT_FAILURE);
-                }
-                pthread_detach(client_thread);
+        log_write(LOG_INFO, "Took over %d connections\n", adopted);
+    }
+    int handoff_fd = -1;
+    if (hot_restart_path && (handoff_fd = handoff_listen(hot_restart_path)) < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    log_write(LOG_INFO, "Server listening on <ip:port> %s:%d\n", server_ip, port);
+    for (int i = 0; i < listen_uri_count; ++i) {
+        log_write(LOG_INFO, "Server listening on %s\n", listen_uris[i]);
+    }
+
+    struct pollfd poll_fds[MAX_LISTENERS + 2];
+    for (int i = 0; i < listen_count; ++i) {
+        poll_fds[i].fd = listen_fds[i];
+        poll_fds[i].events = POLLIN;
+    }
+    poll_fds[listen_count].fd = handoff_fd;
+    poll_fds[listen_count].events = POLLIN;
+    poll_fds[listen_count + 1].fd = stop_pipe[0];
+    poll_fds[listen_count + 1].events = POLLIN;
+    while (!stop_signal) {
+        if (poll(poll_fds, listen_count + 2, -1) < 0) {
+            continue;
+        }
+        if (handoff_fd >= 0 && (poll_fds[listen_count].revents & POLLIN)) {
+            hand_off(handoff_fd);
+        }
+        for (int i = 0; i < listen_count; ++i) {
+            if (!(poll_fds[i].revents & POLLIN)) {
+                continue;
+            }
+            int client_socket = accept(listen_fds[i], NULL, NULL);
+            if (client_socket < 0) {
+                perror("accept() failed");
+                continue;
+            }
+            int opt = 1;
+            setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+            Channel chan;
+            channel_init(&chan, client_socket);
+            if (start_client(&chan) < 0) {
+                sem_destroy(&db_sem);
+                sem_destroy(&writer_sem);
+                exit(EXIT_FAILURE);
             }
-        } else {
-            perror("Error receiving handshake message");
-            close(*client_socket_ptr);
-            free(client_socket_ptr);
         }
     }
 
-    close(server_fd);
-    sem_destroy(&db_sem);
-    sem_destroy(&writer_sem);
-    sem_destroy(&observer_sem);
+    log_write(LOG_INFO, "Caught signal %d, terminating server...\n", (int)stop_signal);
+    for (int i = 0; i < listen_count; ++i) {
+        close(listen_fds[i]);
+    }
+    if (shm_server) {
+        shm_unlink_segment(shm_server);
+    }
     return 0;
 }
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "shm_ring.h"
+
+#define SHM_MAGIC 0x314d4853u
+#define SHM_SPIN 200
+#define SHM_CONNECT_TIMEOUT 5
+
+enum {
+    SLOT_FREE,
+    SLOT_CLAIMED,
+    SLOT_CONNECTING,
+    SLOT_ACTIVE
+};
+
+typedef struct {
+    uint32_t head __attribute__((aligned(64)));
+    uint32_t data_seq;
+    uint32_t data_waiters;
+    uint32_t tail __attribute__((aligned(64)));
+    uint32_t space_seq;
+    uint32_t space_waiters;
+    char data[SHM_RING_SIZE] __attribute__((aligned(64)));
+} ShmRing;
+
+struct ShmSlot {
+    uint32_t state;
+    uint32_t refs;
+    uint32_t closed;
+    pid_t client_pid;
+    pid_t server_pid;
+    ShmRing to_server;
+    ShmRing to_client;
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t accept_seq;
+    uint32_t accept_waiters;
+    pid_t server_pid;
+    struct ShmSlot slots[SHM_SLOTS];
+} ShmSegment;
+
+struct ShmServer {
+    ShmSegment *segment;
+    char name[108];
+};
+
+static ShmSegment *client_segment;
+static char client_segment_name[108];
+static pthread_mutex_t client_segment_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int futex_wait(uint32_t *addr, uint32_t expected, int seconds) {
+    struct timespec timeout = {seconds, 0};
+    return syscall(SYS_futex, addr, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+static void futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void signal_seq(uint32_t *seq, uint32_t *waiters) {
+    __atomic_add_fetch(seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiters, __ATOMIC_SEQ_CST)) {
+        futex_wake(seq);
+    }
+}
+
+static int peer_alive(struct ShmSlot *slot, int server_side) {
+    pid_t pid = server_side ? slot->client_pid : slot->server_pid;
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+static int ring_ready(ShmRing *ring, struct ShmSlot *slot, int want_data) {
+    uint32_t used = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->closed, __ATOMIC_ACQUIRE)) {
+        return 1;
+    }
+    return want_data ? used > 0 : used < SHM_RING_SIZE;
+}
+
+static void ring_wait(ShmRing *ring, struct ShmSlot *slot, int want_data, int server_side) {
+    for (int i = 0; i < SHM_SPIN; ++i) {
+        if (ring_ready(ring, slot, want_data)) {
+            return;
+        }
+    }
+    uint32_t *seq = want_data ? &ring->data_seq : &ring->space_seq;
+    uint32_t *waiters = want_data ? &ring->data_waiters : &ring->space_waiters;
+    while (1) {
+        uint32_t observed = __atomic_load_n(seq, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+        int ready = ring_ready(ring, slot, want_data);
+        if (!ready && futex_wait(seq, observed, 1) < 0 && errno == ETIMEDOUT && !peer_alive(slot, server_side)) {
+            __atomic_store_n(&slot->closed, 1, __ATOMIC_RELEASE);
+            ready = 1;
+        }
+        __atomic_sub_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+        if (ready || ring_ready(ring, slot, want_data)) {
+            return;
+        }
+    }
+}
+
+ssize_t shm_recv(struct ShmSlot *slot, int server_side, void *data, size_t len) {
+    ShmRing *ring = server_side ? &slot->to_server : &slot->to_client;
+    ring_wait(ring, slot, 1, server_side);
+    uint32_t tail = ring->tail;
+    uint32_t used = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+    if (used == 0) {
+        return 0;
+    }
+    size_t n = used < len ? used : len;
+    size_t offset = tail % SHM_RING_SIZE;
+    size_t first = n < SHM_RING_SIZE - offset ? n : SHM_RING_SIZE - offset;
+    memcpy(data, ring->data + offset, first);
+    memcpy((char *)data + first, ring->data, n - first);
+    __atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+    signal_seq(&ring->space_seq, &ring->space_waiters);
+    return n;
+}
+
+ssize_t shm_send(struct ShmSlot *slot, int server_side, const void *data, size_t len) {
+    ShmRing *ring = server_side ? &slot->to_client : &slot->to_server;
+    ring_wait(ring, slot, 0, server_side);
+    if (__atomic_load_n(&slot->closed, __ATOMIC_ACQUIRE)) {
+        errno = EPIPE;
+        return -1;
+    }
+    uint32_t head = ring->head;
+    uint32_t space = SHM_RING_SIZE - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+    size_t n = space < len ? space : len;
+    size_t offset = head % SHM_RING_SIZE;
+    size_t first = n < SHM_RING_SIZE - offset ? n : SHM_RING_SIZE - offset;
+    memcpy(ring->data + offset, data, first);
+    memcpy(ring->data, (const char *)data + first, n - first);
+    __atomic_store_n(&ring->head, head + n, __ATOMIC_RELEASE);
+    signal_seq(&ring->data_seq, &ring->data_waiters);
+    return n;
+}
+
+int shm_peer_alive(struct ShmSlot *slot, int server_side) {
+    return !__atomic_load_n(&slot->closed, __ATOMIC_ACQUIRE) && peer_alive(slot, server_side);
+}
+
+void shm_shutdown(struct ShmSlot *slot) {
+    __atomic_store_n(&slot->closed, 1, __ATOMIC_SEQ_CST);
+    signal_seq(&slot->to_server.data_seq, &slot->to_server.data_waiters);
+    signal_seq(&slot->to_server.space_seq, &slot->to_server.space_waiters);
+    signal_seq(&slot->to_client.data_seq, &slot->to_client.data_waiters);
+    signal_seq(&slot->to_client.space_seq, &slot->to_client.space_waiters);
+}
+
+void shm_close(struct ShmSlot *slot, int server_side) {
+    (void)server_side;
+    shm_shutdown(slot);
+    if (__atomic_sub_fetch(&slot->refs, 1, __ATOMIC_SEQ_CST) == 0) {
+        __atomic_store_n(&slot->state, SLOT_FREE, __ATOMIC_SEQ_CST);
+    }
+}
+
+static ShmSegment *map_segment(const char *name, int create) {
+    int fd = shm_open(name, create ? O_CREAT | O_RDWR | O_TRUNC : O_RDWR, 0600);
+    if (fd < 0) {
+        perror("shm_open() failed");
+        return NULL;
+    }
+    if (create && ftruncate(fd, sizeof(ShmSegment)) < 0) {
+        perror("ftruncate() failed");
+        close(fd);
+        return NULL;
+    }
+    ShmSegment *segment = mmap(NULL, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        perror("mmap() failed");
+        return NULL;
+    }
+    return segment;
+}
+
+ShmServer *shm_listen(const char *name) {
+    ShmServer *server = calloc(1, sizeof(ShmServer));
+    if (!server) {
+        return NULL;
+    }
+    server->segment = map_segment(name, 1);
+    if (!server->segment) {
+        free(server);
+        return NULL;
+    }
+    snprintf(server->name, sizeof(server->name), "%s", name);
+    server->segment->server_pid = getpid();
+    __atomic_store_n(&server->segment->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    return server;
+}
+
+int shm_accept(ShmServer *server, Channel *chan) {
+    ShmSegment *segment = server->segment;
+    while (1) {
+        uint32_t observed = __atomic_load_n(&segment->accept_seq, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&segment->accept_waiters, 1, __ATOMIC_SEQ_CST);
+        for (int i = 0; i < SHM_SLOTS; ++i) {
+            uint32_t expected = SLOT_CONNECTING;
+            struct ShmSlot *slot = &segment->slots[i];
+            if (__atomic_compare_exchange_n(&slot->state, &expected, SLOT_ACTIVE, 0, __ATOMIC_SEQ_CST,
+                                            __ATOMIC_RELAXED)) {
+                __atomic_sub_fetch(&segment->accept_waiters, 1, __ATOMIC_SEQ_CST);
+                futex_wake(&slot->state);
+                channel_init(chan, -1);
+                chan->shm = slot;
+                chan->shm_server = 1;
+                return 0;
+            }
+        }
+        futex_wait(&segment->accept_seq, observed, 1);
+        __atomic_sub_fetch(&segment->accept_waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void shm_unlink_segment(ShmServer *server) {
+    shm_unlink(server->name);
+}
+
+int shm_connect(const char *name, Channel *chan) {
+    pthread_mutex_lock(&client_segment_lock);
+    if (!client_segment || strcmp(client_segment_name, name) != 0) {
+        client_segment = map_segment(name, 0);
+        snprintf(client_segment_name, sizeof(client_segment_name), "%s", name);
+    }
+    ShmSegment *segment = client_segment;
+    pthread_mutex_unlock(&client_segment_lock);
+    if (!segment || __atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC) {
+        fprintf(stderr, "Connection failed\n");
+        return -1;
+    }
+
+    for (int i = 0; i < SHM_SLOTS; ++i) {
+        struct ShmSlot *slot = &segment->slots[i];
+        uint32_t expected = SLOT_FREE;
+        if (!__atomic_compare_exchange_n(&slot->state, &expected, SLOT_CLAIMED, 0, __ATOMIC_SEQ_CST,
+                                         __ATOMIC_RELAXED)) {
+            continue;
+        }
+        slot->to_server.head = slot->to_server.tail = 0;
+        slot->to_client.head = slot->to_client.tail = 0;
+        slot->closed = 0;
+        slot->refs = 2;
+        slot->client_pid = getpid();
+        slot->server_pid = segment->server_pid;
+        __atomic_store_n(&slot->state, SLOT_CONNECTING, __ATOMIC_SEQ_CST);
+        signal_seq(&segment->accept_seq, &segment->accept_waiters);
+
+        for (int waited = 0; __atomic_load_n(&slot->state, __ATOMIC_SEQ_CST) == SLOT_CONNECTING; ++waited) {
+            if (waited == SHM_CONNECT_TIMEOUT) {
+                expected = SLOT_CONNECTING;
+                if (__atomic_compare_exchange_n(&slot->state, &expected, SLOT_FREE, 0, __ATOMIC_SEQ_CST,
+                                                __ATOMIC_RELAXED)) {
+                    fprintf(stderr, "Connection failed\n");
+                    return -1;
+                }
+                break;
+            }
+            futex_wait(&slot->state, SLOT_CONNECTING, 1);
+        }
+        channel_init(chan, -1);
+        chan->shm = slot;
+        chan->shm_server = 0;
+        return 0;
+    }
+    fprintf(stderr, "Connection failed: no free shm slots\n");
+    return -1;
+}
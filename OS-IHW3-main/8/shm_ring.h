@@ -0,0 +1,25 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "transport.h"
+
+#define SHM_SLOTS 64
+#define SHM_RING_SIZE 65536
+
+typedef struct ShmServer ShmServer;
+
+ShmServer *shm_listen(const char *name);
+int shm_accept(ShmServer *server, Channel *chan);
+void shm_unlink_segment(ShmServer *server);
+int shm_connect(const char *name, Channel *chan);
+ssize_t shm_recv(struct ShmSlot *slot, int server_side, void *data, size_t len);
+ssize_t shm_send(struct ShmSlot *slot, int server_side, const void *data, size_t len);
+int shm_peer_alive(struct ShmSlot *slot, int server_side);
+void shm_shutdown(struct ShmSlot *slot);
+void shm_close(struct ShmSlot *slot, int server_side);
+
+#endif
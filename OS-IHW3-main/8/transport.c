@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "transport.h"
+#include "shm_ring.h"
+
+static volatile int recv_interrupted;
+
+int transport_parse(const char *uri, TransportAddr *addr) {
+    memset(addr, 0, sizeof(*addr));
+    if (strncmp(uri, "tcp://", 6) == 0) {
+        const char *colon = strrchr(uri + 6, ':');
+        size_t host_len = colon ? (size_t)(colon - (uri + 6)) : 0;
+        if (!colon || host_len == 0 || host_len >= sizeof(addr->host)) {
+            return -1;
+        }
+        addr->kind = TRANSPORT_TCP;
+        memcpy(addr->host, uri + 6, host_len);
+        addr->port = atoi(colon + 1);
+        return addr->port > 0 ? 0 : -1;
+    } else if (strncmp(uri, "unix://", 7) == 0) {
+        addr->kind = TRANSPORT_UNIX;
+        if (strlen(uri + 7) == 0 || strlen(uri + 7) >= sizeof(addr->path)) {
+            return -1;
+        }
+        strcpy(addr->path, uri + 7);
+        return 0;
+    } else if (strncmp(uri, "shm://", 6) == 0) {
+        addr->kind = TRANSPORT_SHM;
+        if (strlen(uri + 6) == 0 || strlen(uri + 6) + 1 >= sizeof(addr->path) || strchr(uri + 6, '/')) {
+            return -1;
+        }
+        snprintf(addr->path, sizeof(addr->path), "/%s", uri + 6);
+        return 0;
+    }
+    return -1;
+}
+
+int transport_listen(const TransportAddr *addr, int backlog) {
+    int fd;
+    if (addr->kind == TRANSPORT_TCP) {
+        struct sockaddr_in address;
+        int opt = 1;
+        if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+            perror("socket() failed");
+            return -1;
+        }
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
+            perror("setsockopt() failed");
+            close(fd);
+            return -1;
+        }
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = inet_addr(addr->host);
+        address.sin_port = htons(addr->port);
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            perror("bind failed");
+            close(fd);
+            return -1;
+        }
+    } else if (addr->kind == TRANSPORT_UNIX) {
+        struct sockaddr_un address;
+        if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+            perror("socket() failed");
+            return -1;
+        }
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, addr->path);
+        unlink(addr->path);
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            perror("bind failed");
+            close(fd);
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+    if (listen(fd, backlog) < 0) {
+        perror("listen failed");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void channel_init(Channel *chan, int fd) {
+    chan->fd = fd;
+    chan->shm = NULL;
+    chan->shm_server = 0;
+}
+
+int channel_connect(Channel *chan, const char *uri) {
+    TransportAddr addr;
+    if (transport_parse(uri, &addr) < 0) {
+        fprintf(stderr, "Invalid address\n");
+        return -1;
+    }
+    if (addr.kind == TRANSPORT_SHM) {
+        return shm_connect(addr.path, chan);
+    }
+
+    int fd = socket(addr.kind == TRANSPORT_TCP ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Socket creation error\n");
+        return -1;
+    }
+    int result;
+    if (addr.kind == TRANSPORT_TCP) {
+        struct sockaddr_in serv_addr;
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_port = htons(addr.port);
+        if (inet_pton(AF_INET, addr.host, &serv_addr.sin_addr) <= 0) {
+            fprintf(stderr, "Invalid address\n");
+            close(fd);
+            return -1;
+        }
+        result = connect(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr));
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    } else {
+        struct sockaddr_un serv_addr;
+        memset(&serv_addr, 0, sizeof(serv_addr));
+        serv_addr.sun_family = AF_UNIX;
+        strcpy(serv_addr.sun_path, addr.path);
+        result = connect(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr));
+    }
+    if (result < 0) {
+        fprintf(stderr, "Connection failed\n");
+        close(fd);
+        return -1;
+    }
+    channel_init(chan, fd);
+    return 0;
+}
+
+ssize_t channel_recv(Channel *chan, void *data, size_t len) {
+    if (chan->shm) {
+        return shm_recv(chan->shm, chan->shm_server, data, len);
+    }
+    ssize_t n;
+    do {
+        n = recv(chan->fd, data, len, 0);
+    } while (n < 0 && errno == EINTR && !recv_interrupted);
+    return n;
+}
+
+ssize_t channel_recv_ts(Channel *chan, void *data, size_t len, long *arrival_us) {
+    struct timespec now;
+    if (chan->shm) {
+        ssize_t n = shm_recv(chan->shm, chan->shm_server, data, len);
+        clock_gettime(CLOCK_REALTIME, &now);
+        *arrival_us = now.tv_sec * 1000000L + now.tv_nsec / 1000;
+        return n;
+    }
+    struct iovec iov = {data, len};
+    char control[CMSG_SPACE(sizeof(struct timespec))];
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = recvmsg(chan->fd, &msg, 0);
+    } while (n < 0 && errno == EINTR && !recv_interrupted);
+    clock_gettime(CLOCK_REALTIME, &now);
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(&now, CMSG_DATA(cmsg), sizeof(now));
+        }
+    }
+    *arrival_us = now.tv_sec * 1000000L + now.tv_nsec / 1000;
+    return n;
+}
+
+ssize_t channel_send(Channel *chan, const void *data, size_t len) {
+    if (chan->shm) {
+        return shm_send(chan->shm, chan->shm_server, data, len);
+    }
+    ssize_t n;
+    do {
+        n = send(chan->fd, data, len, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+int channel_send_all(Channel *chan, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = channel_send(chan, p, len);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int channel_peer_alive(const Channel *chan) {
+    return !chan->shm || shm_peer_alive(chan->shm, chan->shm_server);
+}
+
+void channel_interrupt(void) {
+    recv_interrupted = 1;
+}
+
+void channel_shutdown(Channel *chan) {
+    if (chan->shm) {
+        shm_shutdown(chan->shm);
+    } else if (chan->fd >= 0) {
+        shutdown(chan->fd, SHUT_RDWR);
+    }
+}
+
+void channel_close(Channel *chan) {
+    if (chan->shm) {
+        shm_close(chan->shm, chan->shm_server);
+        chan->shm = NULL;
+    } else if (chan->fd >= 0) {
+        close(chan->fd);
+    }
+    chan->fd = -1;
+}
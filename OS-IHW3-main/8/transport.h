@@ -0,0 +1,42 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef enum {
+    TRANSPORT_TCP,
+    TRANSPORT_UNIX,
+    TRANSPORT_SHM
+} TransportKind;
+
+typedef struct {
+    TransportKind kind;
+    char host[64];
+    int port;
+    char path[108];
+} TransportAddr;
+
+struct ShmSlot;
+
+typedef struct {
+    int fd;
+    struct ShmSlot *shm;
+    int shm_server;
+} Channel;
+
+int transport_parse(const char *uri, TransportAddr *addr);
+int transport_listen(const TransportAddr *addr, int backlog);
+
+void channel_init(Channel *chan, int fd);
+int channel_connect(Channel *chan, const char *uri);
+ssize_t channel_recv(Channel *chan, void *data, size_t len);
+ssize_t channel_recv_ts(Channel *chan, void *data, size_t len, long *arrival_us);
+ssize_t channel_send(Channel *chan, const void *data, size_t len);
+int channel_send_all(Channel *chan, const void *data, size_t len);
+int channel_peer_alive(const Channel *chan);
+void channel_interrupt(void);
+void channel_shutdown(Channel *chan);
+void channel_close(Channel *chan);
+
+#endif
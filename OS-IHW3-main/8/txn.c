@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "txn.h"
+#include "mvcc.h"
+#include "checkpoint.h"
+
+#define SLOT_LOCKED 1u
+#define SLOT_SPIN 100
+#define GATE_SLOTS 64
+#define CACHE_LINE 64
+
+typedef struct {
+    unsigned long active;
+} __attribute__((aligned(CACHE_LINE))) GateSlot;
+
+typedef struct {
+    unsigned version;
+    unsigned waiters;
+} __attribute__((aligned(CACHE_LINE))) SlotVersion;
+
+static int *store;
+static size_t store_size;
+static SlotVersion *slot_versions;
+static GateSlot gate_slots[GATE_SLOTS];
+static unsigned gate_next;
+static __thread int gate_slot = -1;
+static int gate_closed;
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int txn_init(int *db, size_t size) {
+    store = db;
+    store_size = size;
+    if (posix_memalign((void **)&slot_versions, CACHE_LINE, size * sizeof(SlotVersion)) != 0) {
+        perror("txn_init malloc failed");
+        return -1;
+    }
+    memset(slot_versions, 0, size * sizeof(SlotVersion));
+    return 0;
+}
+
+static unsigned load_version(int index) {
+    return __atomic_load_n(&slot_versions[index].version, __ATOMIC_ACQUIRE);
+}
+
+static void wait_unlocked(int index, int *spins) {
+    SlotVersion *slot = &slot_versions[index];
+    if (++*spins < SLOT_SPIN) {
+        sched_yield();
+        return;
+    }
+    __atomic_add_fetch(&slot->waiters, 1, __ATOMIC_SEQ_CST);
+    unsigned version = __atomic_load_n(&slot->version, __ATOMIC_SEQ_CST);
+    if (version & SLOT_LOCKED) {
+        syscall(SYS_futex, &slot->version, FUTEX_WAIT_PRIVATE, version, NULL, NULL, 0);
+    }
+    __atomic_sub_fetch(&slot->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+static unsigned lock_slot(int index) {
+    int spins = 0;
+    while (1) {
+        unsigned version = load_version(index);
+        if (!(version & SLOT_LOCKED) &&
+            __atomic_compare_exchange_n(&slot_versions[index].version, &version, version | SLOT_LOCKED, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return version;
+        }
+        wait_unlocked(index, &spins);
+    }
+}
+
+static void unlock_slot(int index, unsigned version) {
+    SlotVersion *slot = &slot_versions[index];
+    __atomic_store_n(&slot->version, version, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&slot->waiters, __ATOMIC_SEQ_CST)) {
+        syscall(SYS_futex, &slot->version, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+static GateSlot *gate_enter(void) {
+    if (gate_slot < 0) {
+        gate_slot = __atomic_fetch_add(&gate_next, 1, __ATOMIC_RELAXED) % GATE_SLOTS;
+    }
+    GateSlot *slot = &gate_slots[gate_slot];
+    while (1) {
+        __atomic_add_fetch(&slot->active, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&gate_closed, __ATOMIC_SEQ_CST)) {
+            return slot;
+        }
+        __atomic_sub_fetch(&slot->active, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&gate_closed, __ATOMIC_ACQUIRE)) {
+            sched_yield();
+        }
+    }
+}
+
+static void gate_leave(GateSlot *slot) {
+    __atomic_sub_fetch(&slot->active, 1, __ATOMIC_RELEASE);
+}
+
+void txn_read_one(int index, int *value, unsigned *version) {
+    unsigned before, after;
+    int spins = 0;
+    do {
+        before = load_version(index);
+        if (before & SLOT_LOCKED) {
+            wait_unlocked(index, &spins);
+            continue;
+        }
+        *value = __atomic_load_n(&store[index], __ATOMIC_ACQUIRE);
+        after = load_version(index);
+    } while ((before & SLOT_LOCKED) || before != after);
+    *version = before;
+}
+
+void txn_save_versions(unsigned *versions) {
+    for (size_t i = 0; i < store_size; ++i) {
+        versions[i] = load_version(i);
+    }
+}
+
+void txn_load_versions(const unsigned *versions) {
+    for (size_t i = 0; i < store_size; ++i) {
+        __atomic_store_n(&slot_versions[i].version, versions[i], __ATOMIC_RELEASE);
+    }
+}
+
+void txn_begin(Txn *txn) {
+    txn->read_count = 0;
+    txn->write_count = 0;
+}
+
+int txn_read(Txn *txn, int index, int *value) {
+    for (int i = 0; i < txn->write_count; ++i) {
+        if (txn->writes[i].index == index) {
+            *value = txn->writes[i].value;
+            return 0;
+        }
+    }
+    unsigned before;
+    txn_read_one(index, value, &before);
+
+    for (int i = 0; i < txn->read_count; ++i) {
+        if (txn->reads[i].index == index) {
+            if (txn->reads[i].version != before) {
+                txn->reads[i].version = ~0u;
+            }
+            return 0;
+        }
+    }
+    if (txn->read_count == TXN_MAX_OPS) {
+        return -1;
+    }
+    txn->reads[txn->read_count].index = index;
+    txn->reads[txn->read_count].version = before;
+    ++txn->read_count;
+    return 0;
+}
+
+int txn_write(Txn *txn, int index, int value) {
+    for (int i = 0; i < txn->write_count; ++i) {
+        if (txn->writes[i].index == index) {
+            txn->writes[i].value = value;
+            return 0;
+        }
+    }
+    if (txn->write_count == TXN_MAX_OPS) {
+        return -1;
+    }
+    txn->writes[txn->write_count].index = index;
+    txn->writes[txn->write_count].value = value;
+    ++txn->write_count;
+    return 0;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return ((const TxnEntry *)a)->index - ((const TxnEntry *)b)->index;
+}
+
+static int is_written(const Txn *txn, int index) {
+    for (int i = 0; i < txn->write_count; ++i) {
+        if (txn->writes[i].index == index) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int commit_sorted(TxnEntry *writes, int count, const Txn *txn, Version *reserved, int *indices,
+                         int *values) {
+    GateSlot *gate = gate_enter();
+    for (int i = 0; i < count; ++i) {
+        writes[i].version = lock_slot(writes[i].index);
+    }
+    for (int i = 0; txn && i < txn->read_count; ++i) {
+        const TxnEntry *read = &txn->reads[i];
+        unsigned version = load_version(read->index);
+        if ((version & ~SLOT_LOCKED) != read->version ||
+            ((version & SLOT_LOCKED) && !is_written(txn, read->index))) {
+            for (int j = 0; j < count; ++j) {
+                unlock_slot(writes[j].index, writes[j].version);
+            }
+            gate_leave(gate);
+            mvcc_release(reserved);
+            return TXN_ABORTED;
+        }
+    }
+
+    unsigned long ts = mvcc_commit_begin();
+    for (int i = 0; i < count; ++i) {
+        TxnEntry *write = &writes[i];
+        write->old_value = store[write->index];
+        mvcc_install(&reserved, write->index, write->value, ts);
+        indices[i] = write->index;
+        values[i] = write->value;
+    }
+    checkpoint_log_batch(indices, values, count);
+    for (int i = 0; i < count; ++i) {
+        unlock_slot(writes[i].index, writes[i].version + 2);
+    }
+    mvcc_commit_end(ts);
+    gate_leave(gate);
+
+    for (int i = 0; i < count; ++i) {
+        mvcc_collect(writes[i].index);
+    }
+    return TXN_COMMITTED;
+}
+
+int txn_commit(Txn *txn) {
+    if (txn->write_count == 0) {
+        for (int i = 0; i < txn->read_count; ++i) {
+            if (load_version(txn->reads[i].index) != txn->reads[i].version) {
+                return TXN_ABORTED;
+            }
+        }
+        return TXN_COMMITTED;
+    }
+
+    Version *reserved = mvcc_reserve(txn->write_count);
+    if (!reserved) {
+        return -1;
+    }
+    qsort(txn->writes, txn->write_count, sizeof(TxnEntry), compare_entries);
+    int indices[TXN_MAX_OPS];
+    int values[TXN_MAX_OPS];
+    return commit_sorted(txn->writes, txn->write_count, txn, reserved, indices, values);
+}
+
+static void radix_sort(TxnEntry *entries, TxnEntry *scratch, int count) {
+    TxnEntry *from = entries, *to = scratch;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int offsets[257] = {0};
+        for (int i = 0; i < count; ++i) {
+            ++offsets[((unsigned)from[i].index >> shift & 0xff) + 1];
+        }
+        int skip = 0;
+        for (int digit = 1; digit <= 256; ++digit) {
+            skip |= offsets[digit] == count;
+            offsets[digit] += offsets[digit - 1];
+        }
+        if (skip) {
+            continue;
+        }
+        for (int i = 0; i < count; ++i) {
+            to[offsets[(unsigned)from[i].index >> shift & 0xff]++] = from[i];
+        }
+        TxnEntry *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != entries) {
+        memcpy(entries, from, sizeof(TxnEntry) * count);
+    }
+}
+
+int txn_bulk_write(TxnEntry *writes, int count) {
+    TxnEntry *scratch = malloc(sizeof(TxnEntry) * count);
+    int *indices = malloc(sizeof(int) * count);
+    int *values = malloc(sizeof(int) * count);
+    int unique = 0;
+    if (scratch && indices && values) {
+        radix_sort(writes, scratch, count);
+        for (int i = 0; i < count; ++i) {
+            if (i + 1 == count || writes[i + 1].index != writes[i].index) {
+                writes[unique++] = writes[i];
+            }
+        }
+    }
+    Version *reserved = unique > 0 ? mvcc_reserve(unique) : NULL;
+    int result = -1;
+    if (reserved) {
+        commit_sorted(writes, unique, NULL, reserved, indices, values);
+        result = unique;
+    }
+    free(scratch);
+    free(indices);
+    free(values);
+    return result;
+}
+
+int txn_write_one(int index, int value, int *old_value) {
+    Txn txn;
+    txn_begin(&txn);
+    txn_write(&txn, index, value);
+    int result = txn_commit(&txn);
+    *old_value = txn.writes[0].old_value;
+    return result;
+}
+
+int txn_cas_one(int index, int expected, int value, int *old_value) {
+    while (1) {
+        Txn txn;
+        txn_begin(&txn);
+        txn_read(&txn, index, old_value);
+        if (*old_value != expected) {
+            return TXN_ABORTED;
+        }
+        txn_write(&txn, index, value);
+        int result = txn_commit(&txn);
+        if (result != TXN_ABORTED) {
+            return result;
+        }
+    }
+}
+
+void txn_quiesce(void) {
+    pthread_mutex_lock(&gate_lock);
+    __atomic_store_n(&gate_closed, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < GATE_SLOTS; ++i) {
+        while (__atomic_load_n(&gate_slots[i].active, __ATOMIC_SEQ_CST) != 0) {
+            sched_yield();
+        }
+    }
+}
+
+void txn_resume(void) {
+    __atomic_store_n(&gate_closed, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&gate_lock);
+}
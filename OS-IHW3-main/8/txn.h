@@ -0,0 +1,41 @@
+#ifndef TXN_H
+#define TXN_H
+
+#include <stddef.h>
+
+#define TXN_MAX_OPS 64
+
+typedef struct {
+    int index;
+    int value;
+    int old_value;
+    unsigned version;
+} TxnEntry;
+
+typedef struct {
+    TxnEntry reads[TXN_MAX_OPS];
+    int read_count;
+    TxnEntry writes[TXN_MAX_OPS];
+    int write_count;
+} Txn;
+
+enum {
+    TXN_COMMITTED = 0,
+    TXN_ABORTED = 1
+};
+
+int txn_init(int *db, size_t size);
+void txn_begin(Txn *txn);
+int txn_read(Txn *txn, int index, int *value);
+int txn_write(Txn *txn, int index, int value);
+int txn_commit(Txn *txn);
+int txn_bulk_write(TxnEntry *writes, int count);
+int txn_write_one(int index, int value, int *old_value);
+int txn_cas_one(int index, int expected, int value, int *old_value);
+void txn_read_one(int index, int *value, unsigned *version);
+void txn_save_versions(unsigned *versions);
+void txn_load_versions(const unsigned *versions);
+void txn_quiesce(void);
+void txn_resume(void);
+
+#endif
@@ -0,0 +1,146 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "udpfan.h"
+#include "eventlog.h"
+
+#define UDP_MAX_OBSERVERS 4096
+#define UDP_MAX_DATAGRAMS (CONN_BUF_SIZE / (UDP_PAYLOAD_SIZE - CONN_MAX_FRAME - sizeof(UdpEventHeader)) + 2)
+#define UDP_BATCH 64
+
+typedef struct {
+    UdpEventHeader header;
+    char data[UDP_PAYLOAD_SIZE - sizeof(UdpEventHeader)];
+    size_t len;
+} Datagram;
+
+static int udp_fd = -1;
+static struct sockaddr_in endpoints[UDP_MAX_OBSERVERS];
+static int endpoint_count;
+static pthread_mutex_t endpoint_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int pack_datagrams(const FrameBuffer *events, unsigned long first_seq, Datagram *datagrams) {
+    int count = 0;
+    Datagram *current = NULL;
+    for (size_t pos = 0; pos < events->len;) {
+        int len;
+        memcpy(&len, events->data + pos, sizeof(int));
+        size_t frame_len = sizeof(int) + len;
+        if (!current || current->len + frame_len > sizeof(current->data)) {
+            current = &datagrams[count++];
+            current->header.first_seq = first_seq;
+            current->header.count = 0;
+            current->header.reserved = 0;
+            current->len = 0;
+        }
+        memcpy(current->data + current->len, events->data + pos, frame_len);
+        current->len += frame_len;
+        ++current->header.count;
+        ++first_seq;
+        pos += frame_len;
+    }
+    return count;
+}
+
+static void send_datagrams(const Datagram *datagrams, int datagram_count, const struct sockaddr_in *targets,
+                           int target_count) {
+    struct mmsghdr messages[UDP_BATCH];
+    struct iovec iovs[UDP_BATCH][2];
+    int batched = 0;
+    for (int t = 0; t < target_count; ++t) {
+        for (int d = 0; d < datagram_count; ++d) {
+            iovs[batched][0].iov_base = (void *)&datagrams[d].header;
+            iovs[batched][0].iov_len = sizeof(UdpEventHeader);
+            iovs[batched][1].iov_base = (void *)datagrams[d].data;
+            iovs[batched][1].iov_len = datagrams[d].len;
+            memset(&messages[batched], 0, sizeof(messages[batched]));
+            messages[batched].msg_hdr.msg_name = (void *)&targets[t];
+            messages[batched].msg_hdr.msg_namelen = sizeof(targets[t]);
+            messages[batched].msg_hdr.msg_iov = iovs[batched];
+            messages[batched].msg_hdr.msg_iovlen = 2;
+            if (++batched == UDP_BATCH) {
+                for (int sent = 0; sent < batched;) {
+                    int n = sendmmsg(udp_fd, messages + sent, batched - sent, 0);
+                    sent += n > 0 ? n : 1;
+                }
+                batched = 0;
+            }
+        }
+    }
+    for (int sent = 0; sent < batched;) {
+        int n = sendmmsg(udp_fd, messages + sent, batched - sent, 0);
+        sent += n > 0 ? n : 1;
+    }
+}
+
+static void *sender_thread(void *arg) {
+    static FrameBuffer events;
+    static Datagram datagrams[UDP_MAX_DATAGRAMS];
+    static struct sockaddr_in targets[UDP_MAX_OBSERVERS];
+    unsigned long cursor = eventlog_next();
+    while (1) {
+        events.len = 0;
+        int count = eventlog_read(&cursor, &events, EVENTS_TEXT);
+        if (count < 0) {
+            break;
+        }
+        int datagram_count = pack_datagrams(&events, cursor - count, datagrams);
+
+        pthread_mutex_lock(&endpoint_lock);
+        int target_count = endpoint_count;
+        memcpy(targets, endpoints, sizeof(struct sockaddr_in) * target_count);
+        pthread_mutex_unlock(&endpoint_lock);
+
+        send_datagrams(datagrams, datagram_count, targets, target_count);
+    }
+    return NULL;
+}
+
+int udpfan_start(void) {
+    udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_fd < 0) {
+        perror("UDP socket creation failed");
+        return -1;
+    }
+    int buffer_size = 4 << 20;
+    setsockopt(udp_fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, sender_thread, NULL) != 0) {
+        perror("thread create failed");
+        close(udp_fd);
+        udp_fd = -1;
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+int udpfan_register(const struct sockaddr_in *addr) {
+    if (udp_fd < 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&endpoint_lock);
+    if (endpoint_count == UDP_MAX_OBSERVERS) {
+        pthread_mutex_unlock(&endpoint_lock);
+        return -1;
+    }
+    endpoints[endpoint_count++] = *addr;
+    pthread_mutex_unlock(&endpoint_lock);
+    return 0;
+}
+
+void udpfan_unregister(const struct sockaddr_in *addr) {
+    pthread_mutex_lock(&endpoint_lock);
+    for (int i = 0; i < endpoint_count; ++i) {
+        if (endpoints[i].sin_addr.s_addr == addr->sin_addr.s_addr && endpoints[i].sin_port == addr->sin_port) {
+            endpoints[i] = endpoints[--endpoint_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&endpoint_lock);
+}
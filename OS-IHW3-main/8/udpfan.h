@@ -0,0 +1,19 @@
+#ifndef UDPFAN_H
+#define UDPFAN_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+#define UDP_PAYLOAD_SIZE 1400
+
+typedef struct {
+    uint64_t first_seq;
+    uint32_t count;
+    uint32_t reserved;
+} UdpEventHeader;
+
+int udpfan_start(void);
+int udpfan_register(const struct sockaddr_in *addr);
+void udpfan_unregister(const struct sockaddr_in *addr);
+
+#endif
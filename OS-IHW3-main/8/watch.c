@@ -0,0 +1,421 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#include "watch.h"
+#include "conn.h"
+#include "frame.h"
+#include "txn.h"
+
+#define WATCH_EPOLL_EVENTS 256
+#define WATCH_SHM_CHECK_MS 1000
+
+typedef enum {
+    WATCHER_PARKED,
+    WATCHER_WOKEN,
+    WATCHER_IDLE
+} WatcherState;
+
+typedef struct Watcher {
+    Channel chan;
+    int tag;
+    int index;
+    unsigned version;
+    WatcherState state;
+    size_t pending_len;
+    char *pending;
+    struct Watcher *prev;
+    struct Watcher *next;
+    struct Watcher *all_prev;
+    struct Watcher *all_next;
+} Watcher;
+
+static size_t watch_size;
+static WatchHooks watch_hooks;
+static Watcher **heads;
+static Watcher *woken;
+static Watcher *woken_tail;
+static Watcher *watchers;
+static long parked;
+static int epoll_fd = -1;
+static int event_fd = -1;
+static int stopping;
+static int stopped;
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t watch_cond = PTHREAD_COND_INITIALIZER;
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static void wake_thread(void) {
+    uint64_t one = 1;
+    if (write(event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("eventfd write failed");
+    }
+}
+
+static void link_index(Watcher *watcher) {
+    watcher->state = WATCHER_PARKED;
+    watcher->prev = NULL;
+    watcher->next = heads[watcher->index];
+    if (watcher->next) {
+        watcher->next->prev = watcher;
+    }
+    __atomic_store_n(&heads[watcher->index], watcher, __ATOMIC_SEQ_CST);
+    ++parked;
+}
+
+static void unlink_index(Watcher *watcher) {
+    if (watcher->prev) {
+        watcher->prev->next = watcher->next;
+    } else {
+        __atomic_store_n(&heads[watcher->index], watcher->next, __ATOMIC_RELAXED);
+    }
+    if (watcher->next) {
+        watcher->next->prev = watcher->prev;
+    }
+    --parked;
+}
+
+static void queue_woken(Watcher *watcher) {
+    watcher->state = WATCHER_WOKEN;
+    watcher->next = NULL;
+    if (woken_tail) {
+        woken_tail->next = watcher;
+    } else {
+        woken = watcher;
+    }
+    woken_tail = watcher;
+}
+
+static void park_locked(Watcher *watcher) {
+    link_index(watcher);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int value;
+    unsigned version;
+    txn_read_one(watcher->index, &value, &version);
+    if (version != watcher->version) {
+        unlink_index(watcher);
+        queue_woken(watcher);
+        wake_thread();
+    }
+}
+
+static void forget(Watcher *watcher) {
+    pthread_mutex_lock(&watch_lock);
+    if (watcher->all_prev) {
+        watcher->all_prev->all_next = watcher->all_next;
+    } else {
+        watchers = watcher->all_next;
+    }
+    if (watcher->all_next) {
+        watcher->all_next->all_prev = watcher->all_prev;
+    }
+    pthread_mutex_unlock(&watch_lock);
+    free(watcher->pending);
+    free(watcher);
+}
+
+static void drop_watcher(Watcher *watcher) {
+    watch_hooks.drop(&watcher->chan);
+    forget(watcher);
+}
+
+static void resume_watcher(Watcher *watcher, const char *pending, size_t len) {
+    if (!watcher->chan.shm) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, watcher->chan.fd, NULL);
+    }
+    watch_hooks.resume(&watcher->chan, watcher->tag, pending, len);
+    forget(watcher);
+}
+
+static void deliver(Watcher *watcher) {
+    int value;
+    unsigned version;
+    txn_read_one(watcher->index, &value, &version);
+    if (version == watcher->version) {
+        pthread_mutex_lock(&watch_lock);
+        park_locked(watcher);
+        pthread_mutex_unlock(&watch_lock);
+        return;
+    }
+    char reply[64];
+    snprintf(reply, sizeof(reply), "CHANGED %d %u", value, version);
+    if (send_frame(&watcher->chan, reply) < 0) {
+        drop_watcher(watcher);
+        return;
+    }
+    if (watcher->chan.shm || watcher->pending_len > 0) {
+        resume_watcher(watcher, watcher->pending, watcher->pending_len);
+        return;
+    }
+    pthread_mutex_lock(&watch_lock);
+    watcher->state = WATCHER_IDLE;
+    pthread_mutex_unlock(&watch_lock);
+    struct epoll_event event = {EPOLLIN | EPOLLRDHUP, {.ptr = watcher}};
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, watcher->chan.fd, &event);
+}
+
+static void rewatch(Watcher *watcher, const char *request, size_t len) {
+    if (len > sizeof(int)) {
+        int frame_len;
+        char text[CONN_MAX_FRAME];
+        memcpy(&frame_len, request, sizeof(int));
+        if (frame_len > 0 && frame_len < CONN_MAX_FRAME && sizeof(int) + frame_len == len) {
+            memcpy(text, request + sizeof(int), frame_len);
+            text[frame_len] = '\0';
+            int index;
+            unsigned version;
+            int mode = watch_parse(text, &index, &version);
+            if (mode >= 0) {
+                int value;
+                if (mode == WATCH_NEXT) {
+                    txn_read_one(index, &value, &version);
+                }
+                watcher->index = index;
+                watcher->version = version;
+                struct epoll_event event = {EPOLLRDHUP, {.ptr = watcher}};
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, watcher->chan.fd, &event);
+                pthread_mutex_lock(&watch_lock);
+                park_locked(watcher);
+                pthread_mutex_unlock(&watch_lock);
+                return;
+            }
+        }
+    }
+    resume_watcher(watcher, request, len);
+}
+
+static void handle_ready(Watcher *watcher) {
+    pthread_mutex_lock(&watch_lock);
+    WatcherState state = watcher->state;
+    if (state == WATCHER_PARKED) {
+        unlink_index(watcher);
+    }
+    pthread_mutex_unlock(&watch_lock);
+    if (state == WATCHER_PARKED) {
+        drop_watcher(watcher);
+        return;
+    }
+    if (state != WATCHER_IDLE) {
+        return;
+    }
+    char buffer[CONN_BUF_SIZE];
+    ssize_t n = recv(watcher->chan.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (n <= 0) {
+        drop_watcher(watcher);
+        return;
+    }
+    rewatch(watcher, buffer, n);
+}
+
+static void drop_dead_shm(void) {
+    Watcher *dead = NULL;
+    pthread_mutex_lock(&watch_lock);
+    for (Watcher *watcher = watchers; watcher; watcher = watcher->all_next) {
+        if (watcher->chan.shm && watcher->state == WATCHER_PARKED && !channel_peer_alive(&watcher->chan)) {
+            unlink_index(watcher);
+            watcher->state = WATCHER_IDLE;
+            watcher->next = dead;
+            dead = watcher;
+        }
+    }
+    pthread_mutex_unlock(&watch_lock);
+    while (dead) {
+        Watcher *next = dead->next;
+        drop_watcher(dead);
+        dead = next;
+    }
+}
+
+static void deliver_woken(void) {
+    pthread_mutex_lock(&watch_lock);
+    Watcher *watcher = woken;
+    woken = NULL;
+    woken_tail = NULL;
+    pthread_mutex_unlock(&watch_lock);
+    while (watcher) {
+        Watcher *next = watcher->next;
+        deliver(watcher);
+        watcher = next;
+    }
+}
+
+static void *watch_loop(void *arg) {
+    struct epoll_event events[WATCH_EPOLL_EVENTS];
+    long checked_ms = now_ms();
+    while (1) {
+        int n = epoll_wait(epoll_fd, events, WATCH_EPOLL_EVENTS, WATCH_SHM_CHECK_MS);
+        pthread_mutex_lock(&watch_lock);
+        if (stopping) {
+            stopped = 1;
+            pthread_cond_broadcast(&watch_cond);
+            pthread_mutex_unlock(&watch_lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&watch_lock);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr) {
+                handle_ready(events[i].data.ptr);
+            } else {
+                uint64_t count;
+                if (read(event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                    perror("eventfd read failed");
+                }
+            }
+        }
+        deliver_woken();
+        long now = now_ms();
+        if (now - checked_ms >= WATCH_SHM_CHECK_MS) {
+            drop_dead_shm();
+            checked_ms = now;
+        }
+    }
+    return NULL;
+}
+
+int watch_init(size_t size, const WatchHooks *hooks) {
+    watch_size = size;
+    watch_hooks = *hooks;
+    heads = calloc(size, sizeof(Watcher *));
+    if (!heads) {
+        perror("malloc failed");
+        return -1;
+    }
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event event = {EPOLLIN, {.ptr = NULL}};
+    if (epoll_fd < 0 || event_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event) < 0) {
+        perror("watch setup failed");
+        return -1;
+    }
+    pthread_t watch_tid;
+    if (pthread_create(&watch_tid, NULL, watch_loop, NULL) != 0) {
+        perror("thread create failed");
+        return -1;
+    }
+    pthread_detach(watch_tid);
+    return 0;
+}
+
+int watch_parse(const char *request, int *index, unsigned *version) {
+    if (strncmp(request, "WATCH", 5) != 0) {
+        return -1;
+    }
+    char *end;
+    long parsed_index = strtol(request + 5, &end, 10);
+    if (end == request + 5 || parsed_index < 0 || (size_t)parsed_index >= watch_size) {
+        return -1;
+    }
+    *index = parsed_index;
+    const char *rest = end;
+    unsigned long parsed_version = strtoul(rest, &end, 10);
+    if (end == rest) {
+        return WATCH_NEXT;
+    }
+    *version = parsed_version;
+    return WATCH_SINCE;
+}
+
+int watch_park(const Channel *chan, int tag, int index, unsigned version, const char *pending, size_t len) {
+    Watcher *watcher = calloc(1, sizeof(Watcher));
+    if (!watcher || (len > 0 && !(watcher->pending = malloc(len)))) {
+        perror("malloc failed");
+        free(watcher);
+        return -1;
+    }
+    if (len > 0) {
+        memcpy(watcher->pending, pending, len);
+    }
+    watcher->pending_len = len;
+    watcher->chan = *chan;
+    watcher->tag = tag;
+    watcher->index = index;
+    watcher->version = version;
+
+    pthread_mutex_lock(&watch_lock);
+    struct epoll_event event = {EPOLLRDHUP, {.ptr = watcher}};
+    if (!chan->shm && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, chan->fd, &event) < 0) {
+        pthread_mutex_unlock(&watch_lock);
+        perror("epoll_ctl() failed");
+        free(watcher->pending);
+        free(watcher);
+        return -1;
+    }
+    watcher->all_next = watchers;
+    if (watchers) {
+        watchers->all_prev = watcher;
+    }
+    watchers = watcher;
+    park_locked(watcher);
+    pthread_mutex_unlock(&watch_lock);
+    return 0;
+}
+
+void watch_written(int index) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&heads[index], __ATOMIC_RELAXED)) {
+        return;
+    }
+    pthread_mutex_lock(&watch_lock);
+    Watcher *watcher = heads[index];
+    __atomic_store_n(&heads[index], NULL, __ATOMIC_RELAXED);
+    while (watcher) {
+        Watcher *next = watcher->next;
+        queue_woken(watcher);
+        --parked;
+        watcher = next;
+    }
+    pthread_mutex_unlock(&watch_lock);
+    wake_thread();
+}
+
+long watch_count(void) {
+    pthread_mutex_lock(&watch_lock);
+    long count = parked;
+    pthread_mutex_unlock(&watch_lock);
+    return count;
+}
+
+void watch_stop(void) {
+    pthread_mutex_lock(&watch_lock);
+    stopping = 1;
+    wake_thread();
+    while (!stopped) {
+        pthread_cond_wait(&watch_cond, &watch_lock);
+    }
+    pthread_mutex_unlock(&watch_lock);
+}
+
+int watch_drain(int (*visit)(Channel *chan, int tag, const char *request, const char *pending, size_t len, void *arg),
+                void *arg) {
+    int count = 0;
+    pthread_mutex_lock(&watch_lock);
+    for (Watcher *watcher = watchers; watcher; watcher = watcher->all_next, ++count) {
+        char request[64] = "";
+        if (watcher->state != WATCHER_IDLE) {
+            snprintf(request, sizeof(request), "WATCH %d %u", watcher->index, watcher->version);
+        }
+        if (visit(&watcher->chan, watcher->tag, request, watcher->pending, watcher->pending_len, arg) < 0) {
+            count = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&watch_lock);
+    return count;
+}
@@ -0,0 +1,27 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stddef.h>
+
+#include "transport.h"
+
+typedef struct {
+    void (*resume)(const Channel *chan, int tag, const char *pending, size_t len);
+    void (*drop)(Channel *chan);
+} WatchHooks;
+
+enum {
+    WATCH_NEXT = 0,
+    WATCH_SINCE = 1
+};
+
+int watch_init(size_t size, const WatchHooks *hooks);
+int watch_parse(const char *request, int *index, unsigned *version);
+int watch_park(const Channel *chan, int tag, int index, unsigned version, const char *pending, size_t len);
+void watch_written(int index);
+long watch_count(void);
+void watch_stop(void);
+int watch_drain(int (*visit)(Channel *chan, int tag, const char *request, const char *pending, size_t len, void *arg),
+                void *arg);
+
+#endif
@@ -1,64 +1,33 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <getopt.h>
+
+#include "dbclient.h"
+#include "log.h"
+#include "affinity.h"
 
 #define ARRAY_SIZE 10
 
+#define WRITERS_PER_CONNECTION 4
+#define REQUEST_TIMEOUT_MS 5000
+
 typedef struct {
     int id;
-    const char* server_ip;
-    int port;
+    DbClient *client;
 } WriterData;
 
 sem_t rand_sem;
 
-void signal_handler(int signal) {
-    printf("Caught signal %d, terminating writer clients...\n", signal);
-    sem_destroy(&rand_sem);
-    exit(0);
-}
-
 void* write_process(void* arg) {
     WriterData* args = (WriterData*)arg;
     int id = args->id;
-    const char* server_ip = args->server_ip;
-    int port = args->port;
-
-    int sock = 0;
-    struct sockaddr_in serv_addr;
-    char buffer[1024] = {0};
-    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        fprintf(stderr, "Socket creation error\n");
-        return NULL;
-    }
-
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
-    if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0) {
-        fprintf(stderr, "Invalid address\n");
-        close(sock);
-        return NULL;
-    }
-    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        fprintf(stderr, "Connection failed\n");
-        close(sock);
-        return NULL;
-    }
-
-    const char *handshake_message = "WRITER";
-    if (send(sock, handshake_message, strlen(handshake_message), 0) == -1) {
-        perror("send() failed");
-        close(sock);
-        return NULL;
-    }
 
     while (1) {
         sleep(1 + rand() % 5);
@@ -66,94 +35,124 @@ void* write_process(void* arg) {
         int index = rand() % ARRAY_SIZE;
         int new_value = rand() % 40;
         sem_post(&rand_sem);
-        char request[1024];
-        sprintf(request, "READ %d", index);
-        int request_len = strlen(request);
-        if (send(sock, &request_len, sizeof(request_len), 0) != sizeof(request_len)) {
-            fprintf(stderr, "Error sending request length\n");
-            break;
-        }
-        if (send(sock, request, request_len, 0) != request_len) {
-            fprintf(stderr, "Error sending request\n");
-            break;
-        }
 
-        memset(buffer, 0, sizeof(buffer));
-        int valread = read(sock, buffer, sizeof(buffer) - 1);
-        if (valread > 0) {
-            buffer[valread] = '\0';
-            if (strstr(buffer, "VALUE") == buffer) {
-                int old_value = atoi(buffer + 6);
-                sprintf(request, "WRITE %d %d", index, new_value);
-                request_len = strlen(request);
-                if (send(sock, &request_len, sizeof(request_len), 0) != sizeof(request_len)) {
-                    fprintf(stderr, "Error sending request length\n");
-                    break;
-                }
-                if (send(sock, request, request_len, 0) != request_len) {
-                    fprintf(stderr, "Error sending request\n");
-                    break;
-                }
-                memset(buffer, 0, sizeof(buffer));
-                valread = read(sock, buffer, sizeof(buffer) - 1);
-                if (valread > 0) {
-                    buffer[valread] = '\0';
-                    if (strncmp(buffer, "UPDATED FROM", 12) == 0) {
-                        int server_old_value, server_new_value;
-                        sscanf(buffer, "UPDATED FROM %d TO %d", &server_old_value, &server_new_value);
-                        printf("Writer[%d]: updated DB[%d] from %d to %d\n", id, index, server_old_value, server_new_value);
-                    }
-                } else {
-                    fprintf(stderr, "Read error\n");
-                    break;
-                }
-            }
+        int value, old_value;
+        int status = db_read(args->client, index, &value, REQUEST_TIMEOUT_MS);
+        if (status == DB_OK) {
+            status = db_write(args->client, index, new_value, &old_value, REQUEST_TIMEOUT_MS);
+        }
+        if (status == DB_OK) {
+            log_write(LOG_INFO, "Writer[%d]: updated DB[%d] from %d to %d\n", id, index, old_value, new_value);
+        } else if (status == DB_BUSY || status == DB_TIMEOUT) {
+            log_write(LOG_INFO, "Writer[%d]: server busy, skipping request\n", id);
         } else {
-            fprintf(stderr, "Read error\n");
-            break;
+            log_write(LOG_WARN, "Writer[%d]: request failed, will retry\n", id);
         }
     }
-
-    close(sock);
     return NULL;
 }
 
 int main(int argc, char const *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <server_ip> <port> <num_writers>\n", argv[0]);
+    DbRetryPolicy retry = {DB_MAX_RETRIES, DB_BACKOFF_MIN_MS, DB_BACKOFF_MAX_MS, DB_RETRY_BUDGET,
+                           DB_RETRY_BUDGET_PERCENT, 1};
+    char role[64] = "WRITER";
+    int log_mode = LOG_ASYNC;
+    int log_level = LOG_INFO;
+    static struct option options[] = {
+        {"cpus", required_argument, NULL, 'c'},
+        {"retries", required_argument, NULL, 'r'},
+        {"retry-budget", required_argument, NULL, 'b'},
+        {"qos", required_argument, NULL, 'q'},
+        {"log", required_argument, NULL, 'o'},
+        {"log-level", required_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt_char;
+    while ((opt_char = getopt_long(argc, (char *const *)argv, "c:r:b:q:o:v:", options, NULL)) != -1) {
+        cpu_set_t cpus;
+        switch (opt_char) {
+            case 'c':
+                if (cpuset_parse(optarg, &cpus) < 0 || affinity_pin_process(&cpus) < 0) {
+                    argc = 0;
+                }
+                break;
+            case 'r':
+                retry.max_retries = atoi(optarg);
+                break;
+            case 'b':
+                retry.retry_budget = atoi(optarg);
+                break;
+            case 'q':
+                snprintf(role, sizeof(role), "WRITER QOS %s", optarg);
+                break;
+            case 'o':
+                if ((log_mode = log_parse_mode(optarg)) < 0) {
+                    argc = 0;
+                }
+                break;
+            case 'v':
+                if ((log_level = log_parse_level(optarg)) < 0) {
+                    argc = 0;
+                }
+                break;
+            default:
+                argc = 0;
+        }
+    }
+    int positional = argc - optind;
+    if (positional != 2 && positional != 3) {
+        fprintf(stderr,
+                "Usage: %s <server_ip> <port> <num_writers> [--cpus <list>] [--retries <n>] [--retry-budget <n>] "
+                "[--qos <class>] [--log sync|async|binary] [--log-level <level>]\n"
+                "       %s <uri> <num_writers> [--cpus <list>] [--retries <n>] [--retry-budget <n>] [--qos <class>]\n"
+                "       [--log sync|async|binary] [--log-level <level>]\n",
+                argv[0], argv[0]);
         return -1;
     }
 
-    const char* server_ip = argv[1];
-    int port = atoi(argv[2]);
-    int K = atoi(argv[3]);
+    char uri[256];
+    if (positional == 3) {
+        snprintf(uri, sizeof(uri), "tcp://%s:%s", argv[optind], argv[optind + 1]);
+    } else {
+        snprintf(uri, sizeof(uri), "%s", argv[optind]);
+    }
+    int K = atoi(argv[argc - 1]);
 
     srand(time(NULL));
 
-    signal(SIGINT, signal_handler);
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    log_init(log_mode, log_level);
 
     if (sem_init(&rand_sem, 0, 1) != 0) {
         perror("sem_init() failed");
         return -1;
     }
 
+    DbClient *client = db_client_open(uri, role, (K + WRITERS_PER_CONNECTION - 1) / WRITERS_PER_CONNECTION);
+    if (!client) {
+        sem_destroy(&rand_sem);
+        return -1;
+    }
+    db_client_set_retry(client, &retry);
+
     pthread_t writers[K];
     WriterData writer_args[K];
     for (int i = 0; i < K; ++i) {
         writer_args[i].id = i + 1;
-        writer_args[i].server_ip = server_ip;
-        writer_args[i].port = port;
+        writer_args[i].client = client;
         if (pthread_create(&writers[i], NULL, write_process, &writer_args[i]) != 0) {
             fprintf(stderr, "Error creating writer thread\n");
+            db_client_close(client);
             sem_destroy(&rand_sem);
             return -1;
         }
     }
 
-    for (int i = 0; i < K; ++i) {
-        pthread_join(writers[i], NULL);
-    }
-
-    sem_destroy(&rand_sem);
-    return 0;
+    int caught;
+    sigwait(&stop_signals, &caught);
+    log_write(LOG_INFO, "Caught signal %d, terminating writer clients...\n", caught);
+    exit(0);
 }
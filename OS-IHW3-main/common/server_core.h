@@ -0,0 +1,632 @@
+#ifndef SERVER_CORE_H
+#define SERVER_CORE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+#define LOCKING_MUTEX 1
+#define LOCKING_RWLOCK 2
+
+#ifndef SERVER_OBSERVERS
+#define SERVER_OBSERVERS 1
+#endif
+#ifndef SERVER_HANDSHAKE
+#define SERVER_HANDSHAKE SERVER_OBSERVERS
+#endif
+#ifndef SERVER_DETAILED_REPLIES
+#define SERVER_DETAILED_REPLIES SERVER_OBSERVERS
+#endif
+#ifndef SERVER_LOCKING
+#define SERVER_LOCKING LOCKING_MUTEX
+#endif
+
+#if SERVER_OBSERVERS && !SERVER_HANDSHAKE
+#error "observers register through the handshake"
+#endif
+
+#define ARRAY_SIZE 10
+#define MAX_CLIENTS 5
+#define MAX_WORKERS 64
+
+typedef struct {
+    int db[ARRAY_SIZE];
+#if SERVER_LOCKING == LOCKING_RWLOCK
+    pthread_rwlock_t db_lock;
+#else
+    pthread_mutex_t db_mutex;
+    pthread_mutex_t writer_mutex;
+#endif
+#if SERVER_OBSERVERS
+    int observer_count;
+#endif
+} SharedState;
+
+static SharedState *shared;
+static int server_fd;
+static pid_t worker_pids[MAX_WORKERS];
+static int worker_count;
+
+#if SERVER_LOCKING == LOCKING_RWLOCK
+static int db_lock_init(void) {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    int rc = pthread_rwlock_init(&shared->db_lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    if (rc != 0) {
+        fprintf(stderr, "pthread_rwlock_init() failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void db_lock_destroy(void) {
+    pthread_rwlock_destroy(&shared->db_lock);
+}
+
+static void db_read_lock(void) {
+    pthread_rwlock_rdlock(&shared->db_lock);
+}
+
+static void db_read_unlock(void) {
+    pthread_rwlock_unlock(&shared->db_lock);
+}
+
+static void db_write_lock(void) {
+    pthread_rwlock_wrlock(&shared->db_lock);
+}
+
+static void db_write_unlock(void) {
+    pthread_rwlock_unlock(&shared->db_lock);
+}
+#elif SERVER_LOCKING == LOCKING_MUTEX
+static int robust_mutex_init(pthread_mutex_t *lock) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int rc = pthread_mutex_init(lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return rc;
+}
+
+static int db_lock_init(void) {
+    if (robust_mutex_init(&shared->db_mutex) != 0) {
+        fprintf(stderr, "pthread_mutex_init() db failed\n");
+        return -1;
+    }
+    if (robust_mutex_init(&shared->writer_mutex) != 0) {
+        fprintf(stderr, "pthread_mutex_init() writer failed\n");
+        pthread_mutex_destroy(&shared->db_mutex);
+        return -1;
+    }
+    return 0;
+}
+
+static void db_lock_destroy(void) {
+    pthread_mutex_destroy(&shared->db_mutex);
+    pthread_mutex_destroy(&shared->writer_mutex);
+}
+
+static void robust_lock(pthread_mutex_t *lock) {
+    if (pthread_mutex_lock(lock) == EOWNERDEAD) {
+        fprintf(stderr, "Lock owner died, recovering the lock\n");
+        pthread_mutex_consistent(lock);
+    }
+}
+
+static void db_read_lock(void) {
+    robust_lock(&shared->db_mutex);
+}
+
+static void db_read_unlock(void) {
+    pthread_mutex_unlock(&shared->db_mutex);
+}
+
+static void db_write_lock(void) {
+    robust_lock(&shared->writer_mutex);
+    robust_lock(&shared->db_mutex);
+}
+
+static void db_write_unlock(void) {
+    pthread_mutex_unlock(&shared->db_mutex);
+    pthread_mutex_unlock(&shared->writer_mutex);
+}
+#else
+#error "unknown SERVER_LOCKING"
+#endif
+
+#if SERVER_OBSERVERS
+static int monitor_clients[MAX_CLIENTS];
+static sem_t observer_sem;
+static int relay_sockets[2] = {-1, -1};
+static int relay_fd = -1;
+
+static int observers_init(void) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        monitor_clients[i] = -1;
+    }
+    if (sem_init(&observer_sem, 0, 1) != 0) {
+        perror("sem_init() observer failed");
+        return -1;
+    }
+    return 0;
+}
+
+static void observers_destroy(void) {
+    sem_destroy(&observer_sem);
+}
+
+static int add_observer(int sock) {
+    int added = 0;
+    sem_wait(&observer_sem);
+    for (int i = 0; i < MAX_CLIENTS && !added; ++i) {
+        if (monitor_clients[i] == -1) {
+            monitor_clients[i] = sock;
+            __atomic_add_fetch(&shared->observer_count, 1, __ATOMIC_RELAXED);
+            added = 1;
+        }
+    }
+    sem_post(&observer_sem);
+    return added ? 0 : -1;
+}
+
+static void notify_observers(const char *message, int len) {
+    sem_wait(&observer_sem);
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (monitor_clients[i] != -1 && send(monitor_clients[i], message, len, MSG_NOSIGNAL) < 0) {
+            close(monitor_clients[i]);
+            monitor_clients[i] = -1;
+            __atomic_sub_fetch(&shared->observer_count, 1, __ATOMIC_RELAXED);
+        }
+    }
+    sem_post(&observer_sem);
+}
+
+static int register_observer(int sock) {
+    if (relay_fd < 0) {
+        return add_observer(sock);
+    }
+    char marker = 'O';
+    char control[CMSG_SPACE(sizeof(int))] = {0};
+    struct iovec iov = {&marker, sizeof(marker)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &sock, sizeof(int));
+    int rc = sendmsg(relay_fd, &msg, 0) < 0 ? -1 : 0;
+    if (rc == 0) {
+        close(sock);
+    }
+    return rc;
+}
+
+static void publish(const char *message, int len) {
+    if (relay_fd < 0) {
+        notify_observers(message, len);
+    } else {
+        send(relay_fd, message, len, MSG_DONTWAIT);
+    }
+}
+
+static void relay_receive(void) {
+    char message[1024];
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = {message, sizeof(message)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t len = recvmsg(relay_sockets[0], &msg, MSG_DONTWAIT);
+    if (len < 0) {
+        if (errno != EINTR && errno != EAGAIN) {
+            perror("recvmsg() failed");
+        }
+        return;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        int observer;
+        memcpy(&observer, CMSG_DATA(cmsg), sizeof(int));
+        if (add_observer(observer) < 0) {
+            fprintf(stderr, "Too many observers\n");
+            close(observer);
+        }
+    } else {
+        notify_observers(message, len);
+    }
+}
+
+static int relay_open(void) {
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, relay_sockets) < 0) {
+        perror("socketpair() failed");
+        return -1;
+    }
+    return 0;
+}
+
+static int relay_poll_fd(void) {
+    return relay_sockets[0];
+}
+
+static void relay_attach(void) {
+    close(relay_sockets[0]);
+    relay_sockets[0] = -1;
+    relay_fd = relay_sockets[1];
+}
+
+#define notifyf(...)                                                           \
+    do {                                                                       \
+        if (__atomic_load_n(&shared->observer_count, __ATOMIC_RELAXED) > 0) {  \
+            char notification[1024];                                           \
+            int len = snprintf(notification, sizeof(notification), __VA_ARGS__); \
+            publish(notification, len);                                        \
+        }                                                                      \
+    } while (0)
+#else
+static int observers_init(void) {
+    return 0;
+}
+
+static void observers_destroy(void) {
+}
+
+static void relay_receive(void) {
+}
+
+static int relay_open(void) {
+    return 0;
+}
+
+static int relay_poll_fd(void) {
+    return -1;
+}
+
+static void relay_attach(void) {
+}
+
+#define notifyf(...) ((void)0)
+#endif
+
+static void init_db(void) {
+    for (int i = 1; i < ARRAY_SIZE + 1; ++i) {
+        shared->db[i - 1] = i;
+    }
+}
+
+static int read_full(int sock, char *buffer, int len) {
+    int result = 0;
+    while (result < len) {
+        int part = read(sock, buffer + result, len - result);
+        if (part <= 0) {
+            return -1;
+        }
+        result += part;
+    }
+    return 0;
+}
+
+static void reply(int sock, const char *response, int len) {
+    send(sock, response, len, MSG_NOSIGNAL);
+}
+
+static void handle_request(int sock, const char *request) {
+    char response[64];
+    if (strncmp(request, "READ", 4) == 0) {
+        int index = atoi(request + 5);
+        if (index < 0 || index >= ARRAY_SIZE) {
+            reply(sock, "ERROR", 5);
+            return;
+        }
+        db_read_lock();
+        int value = shared->db[index];
+        db_read_unlock();
+        reply(sock, response, snprintf(response, sizeof(response), "VALUE %d", value));
+        notifyf("read value %d from index  %d", value, index);
+    } else if (strncmp(request, "WRITE", 5) == 0) {
+        int index, new_value;
+        if (sscanf(request + 6, "%d %d", &index, &new_value) != 2 || index < 0 || index >= ARRAY_SIZE) {
+            reply(sock, "ERROR", 5);
+            return;
+        }
+        db_write_lock();
+        int old_value = shared->db[index];
+        shared->db[index] = new_value;
+        db_write_unlock();
+#if SERVER_DETAILED_REPLIES
+        reply(sock, response, snprintf(response, sizeof(response), "UPDATED FROM %d TO %d", old_value, new_value));
+#else
+        (void)old_value;
+        reply(sock, "UPDATED", 7);
+#endif
+        notifyf("DB[%d] updated to %d (old value %d)", index, new_value, old_value);
+    }
+}
+
+static void *handle_client(void *arg) {
+    int client_socket = *(int *)arg;
+    free(arg);
+
+#if SERVER_HANDSHAKE
+    char handshake_message[50];
+    int bytes_received = recv(client_socket, handshake_message, sizeof(handshake_message) - 1, 0);
+    if (bytes_received <= 0) {
+        perror("Error receiving handshake message");
+        close(client_socket);
+        return NULL;
+    }
+    handshake_message[bytes_received] = '\0';
+#if SERVER_OBSERVERS
+    if (strcmp(handshake_message, "OBSERVER") == 0) {
+        if (register_observer(client_socket) < 0) {
+            fprintf(stderr, "Too many observers\n");
+            close(client_socket);
+        }
+        return NULL;
+    }
+#endif
+#endif
+
+    char buffer[1024];
+    while (1) {
+        int msg_len;
+        if (read(client_socket, &msg_len, sizeof(msg_len)) <= 0) {
+            break;
+        }
+        if (msg_len <= 0 || msg_len >= (int)sizeof(buffer)) {
+            fprintf(stderr, "Invalid message length\n");
+            break;
+        }
+        if (read_full(client_socket, buffer, msg_len) < 0) {
+            break;
+        }
+        buffer[msg_len] = '\0';
+        handle_request(client_socket, buffer);
+    }
+    close(client_socket);
+    printf("Client disconnected.\n");
+    notifyf("Client disconnected");
+    return NULL;
+}
+
+static void stop_workers(void) {
+    for (int i = 0; i < worker_count; ++i) {
+        if (worker_pids[i] > 0) {
+            kill(worker_pids[i], SIGTERM);
+        }
+    }
+}
+
+static void signal_handler(int signal) {
+    printf("Caught signal %d, terminating server...\n", signal);
+    stop_workers();
+    close(server_fd);
+    db_lock_destroy();
+    observers_destroy();
+    exit(0);
+}
+
+static void serve(void) {
+    struct sockaddr_in address;
+    socklen_t addrlen = sizeof(address);
+    while (1) {
+        int *client_socket_ptr = (int *)malloc(sizeof(int));
+        if (!client_socket_ptr) {
+            perror("malloc failed");
+            break;
+        }
+
+        if ((*client_socket_ptr = accept(server_fd, (struct sockaddr *)&address, &addrlen)) < 0) {
+            perror("accept() failed");
+            free(client_socket_ptr);
+            break;
+        }
+        printf("Client connected successfully.\n");
+        notifyf("Client connected");
+
+        pthread_t client_thread;
+        if (pthread_create(&client_thread, NULL, handle_client, client_socket_ptr) != 0) {
+            perror("pthread_create failed");
+            close(*client_socket_ptr);
+            free(client_socket_ptr);
+            break;
+        }
+        pthread_detach(client_thread);
+    }
+}
+
+static pid_t spawn_worker(const sigset_t *signals, int signal_fd) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork() failed");
+        return -1;
+    }
+    if (pid == 0) {
+        worker_count = 0;
+        close(signal_fd);
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        signal(SIGINT, SIG_IGN);
+        signal(SIGTERM, SIG_DFL);
+        sigprocmask(SIG_UNBLOCK, signals, NULL);
+        relay_attach();
+        serve();
+        exit(EXIT_FAILURE);
+    }
+    printf("Worker started (pid %d)\n", pid);
+    return pid;
+}
+
+static int restart_workers(const sigset_t *signals, int signal_fd) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < worker_count; ++i) {
+            if (worker_pids[i] == pid) {
+                printf("Worker %d exited, restarting\n", pid);
+                if ((worker_pids[i] = spawn_worker(signals, signal_fd)) < 0) {
+                    return -1;
+                }
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+static int supervise(int workers) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    int signal_fd = signalfd(-1, &signals, 0);
+    if (signal_fd < 0) {
+        perror("signalfd() failed");
+        return EXIT_FAILURE;
+    }
+    if (relay_open() < 0) {
+        close(signal_fd);
+        return EXIT_FAILURE;
+    }
+    int rc = EXIT_FAILURE;
+    for (worker_count = 0; worker_count < workers; ++worker_count) {
+        if ((worker_pids[worker_count] = spawn_worker(&signals, signal_fd)) < 0) {
+            stop_workers();
+            close(signal_fd);
+            return rc;
+        }
+    }
+    struct pollfd fds[2] = {{signal_fd, POLLIN, 0}, {relay_poll_fd(), POLLIN, 0}};
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll() failed");
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            relay_receive();
+        }
+        struct signalfd_siginfo info;
+        if (!(fds[0].revents & POLLIN) || read(signal_fd, &info, sizeof(info)) != sizeof(info)) {
+            continue;
+        }
+        if (info.ssi_signo != SIGCHLD) {
+            printf("Caught signal %d, terminating server...\n", (int)info.ssi_signo);
+            rc = 0;
+            break;
+        }
+        if (restart_workers(&signals, signal_fd) < 0) {
+            break;
+        }
+    }
+    stop_workers();
+    close(signal_fd);
+    return rc;
+}
+
+static int server_run(int argc, char const *argv[]) {
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "Usage: %s <IP> <PORT> [WORKERS]\n", argv[0]);
+        return -1;
+    }
+
+    const char *server_ip = argv[1];
+    int port = atoi(argv[2]);
+    int workers = argc == 4 ? atoi(argv[3]) : 0;
+    if (workers < 0 || workers > MAX_WORKERS) {
+        fprintf(stderr, "Invalid number of workers\n");
+        return -1;
+    }
+#if SERVER_LOCKING == LOCKING_RWLOCK
+    if (workers > 0) {
+        fprintf(stderr, "Workers need robust locks, rebuild without LOCKING_RWLOCK\n");
+        return -1;
+    }
+#endif
+
+    shared = mmap(NULL, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap() failed");
+        exit(EXIT_FAILURE);
+    }
+    init_db();
+
+    struct sockaddr_in address;
+    int opt = 1;
+
+    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        perror("socket failed");
+        exit(EXIT_FAILURE);
+    }
+
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
+        perror("setsockopt failed");
+        exit(EXIT_FAILURE);
+    }
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr(server_ip);
+    address.sin_port = htons(port);
+
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("bind() failed");
+        exit(EXIT_FAILURE);
+    }
+
+    if (listen(server_fd, 3) < 0) {
+        perror("listen() failed");
+        exit(EXIT_FAILURE);
+    }
+
+    if (db_lock_init() < 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (observers_init() < 0) {
+        db_lock_destroy();
+        exit(EXIT_FAILURE);
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("Server listening on <ip:port> %s:%d\n", server_ip, port);
+
+    int rc = EXIT_FAILURE;
+    if (workers > 0) {
+        rc = supervise(workers);
+    } else {
+        serve();
+    }
+
+    close(server_fd);
+    db_lock_destroy();
+    observers_destroy();
+    return rc;
+}
+
+#endif